@@ -4,9 +4,11 @@
 
 #include "FastledDefinitions.h"
 
+#define SERVER_CODECS (CODEC_UNCOMPRESSED | CODEC_PHASE2 | CODEC_STRIPS | CODEC_RANGE)
+
 #define DATA_PIN  12
 #define CLOCK_PIN 14
-CRGB leds[3000];              // define a led array long enough
+CRGB leds[FASTLED_MAX_LEDS];  // define a led array long enough
 
 const char* ssid = "*****";
 const char* password = "********";
@@ -14,8 +16,24 @@ const char* password = "********";
 WiFiServer server(0xfa57);
 WiFiClient Client;
 
+// additional outputs, strip 0 uses DATA_PIN and CLOCK_PIN
+#define NUM_STRIPS    3
+#define DATA_PIN_1    13
+#define CLOCK_PIN_1   15
+#define DATA_PIN_2    4
+#define CLOCK_PIN_2   5
+
+// where each strip lives in leds[], assigned in the order the strips are announced
+uint16_t stripOffset[NUM_STRIPS];
+uint16_t stripLength[NUM_STRIPS];
+uint8_t  stripController[NUM_STRIPS];   // index into FastLED[]
+uint16_t nextOffset = 0;
+
+void decode0(CRGB *target, uint16_t limit);
 void decode1();
-void decode2();
+void decode2(CRGB *target, uint16_t limit);
+uint16_t room(uint16_t offset);
+void addStrip(uint8_t strip, uint16_t numLeds);
 
 void setup() {
 Serial.begin(115200);
@@ -81,52 +99,47 @@ uint8_t command = Client.read();
 switch (command) {
 case UNCOMPRESSED:
 {
-uint16_t  messageLength = Client.read();
-messageLength = messageLength << 8;
-messageLength = messageLength + Client.read();
-for (int i = 0; i < messageLength; i++) {
-leds[i] = Client.read();
-}
+decode0(leds + stripOffset[0], room(stripOffset[0]));
 break;
 }
 case PHASE2:
 {
-uint8_t buffer[6000];
-char b[80];
-int i;
-int index = 0;            // index into the leds[]
-
-uint16_t  messageLength2 = Client.read();
-messageLength2 = messageLength2 << 8;
-messageLength2 = messageLength2 + Client.read();
-for (i = 0; i < messageLength2; i++) {
-buffer[i] = Client.read();
+decode2(leds + stripOffset[0], room(stripOffset[0]));
+break;
 }
-
-//                    for (int i = 0; i < messageLength2; i++) {
-//                      sprintf(b, "%02X ", buffer[i]);
-//                      Serial.print(b);
-//                    }
-//                    Serial.println("");
-
-i = 0;
-CRGB prev = CRGB(buffer[0]+1, buffer[1], buffer[2]);    // force the first pev to be different
-
-while ( i < messageLength2 ) {
-leds[index++] = CRGB(buffer[i], buffer[i+1], buffer[i+2]);
-i += 3;
-if (index > 1) {
-if ( leds[index-1] == leds[index-2] )              // we have a run
+case FastledStripPixels:
 {
-CRGB prev = leds[index-1];
-
-uint8_t runLength = buffer[i++];
-for ( int y = 0; y < runLength; y++) {
-leds[index++] = prev;
-}
+// same payload as UNCOMPRESSED/PHASE2, prefixed by strip id and encoding
+uint8_t strip = Client.read();
+uint8_t encoding = Client.read();
+uint16_t offset = 0;
+uint16_t limit = 0;                     // strips we have no output for are read and dropped
+if (strip < NUM_STRIPS) {
+offset = stripOffset[strip];
+limit = room(offset);
 }
+if (encoding == PHASE2) decode2(leds + offset, limit);
+else decode0(leds + offset, limit);
+break;
 }
+case FastledRange:
+{
+// a span of a strip: strip id, start, count, encoding, then the usual payload
+uint8_t strip = Client.read();
+uint16_t start = Client.read();
+start = (start << 8) + Client.read();
+uint16_t count = Client.read();
+count = (count << 8) + Client.read();
+uint8_t encoding = Client.read();
+uint16_t offset = 0;
+uint16_t limit = 0;                     // ranges of unknown strips or past the end are read and dropped
+if (strip < NUM_STRIPS && start < stripLength[strip]) {
+offset = stripOffset[strip] + start;
+limit = stripLength[strip] - start;     // not into the next strip
+if (count < limit) limit = count;
 }
+if (encoding == PHASE2) decode2(leds + offset, limit);
+else decode0(leds + offset, limit);
 break;
 }
 case FastledSetBrightness:
@@ -140,12 +153,57 @@ case FastledShow:
 FastLED.show();
 break;
 }
+case FastledHello:
+{
+// the host tells us what it speaks, we answer with what we speak
+uint8_t hostVersion = Client.read();
+uint16_t hostCodecs = Client.read();
+hostCodecs = (hostCodecs << 8) + Client.read();
+for (int i = 0; i < 4; i++) Client.read();      // host max frame and led count, not needed here
+if (hostVersion >= 2) Client.read();            // host strips
+
+uint8_t caps[12];
+caps[0] = SYN;
+caps[1] = SOH;
+caps[2] = STX;
+caps[3] = FastledCaps;
+caps[4] = FASTLED_PROTOCOL_VERSION;
+caps[5] = SERVER_CODECS >> 8;
+caps[6] = SERVER_CODECS & 0xff;
+caps[7] = FASTLED_MAX_FRAME >> 8;
+caps[8] = FASTLED_MAX_FRAME & 0xff;
+caps[9] = FASTLED_MAX_LEDS >> 8;
+caps[10] = FASTLED_MAX_LEDS & 0xff;
+caps[11] = NUM_STRIPS;
+Client.write(caps, hostVersion >= 2 ? 12 : 11);
+
+Serial.print("Host protocol version "); Serial.print(hostVersion);
+Serial.print(" codecs 0x"); Serial.println(hostCodecs, HEX);
+break;
+}
 case FastledSetNumLeds:
 {
 uint16_t  NUM_LEDS = Client.read();
 NUM_LEDS = NUM_LEDS << 8;
 NUM_LEDS = NUM_LEDS + Client.read();
-FastLED.addLeds<APA102, DATA_PIN, CLOCK_PIN, BGR>(leds, NUM_LEDS);
+addStrip(0, NUM_LEDS);
+break;
+}
+case FastledStripSetNumLeds:
+{
+uint8_t strip = Client.read();
+uint16_t  NUM_LEDS = Client.read();
+NUM_LEDS = NUM_LEDS << 8;
+NUM_LEDS = NUM_LEDS + Client.read();
+addStrip(strip, NUM_LEDS);
+break;
+}
+case FastledStripShow:
+{
+uint8_t strip = Client.read();
+if (strip == STRIP_ALL) FastLED.show();
+else if (strip < NUM_STRIPS && stripLength[strip]) FastLED[stripController[strip]].showLeds(FastLED.getBrightness());
+break;
 }
 default:
 break;
@@ -166,3 +224,88 @@ break;
 //  }
 
 }
+
+// how many leds fit into leds[] from offset on
+uint16_t room(uint16_t offset) {
+if (offset >= FASTLED_MAX_LEDS) return 0;
+return FASTLED_MAX_LEDS - offset;
+}
+
+// UNCOMPRESSED payload: length followed by raw CRGB triplets
+// at most limit leds are written, the rest of the payload is read and dropped
+void decode0(CRGB *target, uint16_t limit) {
+uint16_t  messageLength = Client.read();
+messageLength = messageLength << 8;
+messageLength = messageLength + Client.read();
+uint8_t *raw = (uint8_t *)target;
+for (int i = 0; i < messageLength; i++) {
+uint8_t c = Client.read();
+if (i < limit * 3) raw[i] = c;
+}
+}
+
+// PHASE2 payload: length followed by run length encoded CRGB triplets
+// at most limit leds are written, the rest of the payload is read and dropped
+void decode2(CRGB *target, uint16_t limit) {
+uint8_t buffer[FASTLED_MAX_FRAME];
+char b[80];
+int i;
+int index = 0;            // index into the leds[]
+
+uint16_t  messageLength2 = Client.read();
+messageLength2 = messageLength2 << 8;
+messageLength2 = messageLength2 + Client.read();
+for (i = 0; i < messageLength2; i++) {
+buffer[i] = Client.read();
+}
+
+//                    for (int i = 0; i < messageLength2; i++) {
+//                      sprintf(b, "%02X ", buffer[i]);
+//                      Serial.print(b);
+//                    }
+//                    Serial.println("");
+
+i = 0;
+CRGB prev = CRGB(buffer[0]+1, buffer[1], buffer[2]);    // force the first pev to be different
+
+while ( i < messageLength2 ) {
+CRGB pixel = CRGB(buffer[i], buffer[i+1], buffer[i+2]);
+i += 3;
+if (index < limit) target[index] = pixel;
+index++;
+if (index > 1) {
+if ( pixel == prev )              // we have a run
+{
+uint8_t runLength = buffer[i++];
+for ( int y = 0; y < runLength; y++) {
+if (index < limit) target[index] = pixel;
+index++;
+}
+}
+}
+prev = pixel;
+}
+}
+
+// hook a strip up to its output pins, strips keep their place in leds[] once announced
+void addStrip(uint8_t strip, uint16_t numLeds) {
+if (strip >= NUM_STRIPS) return;
+if (stripLength[strip]) {
+// the leds of the other strips follow this one in leds[], it can't grow or shrink
+if (numLeds != stripLength[strip]) {
+Serial.print("strip "); Serial.print(strip); Serial.print(" keeps "); Serial.print(stripLength[strip]);
+Serial.print(" leds, ignoring "); Serial.println(numLeds);
+}
+return;
+}
+if (nextOffset + numLeds > FASTLED_MAX_LEDS) numLeds = FASTLED_MAX_LEDS - nextOffset;
+stripOffset[strip] = nextOffset;
+stripLength[strip] = numLeds;
+stripController[strip] = FastLED.count();
+nextOffset += numLeds;
+switch (strip) {
+case 0: FastLED.addLeds<APA102, DATA_PIN, CLOCK_PIN, RGB>(leds + stripOffset[strip], numLeds); break;
+case 1: FastLED.addLeds<APA102, DATA_PIN_1, CLOCK_PIN_1, RGB>(leds + stripOffset[strip], numLeds); break;
+case 2: FastLED.addLeds<APA102, DATA_PIN_2, CLOCK_PIN_2, RGB>(leds + stripOffset[strip], numLeds); break;
+}
+}
@@ -12,9 +12,15 @@
 #include <arpa/inet.h>      //inet_addr
 #include <unistd.h>         // sleep functions
 #include <netinet/tcp.h>
+#include <sys/select.h>     // select
+#include <time.h>           // clock_gettime
 
 #include "FastLED.h"
 #include "FastledDefinitions.h"
+#include "lib8tion.h"
+#include "timerwheel.h"
+
+uint16_t rand16seed = RAND16_SEED;      // random8() and random16() state
 
 /***************************************************************************
  *   Function   : Encode
@@ -34,6 +40,43 @@ int delay(uint16_t delayTime){
     return(usleep(sleepTime));
 }
 
+// milliseconds from an arbitrary but fixed starting point, like the Arduino millis()
+uint32_t millis(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return((uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000));
+}
+
+/***************************************************************************
+ *   Function   : get_millisecond_timer
+ *   Description: the clock of beat8() & co and the EVERY_N timers. From
+ *                frame_clock_begin() to frame_clock_end() it stays at the
+ *                time frame_clock_begin() was called, so all the waves of
+ *                a frame agree and the clock is read once per frame,
+ *                whichever thread asks. The start of a frame also steps
+ *                timerWheel. Outside a frame it is millis(), so
+ *                a loop that waits for an EVERY_N timer still gets there.
+ *   Parameters : none
+ *   Returned   : milliseconds
+ ***************************************************************************/
+
+static uint32_t frameMillis;                    // the time of the current frame
+static bool frameHeld;                          // inside a frame
+
+void frame_clock_begin(void){
+    frameMillis = millis();
+    frameHeld = true;
+    timerWheel.service(frameMillis);
+}
+
+void frame_clock_end(void){
+    frameHeld = false;
+}
+
+uint32_t get_millisecond_timer(void){
+    return(frameHeld ? frameMillis : millis());
+}
+
 int RleEncodePass1(unsigned char *inFile, unsigned int InLength, unsigned char *outFile, unsigned int *OutLength)
 {
     unsigned char currChar;                       /* current characters */
@@ -116,8 +159,10 @@ struct RGBVal {
     unsigned char blue;
 };
 
-// Pass #2 encodes color triplets
-int RleEncodePass2(unsigned char *inFile, unsigned int InLength, unsigned char *outFile, unsigned int *OutLength)
+// Pass #2 encodes color triplets. Gives up with -1 once the output gets
+// longer than MaxLength, a run of pairs makes it 7/6 of the input.
+int RleEncodePass2(unsigned char *inFile, unsigned int InLength, unsigned char *outFile, unsigned int *OutLength,
+                   unsigned int MaxLength)
 {
     unsigned char currRed, currGreen, currBlue;                       /* current characters */
     unsigned char prevRed, prevGreen, prevBlue;                       /* previous characters */
@@ -151,51 +196,45 @@ int RleEncodePass2(unsigned char *inFile, unsigned int InLength, unsigned char *
         currRed = inFile[i++];                   // read next char from stream
         currGreen = inFile[i++];
         currBlue = inFile[i++];
+        if (outCount + 3 > MaxLength)
+            return(-1);
         outFile[outCount++] = currRed;
         outFile[outCount++] = currGreen;
         outFile[outCount++] = currBlue;
         
-        /* check for run */
-        if (currRed == prevRed && currGreen == prevGreen && currBlue == prevBlue)
+        /* check for run, the decoder never sees one on the first triplet */
+        if (i > 3 && currRed == prevRed && currGreen == prevGreen && currBlue == prevBlue)
         {
             /* we have a run.  count run length */
             count = 0;
             
             while (i < InLength)
             {
-                currRed = inFile[i++];
-                currGreen = inFile[i++];
-                currBlue = inFile[i++];
+                currRed = inFile[i];
+                currGreen = inFile[i+1];
+                currBlue = inFile[i+2];
                 
                 if (currRed == prevRed && currGreen == prevGreen && currBlue == prevBlue)
                 {
+                    i += 3;
                     count++;
                     
                     if (count == UCHAR_MAX)
                     {
-                        /* count is as long as it can get */
-                        outFile[outCount++] = count;
-                        
-                        /* force next char to be different */
-                        prevRed = 0;
-                        prevGreen = EOF;
-                        prevBlue = 128;
+                        /* count is as long as it can get, the next equal
+                           triplet starts a new run on both ends */
                         break;
                     }
                 }
                 else
                 {
-                    /* run ended */
-                    outFile[outCount++] = count;
-                    outFile[outCount++] = currRed;
-                    outFile[outCount++] = currGreen;
-                    outFile[outCount++] = currBlue;
-                    prevRed = currRed;
-                    prevGreen = currGreen;
-                    prevBlue = currBlue;
+                    /* run ended, the next triplet is handled by the outer loop */
                     break;
                 }
             }
+            if (outCount + 1 > MaxLength)
+                return(-1);
+            outFile[outCount++] = count;
         }
         else
         {
@@ -204,13 +243,6 @@ int RleEncodePass2(unsigned char *inFile, unsigned int InLength, unsigned char *
             prevGreen = currGreen;
             prevBlue = currBlue;
         }
-        
-        if (i == (InLength))
-        {
-            /* run ended because of EOF */
-            outFile[outCount++] = count;
-            break;
-        }
     }
     
     *OutLength = outCount;
@@ -228,7 +260,7 @@ int connect8266(char *ip, uint16_t port) {
     }
 //    puts("Socket created");
     
-    server.sin_addr.s_addr = inet_addr("10.0.1.11");
+    server.sin_addr.s_addr = inet_addr(ip);
     server.sin_family = AF_INET;
     server.sin_port = htons( port );
     
@@ -242,3 +274,126 @@ int connect8266(char *ip, uint16_t port) {
     setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
     return(sock);
 }
+
+// read exactly len bytes from the server, giving up after timeout milliseconds
+// returns the number of bytes read, which is less than len on timeout or error
+int recv8266(int sock, unsigned char *buffer, unsigned int len, uint16_t timeout) {
+    unsigned int received = 0;
+    fd_set readSet;
+    struct timeval tv;
+    
+    while (received < len) {
+        FD_ZERO(&readSet);
+        FD_SET(sock, &readSet);
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        
+        if (select(sock + 1, &readSet, NULL, NULL, &tv) <= 0)
+            break;                                  // timeout or error
+        
+        ssize_t n = recv(sock, buffer + received, len - received, 0);
+        if (n <= 0)
+            break;                                  // connection closed
+        received += n;
+    }
+    return(received);
+}
+
+/***************************************************************************
+ *   Function   : hash64
+ *   Description: 64 bit hash of a buffer (XXH64). The main loop keeps four
+ *                independent lanes going over 32 byte stripes, so the
+ *                compiler can keep them all in flight at once.
+ *   Parameters : data - buffer to hash
+ *                len - length of the buffer in bytes
+ *                seed - start value, 0 is fine
+ *   Returned   : the hash
+ ***************************************************************************/
+
+#define PRIME64_1   0x9E3779B185EBCA87ULL
+#define PRIME64_2   0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3   0x165667B19E3779F9ULL
+#define PRIME64_4   0x85EBCA77C2B2AE63ULL
+#define PRIME64_5   0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t hashRound(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t hashMerge(uint64_t acc, uint64_t val) {
+    acc ^= hashRound(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t hash64(const void *data, unsigned int len, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + len;
+    uint64_t h;
+    
+    if (len >= 32) {
+        const unsigned char *limit = end - 32;
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        
+        do {
+            v1 = hashRound(v1, read64(p));
+            v2 = hashRound(v2, read64(p + 8));
+            v3 = hashRound(v3, read64(p + 16));
+            v4 = hashRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hashMerge(h, v1);
+        h = hashMerge(h, v2);
+        h = hashMerge(h, v3);
+        h = hashMerge(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+    
+    h += len;
+    
+    while (p + 8 <= end) {
+        h ^= hashRound(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+        p++;
+    }
+    
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
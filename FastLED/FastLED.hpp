@@ -11,20 +11,51 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>         // malloc
 #include <string.h>         //strlen
 #include <sys/socket.h>     //socket
 #include <arpa/inet.h>      //inet_addr
 #include <signal.h>         // signal definitions
 #include <unistd.h>
+#include <math.h>           // powf
 
 #include "lib8tion.h"
 #include "pixeltypes.h"
 #include "FastledDefinitions.h"
 #include "colorutils.h"
+#include "colorpalettes.h"
+#include "trackedleds.h"
+#include "bulk8.h"
+#include "blur2d.h"
+#include "matrixlayout.h"
+#include "threadpool.h"
+#include "planarleds.h"
+#include "noise.h"
+#include "power_mgt.h"
+#include "fastrandom.h"
+#include "layers.h"
 
 extern int connect8266(char *, uint16_t);
-extern int RleEncodePass2(unsigned char *, unsigned int, unsigned char *, unsigned int *);
+extern int RleEncodePass2(unsigned char *, unsigned int, unsigned char *, unsigned int *, unsigned int);
+extern int recv8266(int, unsigned char *, unsigned int, uint16_t);
 extern int delay(uint16_t);
+extern uint32_t millis(void);
+extern uint64_t hash64(const void *, unsigned int, uint64_t);
+extern void hsv2rgb_rainbow(const struct CHSV *, struct CRGB *, int);
+extern void hsv2rgb_rainbow_lut(const struct CHSV *, struct CRGB *, int);
+
+#define HOST_CODECS     (CODEC_UNCOMPRESSED | CODEC_PHASE2 | CODEC_STRIPS | CODEC_RANGE)
+#define HELLO_TIMEOUT   250         // ms to wait for the CAPS answer before assuming a legacy server
+#define KEEPALIVE       1000        // ms between full refreshes when nothing changes
+#define RENDER_BLOCK    64          // leds rendered to 16 bit at a time before dithering
+#define DITHER_STEP     159         // how far the dither offset moves from one byte to the next
+#define POWER_STEP      4           // how far the power limit has to be able to raise the brightness before it does
+#define RANDOM_BLOCK    PARALLEL_GRAIN  // leds per CRandom of random_pixels(), the chunks of parallel() start on one
+
+#ifndef BINARY_DITHER
+#define BINARY_DITHER   0x01
+#define DISABLE_DITHER  0x00
+#endif
 
 class NetworkLed {
 private:
@@ -38,8 +69,109 @@ public:
     uint16_t NumLeds;
     CRGB *leds;
     
+    // what the server told us in its CAPS answer
+    uint8_t  peerVersion;
+    uint16_t peerCodecs;
+    uint16_t peerMaxFrame;
+    uint16_t peerNumLeds;
+    uint8_t  peerStrips;                    // strips the server has outputs for
+    uint16_t codecs;                        // codecs both sides understand
+    
+    // additional strips multiplexed over this connection, strip 0 is leds/NumLeds
+    CRGB *stripLeds[FASTLED_MAX_STRIPS];
+    uint16_t stripNumLeds[FASTLED_MAX_STRIPS];
+    uint8_t numStrips;
+    uint8_t announced;                      // bit n set: strip n's size was sent, Connect() sends it again
+    unsigned char *frame;                   // what transfer() encodes the strips into, see frameBuffer()
+    unsigned int frameSize;
+    
+    // copy of what the server shows, used to only send what changed
+    CRGB *sentLeds[FASTLED_MAX_STRIPS];
+    CTrackedLeds *tracked[FASTLED_MAX_STRIPS];  // strips that keep a dirty bitmap
+    CRGB16 *store16[FASTLED_MAX_STRIPS];        // strips kept at 16 bits, no shadow copy
+    CPlanarLeds *planar[FASTLED_MAX_STRIPS];    // strips kept as color planes, no shadow copy
+    CPlanarLeds16 *planar16[FASTLED_MAX_STRIPS];
+    uint16_t sentNumLeds[FASTLED_MAX_STRIPS];   // 0 if the copy is not valid
+    uint64_t sentHash[FASTLED_MAX_STRIPS];      // hash of the frame we sent last
+    
+    uint16_t keepAlive;                     // ms between full refreshes of an unchanged frame
+    uint32_t lastTransfer;                  // millis() of the last frame that went out
+    bool     pendingShow;                   // something changed since the last show()
+    uint8_t  hsvTable;                      // bit n set: strip n converts hsv through the lookup table
+    CBlur2d  matrix;                        // XY() as an index table, for the 2d blur
+    CThreadPool pool;                       // workers for the bulk functions, none by default
+    uint32_t parallelMin;                   // fewer leds than this are done serially
+    CPaletteLut paletteLut;                 // the last palette used by the bulk palette functions
+    CRandom  rng;                           // seeds the random functions, rng.setSeed() to repeat a sequence
+    CCompositor *compositor;                // layers transfer() composites first, NULL if none
+    
+    // applied by encode() on the way to the wire, the stores are left alone
+    uint8_t  brightness;
+    uint8_t  renderBrightness;              // what the tables are built for, below brightness if the power limit says so
+    CRGB     correction;
+    CRGB     temperature;
+    float    gamma[3];                      // per channel, 1.0 leaves the values linear
+    EOrder   colorOrder;                    // byte order the server's strip expects
+    uint8_t  ditherMode;
+    uint8_t  ditherFrame;                   // counts the dithered frames
+    uint8_t  wireOrder[3];                  // channel that goes out as byte 0, 1 and 2
+    uint16_t wireTable[3][256];             // value of every byte on the wire, 8.8 fixed point
+    uint16_t wire16Table[3][257];           // the same for the high byte of a CRGB16, interpolated
+    bool     wireIdentity;                  // nothing to apply, leds go out as they are
+    bool     wireExact;                     // no fractions in wireTable, nothing to dither
+    bool     wire16Exact;                   // wire16Table rounds CRGB16(CRGB) to what wireTable gives
+    
+    // power limit, see setMaxPowerInMilliWatts()
+    uint32_t maxPower_mW;                   // 0 if there is no limit
+    CPowerModel powerModel;
+    uint32_t power_mW;                      // estimated draw of the last frame
+    uint32_t ledSum[FASTLED_MAX_STRIPS][3]; // red, green and blue added up over what each strip shows
+    
 public:
     NetworkLed(void) {
+        sock = -1;
+        NumLeds = 0;
+        leds = NULL;
+        memset(stripLeds, 0, sizeof(stripLeds));
+        memset(stripNumLeds, 0, sizeof(stripNumLeds));
+        numStrips = 1;
+        announced = 0;
+        peerNumLeds = FASTLED_MAX_LEDS;
+        peerStrips = FASTLED_MAX_STRIPS;
+        codecs = 0;
+        frame = NULL;
+        frameSize = 0;
+        memset(sentLeds, 0, sizeof(sentLeds));
+        memset(sentNumLeds, 0, sizeof(sentNumLeds));
+        memset(tracked, 0, sizeof(tracked));
+        memset(store16, 0, sizeof(store16));
+        memset(planar, 0, sizeof(planar));
+        memset(planar16, 0, sizeof(planar16));
+        keepAlive = KEEPALIVE;
+        lastTransfer = 0;
+        pendingShow = true;
+        hsvTable = 0;
+        parallelMin = PARALLEL_MIN;
+        compositor = NULL;
+        brightness = 255;
+        renderBrightness = 255;
+        maxPower_mW = 0;
+        powerModel = defaultPowerModel;
+        power_mW = 0;
+        memset(ledSum, 0, sizeof(ledSum));
+        correction = CRGB(255, 255, 255);
+        temperature = CRGB(255, 255, 255);
+        gamma[0] = gamma[1] = gamma[2] = 1.0f;
+        colorOrder = RGB;
+        ditherMode = DISABLE_DITHER;
+        ditherFrame = 0;
+        renderSetup();
+    }
+    
+    ~NetworkLed(void) {
+        for (int i = 0; i < FASTLED_MAX_STRIPS; i++)
+            delete[] sentLeds[i];
+        free(frame);
     }
     
     int Connect(char *ip) {
@@ -47,24 +179,321 @@ public:
         sock = connect8266((char *)ip, (uint16_t) 0xfa57);
         strcpy(server, ip);
         networkPort = 0xfa57;
+        memset(sentNumLeds, 0, sizeof(sentNumLeds));   // a new connection starts from scratch
+        Hello();
+        Announce();
         return(sock);
     }
     
+    // Tell a server we reconnected to the sizes it was told before, it
+    // may have restarted. Strips beyond what it has outputs for are dropped.
+    void Announce() {
+        if (numStrips > peerStrips && peerStrips > 0) {
+            printf("Connect() server has %d strips, dropping the other %d\n", peerStrips, numStrips - peerStrips);
+            numStrips = peerStrips;
+        }
+        for (uint8_t strip = 0; strip < numStrips; strip++) {
+            if (!(announced & (1 << strip)) || (strip && !(codecs & CODEC_STRIPS)))
+                continue;
+            uint16_t num = ledLimit(storeSize(strip), "Connect()");
+            if (strip)
+                stripNumLeds[strip] = num;
+            else
+                NumLeds = num;
+            if (sendNumLeds(strip, num) < 0)
+                puts("Connect() could not send the strip sizes");
+        }
+    }
+    
+    // Strips longer than either side can buffer are cut to that
+    uint16_t ledLimit(uint16_t num, const char *caller) {
+        uint16_t limit = peerNumLeds < FASTLED_MAX_LEDS ? peerNumLeds : FASTLED_MAX_LEDS;
+        
+        if (num <= limit)
+            return(num);
+        printf("%s %d leds are more than the server takes, using %d\n", caller, num, limit);
+        return(limit);
+    }
+    
+    // Capability handshake, sent right after connecting.
+    // Servers that predate the handshake ignore the HELLO and never answer,
+    // those are treated as protocol version 0 with the legacy codecs only.
+    void Hello() {
+        unsigned char outMessage[20];
+        unsigned char inMessage[11];
+        uint16_t xfer;
+        
+        peerVersion = 0;
+        peerCodecs = CODEC_UNCOMPRESSED | CODEC_PHASE2;
+        peerMaxFrame = FASTLED_MAX_FRAME;
+        peerNumLeds = FASTLED_MAX_LEDS;
+        peerStrips = FASTLED_MAX_STRIPS;    // version 1 servers don't say
+        
+        outMessage[0] = (unsigned char) SYN;
+        outMessage[1] = (unsigned char) SOH;
+        outMessage[2] = (unsigned char) STX;
+        outMessage[3] = (unsigned char) FastledHello;
+        outMessage[4] = (unsigned char) FASTLED_PROTOCOL_VERSION;
+        xfer = htons(HOST_CODECS);
+        memcpy(&outMessage[5], &xfer, 2);
+        xfer = htons(FASTLED_MAX_FRAME);
+        memcpy(&outMessage[7], &xfer, 2);
+        xfer = htons(NumLeds);
+        memcpy(&outMessage[9], &xfer, 2);
+        outMessage[11] = FASTLED_MAX_STRIPS;
+        
+        if( send(sock , outMessage , 12 , 0) < 0)
+        {
+            puts("Hello() failed, assuming legacy server");
+        }
+        else if( recv8266(sock, inMessage, 11, HELLO_TIMEOUT) == 11 &&
+                inMessage[0] == SYN && inMessage[1] == SOH && inMessage[2] == STX &&
+                inMessage[3] == FastledCaps)
+        {
+            peerVersion = inMessage[4];
+            memcpy(&xfer, &inMessage[5], 2);
+            peerCodecs = ntohs(xfer);
+            memcpy(&xfer, &inMessage[7], 2);
+            peerMaxFrame = ntohs(xfer);
+            memcpy(&xfer, &inMessage[9], 2);
+            peerNumLeds = ntohs(xfer);
+            if (peerVersion >= 2 && recv8266(sock, inMessage, 1, HELLO_TIMEOUT) == 1)
+                peerStrips = inMessage[0];
+        }
+        
+        codecs = HOST_CODECS & peerCodecs;
+    }
+    
     void setStore(struct CRGB * l) {
         this->leds = l;
+        tracked[0] = NULL;
+        store16[0] = NULL;
+        planar[0] = NULL;
+        planar16[0] = NULL;
+    }
+    
+    // Use a tracked buffer as strip 0, transfer() then only looks at
+    // the chunks that were written to since the last frame
+    void setStore(CTrackedLeds & t) {
+        this->leds = t.leds;
+        NumLeds = ledLimit(t.numLeds, "setStore()");
+        tracked[0] = &t;
+        store16[0] = NULL;
+        planar[0] = NULL;
+        planar16[0] = NULL;
+    }
+    
+    // Use 16 bit leds as strip 0. They are converted to 8 bits while they
+    // are encoded, and always sent whole, as there is no shadow copy to
+    // compare them to.
+    void setStore(struct CRGB16 * l, uint16_t num) {
+        this->leds = NULL;
+        NumLeds = ledLimit(num, "setStore()");
+        tracked[0] = NULL;
+        store16[0] = l;
+        planar[0] = NULL;
+        planar16[0] = NULL;
+    }
+    
+    // Use color planes as strip 0, sent whole like 16 bit leds
+    void setStore(CPlanarLeds & p) {
+        setStore((CRGB16 *)NULL, p.numLeds);
+        store16[0] = NULL;
+        planar[0] = &p;
+    }
+    
+    void setStore(CPlanarLeds16 & p) {
+        setStore((CRGB16 *)NULL, p.numLeds);
+        store16[0] = NULL;
+        planar16[0] = &p;
+    }
+    
+    CRGB *store(uint8_t strip) {
+        return strip ? stripLeds[strip] : leds;
+    }
+    
+    uint16_t storeSize(uint8_t strip) {
+        return strip ? stripNumLeds[strip] : NumLeds;
+    }
+    
+    // Register another led store on this connection. Returns the strip id,
+    // or -1 if the server can't address strips or we ran out of them.
+    int addStore(struct CRGB * l, uint16_t num) {
+        if (!(codecs & CODEC_STRIPS) || numStrips >= FASTLED_MAX_STRIPS || numStrips >= peerStrips) {
+            puts("addStore() no strip addressing available");
+            return(-1);
+        }
+        stripLeds[numStrips] = l;
+        tracked[numStrips] = NULL;
+        store16[numStrips] = NULL;
+        planar[numStrips] = NULL;
+        planar16[numStrips] = NULL;
+        SetNumLeds(numStrips, num);
+        return(numStrips++);
+    }
+    
+    int addStore(struct CRGB16 * l, uint16_t num) {
+        int strip = addStore((CRGB *)NULL, num);
+        if (strip > 0)
+            store16[strip] = l;
+        return(strip);
+    }
+    
+    int addStore(CPlanarLeds & p) {
+        int strip = addStore((CRGB *)NULL, p.numLeds);
+        if (strip > 0)
+            planar[strip] = &p;
+        return(strip);
+    }
+    
+    int addStore(CPlanarLeds16 & p) {
+        int strip = addStore((CRGB *)NULL, p.numLeds);
+        if (strip > 0)
+            planar16[strip] = &p;
+        return(strip);
+    }
+    
+    // Strips that aren't a CRGB array have no shadow copy and go out whole
+    bool wholeStrip(uint8_t strip) {
+        return store16[strip] || planar[strip] || planar16[strip];
+    }
+    
+    uint64_t wholeHash(uint8_t strip) {
+        uint16_t num = storeSize(strip);
+        uint64_t hash = 0;
+        
+        if (store16[strip])
+            return hash64(store16[strip], num * sizeof(CRGB16), 0);
+        for (int c = 0; c < 3; c++) {
+            if (planar[strip])
+                hash = hash64(planar[strip]->planes[c], num, hash);
+            else
+                hash = hash64(planar16[strip]->planes[c], num * 2, hash);
+        }
+        return(hash);
+    }
+    
+    int addStore(CTrackedLeds & t) {
+        int strip = addStore(t.leds, t.numLeds);
+        if (strip > 0)
+            tracked[strip] = &t;
+        return(strip);
+    }
+    
+    // Which strip's store do these leds live in, -1 if none
+    int stripOf(const CRGB *l, uint16_t count) {
+        for (uint8_t strip = 0; strip < numStrips; strip++) {
+            const CRGB *first = store(strip);
+            if (first && l >= first && l + count <= first + storeSize(strip))
+                return(strip);
+        }
+        return(-1);
+    }
+    
+    int planarStrip(const CPlanarLeds *p) {
+        for (uint8_t strip = 0; strip < numStrips; strip++)
+            if (planar[strip] == p)
+                return(strip);
+        return(-1);
+    }
+    
+    // Mark leds written by one of the bulk functions below as dirty,
+    // if they belong to a tracked strip or a layer of the compositor
+    void touch(const CRGB *l, uint16_t count) {
+        if (compositor && compositor->touch(l, count))
+            return;
+        int strip = stripOf(l, count);
+        if (strip >= 0 && tracked[strip])
+            tracked[strip]->mark(l - store(strip), count);
+    }
+    
+    // Draw into the layers of c instead of a strip, transfer() composites
+    // what changed into c's output first. The output is normally a tracked
+    // strip, e.g. the one given to setStore(). NULL to stop.
+    void setCompositor(CCompositor *c) {
+        compositor = c;
+    }
+    
+    // Convert hsv to rgb through the (hue, sat) lookup table instead of
+    // computing every pixel. Same colors either way, the table is faster
+    // as long as it stays in cache.
+    void setHsvTable(bool on, uint8_t strip = STRIP_ALL) {
+        uint8_t bits = (strip == STRIP_ALL) ? 0xff : (1 << strip);
+        if (on)
+            hsvTable |= bits;
+        else
+            hsvTable &= ~bits;
+    }
+    
+    // Spread the bulk functions over threads extra threads, for arrays of
+    // at least minLeds leds. 0 threads makes everything serial again.
+    void setParallel(int threads, uint32_t minLeds = PARALLEL_MIN) {
+        pool.start(threads);
+        parallelMin = minLeds;
+    }
+    
+    // f(begin, end) on all of [0, count), in chunks on the pool if it is
+    // big enough to be worth it. f must not call parallel() again.
+    CThreadPool *parallelPool(uint32_t count) {
+        return (count < parallelMin || pool.size() < 2) ? NULL : &pool;
+    }
+    
+    template<class F> void parallel(uint32_t count, F f) {
+        if (count < parallelMin || pool.size() < 2)
+            f(0, count);
+        else
+            pool.run(count, f);
+    }
+    
+    // A random color for about density / 256 of the leds, the others stay
+    // as they are, e.g. on top of fadeToBlackBy() for sparkles. Every
+    // block of RANDOM_BLOCK leds gets its own CRandom, seeded from rng and
+    // the block number, so the threads share no state and the same seed
+    // gives the same leds however many threads there are.
+    void random_pixels(CRGB *leds, int num_leds, uint8_t density) {
+        uint32_t seed = rng.random32();
+        parallel(num_leds, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t block = begin; block < end; block += RANDOM_BLOCK) {
+                CRandom r(seed ^ (block / RANDOM_BLOCK));
+                r.random_pixels(&leds[block], (end - block < RANDOM_BLOCK) ? end - block : RANDOM_BLOCK, density);
+            }
+        });
+        touch(leds, num_leds);
+    }
+    
+    // hsv2rgb_rainbow for an array, table or computed as the strip wants
+    void hsv2rgb(const CHSV *hsv, CRGB *rgb, uint16_t count) {
+        int strip = stripOf(rgb, count);
+        bool table = strip >= 0 && (hsvTable & (1 << strip));
+        parallel(count, [&](uint32_t begin, uint32_t end) {
+            if (table)
+                hsv2rgb_rainbow_lut(&hsv[begin], &rgb[begin], end - begin);
+            else
+                hsv2rgb_rainbow(&hsv[begin], &rgb[begin], end - begin);
+        });
+        touch(rgb, count);
     }
     
     void clear() {
-        for (int i = 0; i < NumLeds; i++)
-            leds[i] = 0;
+        if (planar[0])
+            fill_solid(*planar[0], CRGB(0, 0, 0));
+        else if (planar16[0])
+            fill_solid(*planar16[0], CRGB16(0, 0, 0));
+        else if (store16[0])
+            fill_solid(store16[0], NumLeds, CRGB16(0, 0, 0));
+        else
+            fill_solid(leds, NumLeds, CRGB(0, 0, 0));
     }
     
     void fill_solid( struct CRGB * leds, int numToFill,
                     const struct CRGB& color)
     {
-        for( int i = 0; i < numToFill; i++) {
-            leds[i] = color;
-        }
+        parallel(numToFill, [&](uint32_t begin, uint32_t end) {
+            for( uint32_t i = begin; i < end; i++) {
+                leds[i] = color;
+            }
+        });
+        touch(leds, numToFill);
     }
     
     void fill_solid( struct CHSV * targetArray, int numToFill,
@@ -85,14 +514,24 @@ public:
                       uint8_t initialhue,
                       uint8_t deltahue )
     {
-        CHSV hsv;
-        hsv.hue = initialhue;
-        hsv.val = 255;
-        hsv.sat = 240;
-        for( int i = 0; i < numToFill; i++) {
-            pFirstLED[i] = hsv;
-            hsv.hue += deltahue;
-        }
+        int strip = stripOf(pFirstLED, numToFill);
+        bool table = strip >= 0 && (hsvTable & (1 << strip));
+        parallel(numToFill, [&](uint32_t begin, uint32_t end) {
+            CHSV hsv[64];           // converted in batches
+            uint8_t hue = initialhue + begin * deltahue;
+            for( uint32_t i = begin; i < end; i += 64) {
+                int n = (end - i < 64) ? end - i : 64;
+                for( int j = 0; j < n; j++) {
+                    hsv[j] = CHSV(hue, 240, 255);
+                    hue += deltahue;
+                }
+                if (table)
+                    hsv2rgb_rainbow_lut(hsv, &pFirstLED[i], n);
+                else
+                    hsv2rgb_rainbow(hsv, &pFirstLED[i], n);
+            }
+        });
+        touch(pFirstLED, numToFill);
     }
     
     void fill_rainbow( struct CHSV * targetArray, int numToFill,
@@ -139,9 +578,10 @@ public:
     
     void nscale8_video( CRGB* leds, uint16_t num_leds, uint8_t scale)
     {
-        for( uint16_t i = 0; i < num_leds; i++) {
-            leds[i].nscale8_video( scale);
-        }
+        parallel(num_leds, [&](uint32_t begin, uint32_t end) {
+            bulk_scale8_video((uint8_t *)&leds[begin], (end - begin) * 3, scale);
+        });
+        touch(leds, num_leds);
     }
     
     void fade_video(CRGB* leds, uint16_t num_leds, uint8_t fadeBy)
@@ -172,23 +612,18 @@ public:
     
     void nscale8( CRGB* leds, uint16_t num_leds, uint8_t scale)
     {
-        for( uint16_t i = 0; i < num_leds; i++) {
-            leds[i].nscale8( scale);
-        }
+        parallel(num_leds, [&](uint32_t begin, uint32_t end) {
+            bulk_scale8((uint8_t *)&leds[begin], (end - begin) * 3, scale);
+        });
+        touch(leds, num_leds);
     }
     
     void fadeUsingColor( CRGB* leds, uint16_t numLeds, const CRGB& colormask)
     {
-        uint8_t fr, fg, fb;
-        fr = colormask.r;
-        fg = colormask.g;
-        fb = colormask.b;
-        
-        for( uint16_t i = 0; i < numLeds; i++) {
-            leds[i].r = scale8_LEAVING_R1_DIRTY( leds[i].r, fr);
-            leds[i].g = scale8_LEAVING_R1_DIRTY( leds[i].g, fg);
-            leds[i].b = scale8                 ( leds[i].b, fb);
-        }
+        parallel(numLeds, [&](uint32_t begin, uint32_t end) {
+            bulk_scale8x3((uint8_t *)&leds[begin], end - begin, colormask.r, colormask.g, colormask.b);
+        });
+        touch(leds, numLeds);
     }
 
     
@@ -221,11 +656,10 @@ public:
     
     void nblend( CRGB* existing, CRGB* overlay, uint16_t count, fract8 amountOfOverlay)
     {
-        for( uint16_t i = count; i; i--) {
-            nblend( *existing, *overlay, amountOfOverlay);
-            existing++;
-            overlay++;
-        }
+        parallel(count, [&](uint32_t begin, uint32_t end) {
+            bulk_nblend8((uint8_t *)&existing[begin], (const uint8_t *)&overlay[begin], (end - begin) * 3, amountOfOverlay);
+        });
+        touch(existing, count);
     }
     
     CRGB blend( const CRGB& p1, const CRGB& p2, fract8 amountOfP2 )
@@ -237,9 +671,184 @@ public:
     
     CRGB* blend( const CRGB* src1, const CRGB* src2, CRGB* dest, uint16_t count, fract8 amountOfsrc2 )
     {
-        for( uint16_t i = 0; i < count; i++) {
-            dest[i] = blend(src1[i], src2[i], amountOfsrc2);
-        }
+        parallel(count, [&](uint32_t begin, uint32_t end) {
+            bulk_blend8((const uint8_t *)&src1[begin], (const uint8_t *)&src2[begin], (uint8_t *)&dest[begin],
+                        (end - begin) * 3, amountOfsrc2);
+        });
+        touch(dest, count);
+        return dest;
+    }
+    
+    // The same for color planes. Every plane is a plain byte array, so
+    // the per color versions are no different from the others.
+    void fill_solid( CPlanarLeds & leds, const struct CRGB& color)
+    {
+        parallel(leds.numLeds, [&](uint32_t begin, uint32_t end) {
+            for (int c = 0; c < 3; c++)
+                memset(&leds.planes[c][begin], color.raw[c], end - begin);
+        });
+    }
+    
+    void fill_rainbow( CPlanarLeds & leds, uint8_t initialhue, uint8_t deltahue)
+    {
+        int strip = planarStrip(&leds);
+        bool table = strip >= 0 && (hsvTable & (1 << strip));
+        parallel(leds.numLeds, [&](uint32_t begin, uint32_t end) {
+            CHSV hsv[64];
+            CRGB rgb[64];
+            uint8_t hue = initialhue + begin * deltahue;
+            for( uint32_t i = begin; i < end; i += 64) {
+                int n = (end - i < 64) ? end - i : 64;
+                for( int j = 0; j < n; j++) {
+                    hsv[j] = CHSV(hue, 240, 255);
+                    hue += deltahue;
+                }
+                if (table)
+                    hsv2rgb_rainbow_lut(hsv, rgb, n);
+                else
+                    hsv2rgb_rainbow(hsv, rgb, n);
+                leds.load(rgb, i, n);
+            }
+        });
+    }
+    
+    void hsv2rgb( const CHSV *hsv, CPlanarLeds & leds)
+    {
+        int strip = planarStrip(&leds);
+        bool table = strip >= 0 && (hsvTable & (1 << strip));
+        parallel(leds.numLeds, [&](uint32_t begin, uint32_t end) {
+            CRGB rgb[64];
+            for( uint32_t i = begin; i < end; i += 64) {
+                int n = (end - i < 64) ? end - i : 64;
+                if (table)
+                    hsv2rgb_rainbow_lut(&hsv[i], rgb, n);
+                else
+                    hsv2rgb_rainbow(&hsv[i], rgb, n);
+                leds.load(rgb, i, n);
+            }
+        });
+    }
+    
+    void nscale8( CPlanarLeds & leds, uint8_t scale)
+    {
+        fadeUsingColor(leds, CRGB(scale, scale, scale));
+    }
+    
+    void nscale8_video( CPlanarLeds & leds, uint8_t scale)
+    {
+        parallel(leds.numLeds, [&](uint32_t begin, uint32_t end) {
+            for (int c = 0; c < 3; c++)
+                bulk_scale8_video(&leds.planes[c][begin], end - begin, scale);
+        });
+    }
+    
+    void fadeToBlackBy( CPlanarLeds & leds, uint8_t fadeBy)
+    {
+        nscale8( leds, 255 - fadeBy);
+    }
+    
+    void fadeUsingColor( CPlanarLeds & leds, const CRGB& colormask)
+    {
+        parallel(leds.numLeds, [&](uint32_t begin, uint32_t end) {
+            for (int c = 0; c < 3; c++)
+                bulk_scale8(&leds.planes[c][begin], end - begin, colormask.raw[c]);
+        });
+    }
+    
+    void nblend( CPlanarLeds & existing, const CPlanarLeds & overlay, fract8 amountOfOverlay)
+    {
+        blend( existing, overlay, existing, amountOfOverlay);
+    }
+    
+    void blend( const CPlanarLeds & src1, const CPlanarLeds & src2, CPlanarLeds & dest, fract8 amountOfsrc2)
+    {
+        parallel(dest.numLeds, [&](uint32_t begin, uint32_t end) {
+            for (int c = 0; c < 3; c++)
+                bulk_blend8(&src1.planes[c][begin], &src2.planes[c][begin], &dest.planes[c][begin],
+                            end - begin, amountOfsrc2);
+        });
+    }
+    
+    void fill_solid( CPlanarLeds16 & leds, const struct CRGB16& color)
+    {
+        parallel(leds.numLeds, [&](uint32_t begin, uint32_t end) {
+            for (int c = 0; c < 3; c++)
+                for (uint32_t i = begin; i < end; i++)
+                    leds.planes[c][i] = color.raw[c];
+        });
+    }
+    
+    void nscale16( CPlanarLeds16 & leds, fract16 scale)
+    {
+        parallel(leds.numLeds, [&](uint32_t begin, uint32_t end) {
+            for (int c = 0; c < 3; c++)
+                bulk_scale16(&leds.planes[c][begin], end - begin, scale);
+        });
+    }
+    
+    void nscale8( CPlanarLeds16 & leds, uint8_t scale)
+    {
+        nscale16( leds, scale << 8);
+    }
+    
+    void fadeToBlackBy( CPlanarLeds16 & leds, uint8_t fadeBy)
+    {
+        nscale16( leds, (255 - fadeBy) << 8);
+    }
+    
+    void nblend( CPlanarLeds16 & existing, const CPlanarLeds16 & overlay, fract16 amountOfOverlay)
+    {
+        blend( existing, overlay, existing, amountOfOverlay);
+    }
+    
+    void blend( const CPlanarLeds16 & src1, const CPlanarLeds16 & src2, CPlanarLeds16 & dest, fract16 amountOfsrc2)
+    {
+        parallel(dest.numLeds, [&](uint32_t begin, uint32_t end) {
+            for (int c = 0; c < 3; c++)
+                bulk_blend16(&src1.planes[c][begin], &src2.planes[c][begin], &dest.planes[c][begin],
+                             end - begin, amountOfsrc2);
+        });
+    }
+    
+    // The same for 16 bit leds
+    void fill_solid( struct CRGB16 * leds, int numToFill,
+                    const struct CRGB16& color)
+    {
+        parallel(numToFill, [&](uint32_t begin, uint32_t end) {
+            for( uint32_t i = begin; i < end; i++) {
+                leds[i] = color;
+            }
+        });
+    }
+    
+    void nscale16( CRGB16* leds, uint16_t num_leds, fract16 scale)
+    {
+        parallel(num_leds, [&](uint32_t begin, uint32_t end) {
+            bulk_scale16((uint16_t *)&leds[begin], (end - begin) * 3, scale);
+        });
+    }
+    
+    void nscale8( CRGB16* leds, uint16_t num_leds, uint8_t scale)
+    {
+        nscale16( leds, num_leds, scale << 8);
+    }
+    
+    void fadeToBlackBy( CRGB16* leds, uint16_t num_leds, uint8_t fadeBy)
+    {
+        nscale16( leds, num_leds, (255 - fadeBy) << 8);
+    }
+    
+    void nblend( CRGB16* existing, const CRGB16* overlay, uint16_t count, fract16 amountOfOverlay)
+    {
+        blend( existing, overlay, existing, count, amountOfOverlay);
+    }
+    
+    CRGB16* blend( const CRGB16* src1, const CRGB16* src2, CRGB16* dest, uint16_t count, fract16 amountOfsrc2 )
+    {
+        parallel(count, [&](uint32_t begin, uint32_t end) {
+            bulk_blend16((const uint16_t *)&src1[begin], (const uint16_t *)&src2[begin], (uint16_t *)&dest[begin],
+                         (end - begin) * 3, amountOfsrc2);
+        });
         return dest;
     }
     
@@ -322,10 +931,275 @@ public:
     
     
     
+    // fill_palette - fill leds with colors from a palette, starting at
+    //                startIndex and moving incIndex further for every led.
+    //                The palette is expanded to all 256 indexes once
+    //                (and again only when it, brightness or blendType
+    //                change), then every led is a table lookup.
+    void fill_palette( CRGB* L, uint16_t N, uint8_t startIndex, uint8_t incIndex,
+                      const CRGBPalette16& pal, uint8_t brightness = 255, TBlendType blendType = LINEARBLEND)
+    {
+        paletteLut.build(pal, brightness, blendType);
+        paletteFill(L, N, startIndex, incIndex);
+    }
+    
+    void fill_palette( CRGB* L, uint16_t N, uint8_t startIndex, uint8_t incIndex,
+                      const CRGBPalette256& pal, uint8_t brightness = 255, TBlendType = NOBLEND)
+    {
+        paletteLut.build(pal, brightness);
+        paletteFill(L, N, startIndex, incIndex);
+    }
+    
+    // map_data_into_colors_through_palette - the color of every data byte,
+    //                each one used as a palette index. With an opacity
+    //                below 255 the colors are mixed into what the leds
+    //                have already.
+    void map_data_into_colors_through_palette( const uint8_t *dataArray, uint16_t dataCount, CRGB* targetColorArray,
+                                              const CRGBPalette16& pal, uint8_t brightness = 255,
+                                              uint8_t opacity = 255, TBlendType blendType = LINEARBLEND)
+    {
+        paletteLut.build(pal, brightness, blendType);
+        paletteMap(dataArray, dataCount, targetColorArray, opacity);
+    }
+    
+    void map_data_into_colors_through_palette( const uint8_t *dataArray, uint16_t dataCount, CRGB* targetColorArray,
+                                              const CRGBPalette256& pal, uint8_t brightness = 255,
+                                              uint8_t opacity = 255)
+    {
+        paletteLut.build(pal, brightness);
+        paletteMap(dataArray, dataCount, targetColorArray, opacity);
+    }
+    
+    void paletteFill( CRGB* L, uint16_t N, uint8_t startIndex, uint8_t incIndex)
+    {
+        parallel(N, [&](uint32_t begin, uint32_t end) {
+            uint8_t index[64];
+            uint8_t colorIndex = startIndex + begin * incIndex;
+            for( uint32_t i = begin; i < end; i += 64) {
+                int n = (end - i < 64) ? end - i : 64;
+                for( int j = 0; j < n; j++) {
+                    index[j] = colorIndex;
+                    colorIndex += incIndex;
+                }
+                paletteLut.map(index, &L[i], n);
+            }
+        });
+        touch(L, N);
+    }
+    
+    void paletteMap( const uint8_t *dataArray, uint16_t dataCount, CRGB* target, uint8_t opacity)
+    {
+        parallel(dataCount, [&](uint32_t begin, uint32_t end) {
+            if( opacity == 255) {
+                paletteLut.map(&dataArray[begin], &target[begin], end - begin);
+                return;
+            }
+            CRGB rgb[64];
+            for( uint32_t i = begin; i < end; i += 64) {
+                int n = (end - i < 64) ? end - i : 64;
+                paletteLut.map(&dataArray[i], rgb, n);
+                bulk_scale8((uint8_t *)&target[i], n * 3, 256 - opacity);
+                bulk_scale8_video((uint8_t *)rgb, n * 3, opacity);
+                for( int j = 0; j < n; j++)
+                    target[i + j] += rgb[j];
+            }
+        });
+        touch(target, dataCount);
+    }
+    
+    // fill_noise8 - the hue and the value of every led from two lines of
+    //               noise (see fill_raw_noise8 in noise.h), saturation 255.
+    //               The leds are done in batches of 64, every batch gets
+    //               its noise a whole row at a time.
+    void fill_noise8( CRGB *leds, int num_leds,
+                     uint8_t octaves, uint16_t x, int scale,
+                     uint8_t hue_octaves, uint16_t hue_x, int hue_scale,
+                     uint16_t time)
+    {
+        int strip = stripOf(leds, num_leds);
+        bool table = strip >= 0 && (hsvTable & (1 << strip));
+        parallel(num_leds, [&](uint32_t begin, uint32_t end) {
+            uint8_t V[64], H[64];
+            for( uint32_t i = begin; i < end; i += 64) {
+                int n = (end - i < 64) ? end - i : 64;
+                memset(V, 0, n);
+                memset(H, 0, n);
+                fill_raw_noise8(V, n, octaves, x + i * scale, scale, time);
+                fill_raw_noise8(H, n, hue_octaves, hue_x + i * hue_scale, hue_scale, time);
+                noiseColors(H, V, 1, &leds[i], n, 0, table, false);
+            }
+        });
+        touch(leds, num_leds);
+    }
+    
+    // fill_noise16 - the same with 16 bit noise for the value, the hue
+    //                shifted by hue_shift
+    void fill_noise16( CRGB *leds, int num_leds,
+                      uint8_t octaves, uint16_t x, int scale,
+                      uint8_t hue_octaves, uint16_t hue_x, int hue_scale,
+                      uint16_t time, uint8_t hue_shift = 0)
+    {
+        int strip = stripOf(leds, num_leds);
+        bool table = strip >= 0 && (hsvTable & (1 << strip));
+        parallel(num_leds, [&](uint32_t begin, uint32_t end) {
+            uint8_t V[64], H[64];
+            for( uint32_t i = begin; i < end; i += 64) {
+                int n = (end - i < 64) ? end - i : 64;
+                memset(V, 0, n);
+                memset(H, 0, n);
+                fill_raw_noise16into8(V, n, octaves, x + i * scale, scale, time);
+                fill_raw_noise8(H, n, hue_octaves, hue_x + i * hue_scale, hue_scale, time);
+                noiseColors(H, V, 1, &leds[i], n, hue_shift, table, false);
+            }
+        });
+        touch(leds, num_leds);
+    }
+    
+    // fill_plain_2dnoise8 - the same for a width x height matrix stored row
+    //                 by row, odd rows reversed when serpentine. As upstream's
+    //                 fill_2dnoise8, the hue field is mirrored in both
+    //                 directions, and with blend the leds end up half what
+    //                 they were, half noise. The rows are spread over the
+    //                 pool. Every octave is plain noise, see
+    //                 fill_plain_2dnoise8 in noise.h, so the field is not
+    //                 the one upstream's fill_2dnoise8 draws.
+    void fill_plain_2dnoise8( CRGB *leds, int width, int height, bool serpentine,
+                             uint8_t octaves, uint16_t x, int xscale, uint16_t y, int yscale, uint16_t time,
+                             uint8_t hue_octaves, uint16_t hue_x, int hue_xscale, uint16_t hue_y, int hue_yscale,
+                             uint16_t hue_time, bool blend)
+    {
+        fill_2dnoise(leds, width, height, serpentine, blend, 0,
+                     [&](uint8_t *V, uint8_t *H, int row, int col, int n) {
+            int hcol = width - col - n;
+            ::fill_plain_2dnoise8(V, n, 1, octaves, x + col * xscale, xscale, y + row * yscale, yscale, time);
+            ::fill_plain_2dnoise8(H, n, 1, hue_octaves, hue_x + hcol * hue_xscale, hue_xscale,
+                                  hue_y + (height - 1 - row) * hue_yscale, hue_yscale, hue_time);
+        });
+    }
+    
+    void fill_plain_2dnoise16( CRGB *leds, int width, int height, bool serpentine,
+                              uint8_t octaves, uint32_t x, int xscale, uint32_t y, int yscale, uint32_t time,
+                              uint8_t hue_octaves, uint16_t hue_x, int hue_xscale, uint16_t hue_y, int hue_yscale,
+                              uint16_t hue_time, bool blend, uint8_t hue_shift = 0)
+    {
+        fill_2dnoise(leds, width, height, serpentine, blend, hue_shift,
+                     [&](uint8_t *V, uint8_t *H, int row, int col, int n) {
+            int hcol = width - col - n;
+            fill_plain_2dnoise16into8(V, n, 1, octaves, x + col * xscale, xscale, y + row * yscale, yscale, time);
+            ::fill_plain_2dnoise8(H, n, 1, hue_octaves, hue_x + hcol * hue_xscale, hue_xscale,
+                                  hue_y + (height - 1 - row) * hue_yscale, hue_yscale, hue_time);
+        });
+    }
+    
+    // rows of up to 64 leds, noise(V, H, row, col, n) fills in the values of
+    // leds col..col+n-1 and the hues of the mirrored ones
+    template<class F> void fill_2dnoise( CRGB *leds, int width, int height, bool serpentine, bool blend,
+                                      uint8_t hue_shift, F noise)
+    {
+        int strip = stripOf(leds, width * height);
+        bool table = strip >= 0 && (hsvTable & (1 << strip));
+        parallel(height, [&](uint32_t begin, uint32_t end) {
+            uint8_t V[64], H[64];
+            for( uint32_t row = begin; row < end; row++) {
+                CRGB *line = &leds[row * width];
+                bool reverse = serpentine && (row & 1);
+                for( int col = 0; col < width; col += 64) {
+                    int n = (width - col < 64) ? width - col : 64;
+                    memset(V, 0, n);
+                    memset(H, 0, n);
+                    noise(V, H, row, col, n);
+                    // the hue of led col + j is H[n - 1 - j]
+                    if (reverse)
+                        noiseColors(H + n - 1, V, -1, &line[width - col - n], n, hue_shift, table, blend, true);
+                    else
+                        noiseColors(H + n - 1, V, -1, &line[col], n, hue_shift, table, blend);
+                }
+            }
+        });
+        touch(leds, width * height);
+    }
+    
+    // out[j] = CHSV(H[j * hstep] + hue_shift, 255, V[j]), or out[n - 1 - j]
+    // when reversed. With blend the color is averaged with what is there.
+    void noiseColors( const uint8_t *H, const uint8_t *V, int hstep, CRGB *out, int n,
+                     uint8_t hue_shift, bool table, bool blend, bool reverse = false)
+    {
+        CHSV hsv[64];
+        CRGB rgb[64];
+        CRGB *dst = (blend || reverse) ? rgb : out;
+        for( int j = 0; j < n; j++)
+            hsv[j] = CHSV(H[j * hstep] + hue_shift, 255, V[j]);
+        if (table)
+            hsv2rgb_rainbow_lut(hsv, dst, n);
+        else
+            hsv2rgb_rainbow(hsv, dst, n);
+        if (dst == out)
+            return;
+        for( int j = 0; j < n; j++) {
+            CRGB & led = out[reverse ? n - 1 - j : j];
+            if (blend) {
+                led.r = (led.r >> 1) + (rgb[j].r >> 1);
+                led.g = (led.g >> 1) + (rgb[j].g >> 1);
+                led.b = (led.b >> 1) + (rgb[j].b >> 1);
+            } else {
+                led = rgb[j];
+            }
+        }
+    }
+    
+    
     // Forward declaration of the function "XY" which must be provided by
-    // the application for use in two-dimensional filter functions.
+    // the application for use in two-dimensional filter functions,
+    // unless the matrix is described with setLayout() instead. Matrices
+    // go up to 255 x 255 that way, layouts up to 65535 leds.
     uint16_t XY( uint8_t, uint8_t);// __attribute__ ((weak));
     
+    // Use a layout from matrixlayout.h for the 2d functions on a matrix of
+    // its size, instead of calling XY(). The table is only built again for
+    // a different layout. A CTableLayout whose table changed needs
+    // matrix.resize(0, 0) first. false if the layout has more than
+    // LAYOUT_MAX_LEDS leds or there is no memory for the table.
+    template<class LAYOUT> bool setLayout(const LAYOUT & layout) {
+        if (matrix.source == layoutTag(layout) && matrix.width == layout.width && matrix.height == layout.height)
+            return(true);
+        if ((uint32_t)layout.width * layout.height > LAYOUT_MAX_LEDS) {
+            puts("setLayout() too many leds for a layout");
+            return(false);
+        }
+        if (!matrix.resize(layout.width, layout.height))
+            return(false);
+        layoutTable(layout, matrix.xy);
+        return(matrix.mapped(layoutTag(layout)));
+    }
+    
+    // blur2d through a layout, which also becomes the one setLayout() sets.
+    // Never calls XY(), apps that only use layouts don't need one.
+    template<class LAYOUT> void blur2d( CRGB* leds, const LAYOUT & layout, fract8 blur_amount)
+    {
+        uint16_t num = (uint32_t)layout.width * layout.height;
+        
+        if (!setLayout(layout))
+            return;
+        matrix.blur(leds, blur_amount, true, true, parallelPool(num));
+        touch(leds, num);
+    }
+    
+    // The blur engine for a width x height matrix. Unless the last layout
+    // given to setLayout() or blur2d() is of that size, XY() is asked once
+    // for every pixel whenever the size changes. The table remembers this
+    // as the source of it.
+    CBlur2d & blurMatrix(uint8_t width, uint8_t height) {
+        if (matrix.width != width || matrix.height != height || !matrix.source) {
+            if (!matrix.resize(width, height))
+                return matrix;          // 0 x 0, blurs nothing
+            for (uint16_t y = 0; y < height; y++)
+                for (uint16_t x = 0; x < width; x++)
+                    matrix.xy[(uint32_t)y * width + x] = XY(x, y);
+            matrix.mapped(this);
+        }
+        return matrix;
+    }
+    
     
     // blur1d: one-dimensional blur filter. Spreads light to 2 line neighbors.
     // blur2d: two-dimensional blur filter. Spreads light to 8 XY neighbors.
@@ -355,55 +1229,28 @@ public:
             leds[i] = cur;
             carryover = part;
         }
+        touch(leds, numLeds);
     }
     
     void blur2d( CRGB* leds, uint8_t width, uint8_t height, fract8 blur_amount)
     {
-        blurRows(leds, width, height, blur_amount);
-        blurColumns(leds, width, height, blur_amount);
+        blurMatrix(width, height).blur(leds, blur_amount, true, true, parallelPool(width * height));
+        touch(leds, width * height);
     }
     
     
     // blurRows: perform a blur1d on every row of a rectangular matrix
     void blurRows(CRGB* leds, uint8_t width, uint8_t height, fract8 blur_amount)
     {
-        // blur rows
-        uint8_t keep = 255 - blur_amount;
-        uint8_t seep = blur_amount >> 1;
-        for( uint8_t rows = 0; rows < height; rows++) {
-            CRGB carryover = CRGB::Black;
-            for( uint8_t i = 0; i < width; i++) {
-                CRGB cur = leds[XY(i, rows)];
-                CRGB part = cur;
-                part.nscale8( seep);
-                cur.nscale8( keep);
-                cur += carryover;
-                if( i) leds[XY(i-1,rows)] += part;
-                leds[XY(i,rows)] = cur;
-                carryover = part;
-            }
-        }
+        blurMatrix(width, height).blur(leds, blur_amount, true, false, parallelPool(width * height));
+        touch(leds, width * height);
     }
     
     // blurColumns: perform a blur1d on each column of a rectangular matrix
     void blurColumns(CRGB* leds, uint8_t width, uint8_t height, fract8 blur_amount)
     {
-        // blur columns
-        uint8_t keep = 255 - blur_amount;
-        uint8_t seep = blur_amount >> 1;
-        for( uint8_t col = 0; col < width; col++) {
-            CRGB carryover = CRGB::Black;
-            for( uint8_t i = 0; i < height; i++) {
-                CRGB cur = leds[XY(col,i)];
-                CRGB part = cur;
-                part.nscale8( seep);
-                cur.nscale8( keep);
-                cur += carryover;
-                if( i) leds[XY(col,i-1)] += part;
-                leds[XY(col,i)] = cur;
-                carryover = part;
-            }
-        }
+        blurMatrix(width, height).blur(leds, blur_amount, false, true, parallelPool(width * height));
+        touch(leds, width * height);
     }
     
     
@@ -458,55 +1305,268 @@ public:
 
     
     void SetNumLeds(uint16_t num) {
-        unsigned char outMessage[20];
-        
-        NumLeds = num;
+        SetNumLeds(0, num);
+    }
+    
+    void SetNumLeds(uint8_t strip, uint16_t num) {
+        num = ledLimit(num, "SetNumLeds()");
+        if (strip)
+            stripNumLeds[strip] = num;
+        else
+            NumLeds = num;
         
+        if (sendNumLeds(strip, num) < 0)
+        {
+            puts("SetNumLeds() failed, reconnecting ...");
+            close(sock);
+            delay(1000);                // Sanity delay;
+            Connect(server);
+        }
+    }
+    
+    // FastledSetNumLeds for strip 0, so it works against any server
+    int sendNumLeds(uint8_t strip, uint16_t num) {
+        unsigned char outMessage[20];
+        unsigned int length;
         uint16_t xfer;
         
         outMessage[0] = (unsigned char) SYN;
         outMessage[1] = (unsigned char) SOH;
         outMessage[2] = (unsigned char) STX;
-        outMessage[3] = (unsigned char) FastledSetNumLeds;
+        xfer = htons(num);
+        if (strip == 0) {
+            outMessage[3] = (unsigned char) FastledSetNumLeds;
+            memcpy(&outMessage[4], &xfer, 2);
+            length = 6;
+        } else {
+            outMessage[3] = (unsigned char) FastledStripSetNumLeds;
+            outMessage[4] = strip;
+            memcpy(&outMessage[5], &xfer, 2);
+            length = 7;
+        }
+        announced |= 1 << strip;
+        return(send(sock , outMessage , length , 0) < 0 ? -1 : 0);
+    }
+    
+    // How often an unchanged frame is sent anyway, 0 sends every frame
+    void setKeepAlive(uint16_t ms) {
+        keepAlive = ms;
+    }
+    
+    // Brightness, color correction, color temperature, gamma and color order
+    // are applied on the host while encode() copies the leds into the frame,
+    // so the server just passes the bytes through to a strip set up as RGB.
+    // The server's own brightness stays at 255 unless setServerBrightness()
+    // changes it. Changing any of them sends every strip in full again.
+    //
+    // All of it is worked out with 8 bits of fraction. With setDither() on,
+    // that fraction decides how often a byte is rounded up rather than down
+    // over the next frames, so a dim led that sits between two levels
+    // shows the level in between when transfer() is called often enough.
+    void setBrightness(uint8_t scale) {
+        brightness = scale;
+        renderBrightness = maxPower_mW ? powerBrightness() : scale;
+        renderSetup();
+    }
+    
+    uint8_t getBrightness() {
+        return brightness;
+    }
+    
+    void setCorrection(const struct CRGB & c) {
+        correction = c;
+        renderSetup();
+    }
+    
+    void setTemperature(const struct CRGB & t) {
+        temperature = t;
+        renderSetup();
+    }
+    
+    void setGamma(float g) {
+        setGamma(g, g, g);
+    }
+    
+    void setGamma(float r, float g, float b) {
+        gamma[0] = r;
+        gamma[1] = g;
+        gamma[2] = b;
+        renderSetup();
+    }
+    
+    // BINARY_DITHER or DISABLE_DITHER, without dithering the fraction is rounded.
+    // Off by default: a dithered frame is different on the wire every time,
+    // so every transfer() sends all strips in full, changed or not.
+    void setDither(uint8_t mode = BINARY_DITHER) {
+        ditherMode = mode;
+        invalidate();
+    }
+    
+    // The byte order of the leds themselves, the server's strips are set up
+    // as RGB and don't reorder anything. The APA102 strips want BGR.
+    void setColorOrder(EOrder order) {
+        colorOrder = order;
+        renderSetup();
+    }
+    
+    // Keep what the leds draw within a budget, 0 for no limit. While
+    // encoding, the red, green and blue values of every strip are added up
+    // (the CRGB strips keep their sums up to date from the shadow copy, so
+    // a range costs what the range costs). After the frame is encoded,
+    // transfer() estimates the draw from them with the power model and if
+    // it is over budget lowers the brightness the wire tables are built
+    // for and encodes the frame again before it goes out. When the leds
+    // get darker the brightness goes back up, to at most what
+    // setBrightness() asked for, which is what getBrightness() returns.
+    void setMaxPowerInMilliWatts(uint32_t milliwatts) {
+        maxPower_mW = milliwatts;
+        renderBrightness = brightness;
+        renderSetup();                      // every strip goes out whole, that starts the sums over
+    }
+    
+    void setMaxPowerInVoltsAndMilliamps(uint8_t volts, uint32_t milliamps) {
+        setMaxPowerInMilliWatts(volts * milliamps);
+    }
+    
+    // mW per color and idle, defaultPowerModel is a 5V WS2812
+    void setPowerModel(const CPowerModel & model) {
+        powerModel = model;
+    }
+    
+    // estimated draw of the last frame, 0 if there is no limit
+    uint32_t getPower_mW() {
+        return power_mW;
+    }
+    
+    // the brightness the frames go out with
+    uint8_t getPowerBrightness() {
+        return renderBrightness;
+    }
+    
+    // Rebuild the wire tables. The per channel scale is the adjustment the
+    // FastLED controllers compute from brightness, correction and
+    // temperature, kept as a fraction instead of truncated to 8 bits.
+    void renderSetup() {
+        float scale[3];
+        bool unity = true;
+        
+        for (int c = 0; c < 3; c++) {
+            scale[c] = (correction.raw[c] + 1) / 256.0f * (temperature.raw[c] + 1) / 256.0f
+                * renderBrightness / 255.0f;
+            if (correction.raw[c] == 0 || temperature.raw[c] == 0)
+                scale[c] = 0;
+            unity = unity && scale[c] == 1.0f && gamma[c] == 1.0f;
+        }
+        wireOrder[0] = (colorOrder >> 6) & 0x3;
+        wireOrder[1] = (colorOrder >> 3) & 0x3;
+        wireOrder[2] = colorOrder & 0x3;
+        wireIdentity = colorOrder == RGB && unity;
+        wireExact = true;
+        for (int k = 0; k < 3; k++) {
+            int c = wireOrder[k];
+            for (int v = 0; v < 256; v++) {
+                float level = (gamma[c] == 1.0f) ? v / 255.0f : powf(v / 255.0f, gamma[c]);
+                wireTable[k][v] = (uint16_t)(level * scale[c] * (255 << 8) + 0.5f);
+                if (wireTable[k][v] & 0xff)
+                    wireExact = false;
+            }
+            // entry i is the 16 bit value i << 8, 256 the end of the last step
+            for (int i = 0; i <= 256; i++) {
+                float x = (i < 256) ? (i << 8) / 65535.0f : 1.0f;
+                float level = (gamma[c] == 1.0f) ? x : powf(x, gamma[c]);
+                wire16Table[k][i] = (uint16_t)(level * scale[c] * (255 << 8) + 0.5f);
+            }
+        }
+        // When the 8 bit leds need no dithering and every CRGB16 made from
+        // a CRGB rounds to the byte that CRGB gives, 16 bit leds are just
+        // rounded too and go out the same. Only the values in between lose
+        // the fraction dithering would have shown.
+        wire16Exact = wireExact;
+        for (int k = 0; k < 3 && wire16Exact; k++) {
+            for (int v = 0; v < 256; v++) {
+                if (((wire16Lookup(k, v * 257) + 128) >> 8) != wireTable[k][v] >> 8) {
+                    wire16Exact = false;
+                    break;
+                }
+            }
+        }
+        invalidate();
+    }
+    
+    // Forget what the server shows, the next transfer() sends everything
+    void invalidate() {
+        memset(sentNumLeds, 0, sizeof(sentNumLeds));
+        pendingShow = true;
+    }
+    
+    // The old behaviour, the server scales everything it shows by num
+    void setServerBrightness(uint8_t num) {
+        unsigned char outMessage[20];
         
-        // might have to change byte order here
+        pendingShow = true;
+        outMessage[0] = (unsigned char) SYN;
+        outMessage[1] = (unsigned char) SOH;
+        outMessage[2] = (unsigned char) STX;
+        outMessage[3] = (unsigned char) FastledSetBrightness;
+        outMessage[4] = (unsigned char) num;
         
-        xfer = htons(num);
-        memcpy(&outMessage[4], &xfer, 2);
-                
-        if( send(sock , outMessage , 6 , 0) < 0)
+        if( send(sock , outMessage , 5 , 0) < 0)
         {
-            puts("SetNumLeds() failed, reconnecting ...");
+            puts("setServerBrightness() failed, reconnecting ...");
             close(sock);
             delay(1000);                // Sanity delay;
             Connect(server);
         }
+        
+    }
 
+    
+    // Nothing to show if neither the frame nor the brightness changed.
+    // Ends the frame of frame_clock_begin() either way.
+    void show() {
+        frame_clock_end();
+        showAll();
     }
     
-    void setBrightness(uint8_t num) {
+    // show a single strip, the plain show() updates all of them. The frame
+    // goes on, the other strips may still be drawn with the same clock.
+    void show(uint8_t strip) {
         unsigned char outMessage[20];
         
+        if (strip == STRIP_ALL) {
+            show();
+            return;
+        }
+        if (strip >= numStrips)
+            return;
+        if (!(codecs & CODEC_STRIPS)) {
+            showAll();
+            return;
+        }
+        
         outMessage[0] = (unsigned char) SYN;
         outMessage[1] = (unsigned char) SOH;
         outMessage[2] = (unsigned char) STX;
-        outMessage[3] = (unsigned char) FastledSetBrightness;
-        outMessage[4] = (unsigned char) num;
+        outMessage[3] = (unsigned char) FastledStripShow;
+        outMessage[4] = strip;
         
         if( send(sock , outMessage , 5 , 0) < 0)
         {
-            puts("setBrightness() failed, reconnecting ...");
+            puts("show() command failed, reconnecting ...");
             close(sock);
             delay(1000);                // Sanity delay;
             Connect(server);
         }
-        
     }
-
     
-    void show() {
+    // tell the server to show all strips, if anything changed
+    void showAll() {
         unsigned char outMessage[20];
         
+        if (!pendingShow)
+            return;
+        pendingShow = false;
+        
         outMessage[0] = (unsigned char) SYN;
         outMessage[1] = (unsigned char) SOH;
         outMessage[2] = (unsigned char) STX;
@@ -523,47 +1583,520 @@ public:
         
     }
     
-    void transfer() {
-        unsigned char header;
+    // Dither offset of the first byte of led first, and how far it moves
+    // from one byte to the next. Without dithering 128 just rounds.
+    void ditherOffset(uint16_t first, bool active, uint8_t *offset, uint8_t *step) {
+        if (!active || ditherMode != BINARY_DITHER) {
+            *offset = 128;
+            *step = 0;
+            return;
+        }
+        // the frame count bit reversed, so the offsets of successive
+        // frames are spread out over the whole byte
+        uint8_t o = ditherFrame;
+        o = (o & 0xf0) >> 4 | (o & 0x0f) << 4;
+        o = (o & 0xcc) >> 2 | (o & 0x33) << 2;
+        o = (o & 0xaa) >> 1 | (o & 0x55) << 1;
+        *offset = o + first * 3 * DITHER_STEP;
+        *step = DITHER_STEP;
+    }
+    
+    // Add the red, green and blue of n leds to sum, and unless the shadow
+    // copy is new take off what it had for them
+    void powerSum(const CRGB *l, const CRGB *sent, uint16_t n, uint32_t *sum, bool whole) {
+        uint32_t old[3] = { 0, 0, 0 };
+        
+        bulk_sum8x3((const uint8_t *)l, n, sum);
+        if (whole)
+            return;
+        bulk_sum8x3((const uint8_t *)sent, n, old);
+        for (int c = 0; c < 3; c++)
+            sum[c] -= old[c];
+    }
+    
+    // Copy count leds to the wire as the server should show them, and to
+    // the shadow copy as they are, in a single pass. first is where they
+    // start in the strip, so every led keeps its dither offset. If sum is
+    // given it follows the change, block by block while the leds are in
+    // the cache anyway.
+    void render(const CRGB *l, uint16_t first, uint16_t count, unsigned char *wire, CRGB *sent,
+                uint32_t *sum, bool whole) {
+        uint16_t block[RENDER_BLOCK * 3];
+        uint8_t offset, step;
+        
+        if (wireIdentity) {
+            for (uint16_t i = 0; i < count; i += RENDER_BLOCK) {
+                uint16_t n = (count - i < RENDER_BLOCK) ? count - i : RENDER_BLOCK;
+                if (sum)
+                    powerSum(l + i, sent + i, n, sum, whole);
+                memcpy(wire + i * 3, l + i, n * 3);
+                memcpy((void *)(sent + i), l + i, n * sizeof(CRGB));
+            }
+            return;
+        }
+        ditherOffset(first, !wireExact, &offset, &step);
+        
+        const uint16_t *t0 = wireTable[0], *t1 = wireTable[1], *t2 = wireTable[2];
+        uint8_t o0 = wireOrder[0], o1 = wireOrder[1], o2 = wireOrder[2];
+        for (uint16_t i = 0; i < count; i += RENDER_BLOCK) {
+            uint16_t n = (count - i < RENDER_BLOCK) ? count - i : RENDER_BLOCK;
+            if (sum)
+                powerSum(l + i, sent + i, n, sum, whole);
+            for (uint16_t j = 0; j < n; j++) {
+                CRGB c = l[i + j];
+                sent[i + j] = c;
+                block[j * 3] = t0[c.raw[o0]];
+                block[j * 3 + 1] = t1[c.raw[o1]];
+                block[j * 3 + 2] = t2[c.raw[o2]];
+            }
+            bulk_dither16(block, wire, n * 3, offset, step);
+            wire += n * 3;
+            offset += n * 3 * step;
+        }
+    }
+    
+    // Color planes, interleaved in wire order on the way. With sum the
+    // planes are added to it.
+    void renderPlanar(const CPlanarLeds *p, uint16_t first, uint16_t count, unsigned char *wire, uint32_t *sum) {
+        uint16_t block[RENDER_BLOCK * 3];
+        uint8_t offset, step;
+        const uint8_t *s0 = p->planes[wireOrder[0]] + first;
+        const uint8_t *s1 = p->planes[wireOrder[1]] + first;
+        const uint8_t *s2 = p->planes[wireOrder[2]] + first;
+        
+        if (wireIdentity) {
+            if (sum) {
+                sum[wireOrder[0]] += bulk_sum8(s0, count);
+                sum[wireOrder[1]] += bulk_sum8(s1, count);
+                sum[wireOrder[2]] += bulk_sum8(s2, count);
+            }
+            for (uint16_t i = 0; i < count; i++, wire += 3) {
+                wire[0] = s0[i];
+                wire[1] = s1[i];
+                wire[2] = s2[i];
+            }
+            return;
+        }
+        ditherOffset(first, !wireExact, &offset, &step);
+        for (uint16_t i = 0; i < count; i += RENDER_BLOCK) {
+            uint16_t n = (count - i < RENDER_BLOCK) ? count - i : RENDER_BLOCK;
+            if (sum) {
+                sum[wireOrder[0]] += bulk_sum8(s0 + i, n);
+                sum[wireOrder[1]] += bulk_sum8(s1 + i, n);
+                sum[wireOrder[2]] += bulk_sum8(s2 + i, n);
+            }
+            for (uint16_t j = 0; j < n; j++) {
+                block[j * 3] = wireTable[0][s0[i + j]];
+                block[j * 3 + 1] = wireTable[1][s1[i + j]];
+                block[j * 3 + 2] = wireTable[2][s2[i + j]];
+            }
+            bulk_dither16(block, wire, n * 3, offset, step);
+            wire += n * 3;
+            offset += n * 3 * step;
+        }
+    }
+    
+    // The high byte of v picks a step of wire16Table, the low byte how far
+    // along that step it is
+    uint16_t wire16Lookup(int k, uint16_t v) {
+        const uint16_t *t = &wire16Table[k][v >> 8];
+        return t[0] + (((uint32_t)(t[1] - t[0]) * (v & 0xff)) >> 8);
+    }
+    
+    // The same for 16 bit leds, which have a fraction to dither unless
+    // wire16Exact. sum gets the high bytes.
+    void render16(const CRGB16 *l, uint16_t first, uint16_t count, unsigned char *wire, uint32_t *sum) {
+        uint16_t block[RENDER_BLOCK * 3];
+        uint32_t high[3] = { 0, 0, 0 };
+        uint8_t offset, step;
+        
+        ditherOffset(first, !wire16Exact, &offset, &step);
+        for (uint16_t i = 0; i < count; i += RENDER_BLOCK) {
+            uint16_t n = (count - i < RENDER_BLOCK) ? count - i : RENDER_BLOCK;
+            for (uint16_t j = 0; j < n; j++) {
+                for (int k = 0; k < 3; k++) {
+                    uint16_t v = l[i + j].raw[wireOrder[k]];
+                    block[j * 3 + k] = wire16Lookup(k, v);
+                    high[k] += v >> 8;
+                }
+            }
+            bulk_dither16(block, wire, n * 3, offset, step);
+            wire += n * 3;
+            offset += n * 3 * step;
+        }
+        if (sum)
+            for (int k = 0; k < 3; k++)
+                sum[wireOrder[k]] += high[k];
+    }
+    
+    void renderPlanar16(const CPlanarLeds16 *p, uint16_t first, uint16_t count, unsigned char *wire, uint32_t *sum) {
+        uint16_t block[RENDER_BLOCK * 3];
+        uint32_t high[3] = { 0, 0, 0 };
+        uint8_t offset, step;
+        
+        ditherOffset(first, !wire16Exact, &offset, &step);
+        for (uint16_t i = 0; i < count; i += RENDER_BLOCK) {
+            uint16_t n = (count - i < RENDER_BLOCK) ? count - i : RENDER_BLOCK;
+            for (int k = 0; k < 3; k++) {
+                const uint16_t *src = p->planes[wireOrder[k]] + first + i;
+                for (uint16_t j = 0; j < n; j++) {
+                    block[j * 3 + k] = wire16Lookup(k, src[j]);
+                    high[k] += src[j] >> 8;
+                }
+            }
+            bulk_dither16(block, wire, n * 3, offset, step);
+            wire += n * 3;
+            offset += n * 3 * step;
+        }
+        if (sum)
+            for (int k = 0; k < 3; k++)
+                sum[wireOrder[k]] += high[k];
+    }
+    
+    // Encode count leds of a strip, starting at start, into out[].
+    // Returns the number of bytes written. A whole strip 0 goes out as a
+    // legacy frame, so it works against any server.
+    unsigned int encode(uint8_t strip, uint16_t start, uint16_t count, unsigned char *out) {
         unsigned int  outLength2;
-        unsigned char rleMessage2[6000], outMessage[6100];
-        unsigned char *rleMessage = { };
+        unsigned int  maxLength2;
+        unsigned char rleMessage2[FASTLED_MAX_FRAME];
         unsigned int outLength;
+        unsigned int pos;
+        unsigned int headerPos;
         uint16_t numBytes;              // How long is the message?
         uint16_t xfer;
-        
-        RleEncodePass2((unsigned char *)leds, NumLeds*3, rleMessage2, &outLength2);
-        //Send the data
-        if ( (NumLeds*3) < outLength2){
-            header = UNCOMPRESSED;
-            rleMessage = (unsigned char *)leds;
-            outLength = NumLeds*3;
+        out[0] = (unsigned char) SYN;
+        out[1] = (unsigned char) SOH;
+        out[2] = (unsigned char) STX;
+        if (start != 0 || count != storeSize(strip)) {
+            out[3] = (unsigned char) FastledRange;
+            out[4] = strip;
+            xfer = htons(start);
+            memcpy(&out[5], &xfer, 2);
+            xfer = htons(count);
+            memcpy(&out[7], &xfer, 2);
+            headerPos = 9;
+        } else if (strip == 0) {
+            headerPos = 3;
         } else {
-            header = PHASE2;
-            rleMessage = rleMessage2;
+            out[3] = (unsigned char) FastledStripPixels;
+            out[4] = strip;
+            headerPos = 5;
+        }
+        pos = headerPos + 3;
+        
+        // the power sums start over with a whole strip, a range of a CRGB
+        // strip changes them by what the shadow copy had, a range of
+        // anything else leaves them for the next time it goes out whole
+        bool whole = start == 0 && count == storeSize(strip);
+        uint32_t *sum = maxPower_mW ? ledSum[strip] : NULL;
+        if (sum && whole)
+            memset(sum, 0, sizeof(ledSum[strip]));
+        if (!whole && wholeStrip(strip))
+            sum = NULL;
+        
+        // the pixels go straight to where an uncompressed frame has them,
+        // remembering what the server has now on the way
+        if (store16[strip])
+            render16(store16[strip] + start, start, count, &out[pos], sum);
+        else if (planar[strip])
+            renderPlanar(planar[strip], start, count, &out[pos], sum);
+        else if (planar16[strip])
+            renderPlanar16(planar16[strip], start, count, &out[pos], sum);
+        else
+            render(store(strip) + start, start, count, &out[pos], &sentLeds[strip][start], sum, whole);
+        
+        out[headerPos] = UNCOMPRESSED;
+        outLength = count*3;
+        // RLE only pays off if it is shorter and fits the server's buffer
+        maxLength2 = count*3 - 1;
+        if (maxLength2 > peerMaxFrame)
+            maxLength2 = peerMaxFrame;
+        if (maxLength2 > sizeof(rleMessage2))
+            maxLength2 = sizeof(rleMessage2);
+        if ((codecs & CODEC_PHASE2) &&
+            RleEncodePass2(&out[pos], count*3, rleMessage2, &outLength2, maxLength2) == 0) {
+            out[headerPos] = PHASE2;
             outLength = outLength2;
+            memcpy(&out[pos], rleMessage2, outLength);
         }
-        outMessage[0] = (unsigned char) SYN;
-        outMessage[1] = (unsigned char) SOH;
-        outMessage[2] = (unsigned char) STX;
-        outMessage[3] = header;
         numBytes = outLength;
         xfer = htons(numBytes);
-        memcpy(&outMessage[4], &xfer, 2);
+        memcpy(&out[headerPos + 1], &xfer, 2);
+        
+        return(pos + outLength);
+    }
+    
+    // Find the span of a strip that changed since it was last sent.
+    // Returns false if nothing changed.
+    bool dirtyRange(uint8_t strip, uint16_t *start, uint16_t *count) {
+        CRGB *l = store(strip);
+        uint16_t num = storeSize(strip);
+        uint16_t first = 0;
+        uint16_t last = num;
+        
+        if (sentNumLeds[strip] != num) {
+            // first transfer, or the strip changed size: send all of it
+            delete[] sentLeds[strip];
+            sentLeds[strip] = new CRGB[num];
+            sentNumLeds[strip] = num;
+            *start = 0;
+            *count = num;
+            return(num != 0);
+        }
+        
+        CRGB *sent = sentLeds[strip];
+        while (first < num && l[first] == sent[first]) first++;
+        if (first == num)
+            return(false);
+        while (last > first && l[last-1] == sent[last-1]) last--;
+        
+        *start = first;
+        *count = last - first;
+        return(true);
+    }
+    
+    // Encode the dirty chunks of a tracked strip, each run of dirty chunks
+    // trimmed to what really changed. Returns the number of bytes written.
+    unsigned int encodeTracked(uint8_t strip, unsigned char *out) {
+        CTrackedLeds *t = tracked[strip];
+        CRGB *sent = sentLeds[strip];
+        uint16_t num = storeSize(strip);    // the server may take fewer than t has
+        unsigned int outLength = 0;
+        uint16_t chunk = 0;
+        uint16_t run;
         
-        memcpy(&outMessage[6], rleMessage, outLength );                         // send packet identifier
-        if( send(sock , outMessage , outLength + 6 , 0) < 0)
+        while (t->nextDirty(&chunk, &run)) {
+            uint16_t start = chunk << TRACK_CHUNK_SHIFT;
+            uint16_t end = (chunk + run) << TRACK_CHUNK_SHIFT;
+            if (end > num)
+                end = num;
+            chunk += run;
+            
+            while (start < end && t->leds[start] == sent[start]) start++;
+            while (end > start && t->leds[end-1] == sent[end-1]) end--;
+            if (start >= end)
+                continue;
+            
+            if (!(codecs & CODEC_RANGE)) {
+                // no partial updates, any change means the whole strip
+                t->clear();
+                return(encode(strip, 0, num, out));
+            }
+            outLength += encode(strip, start, end - start, &out[outLength]);
+        }
+        t->clear();
+        return(outLength);
+    }
+    
+    // Send all registered strips in a single write, only the parts that
+    // changed since the last transfer if the server knows FastledRange.
+    // A frame that hashes the same as the last one is skipped altogether,
+    // except for a full refresh every keepAlive ms. While dithering every
+    // frame is different on the wire and goes out in full.
+    void transfer() {
+        unsigned char *outMessage = frameBuffer();
+        unsigned int outLength;
+        bool dither = ditherMode == BINARY_DITHER && !wireExact && !wireIdentity;
+        bool refresh = dither || (uint32_t)(millis() - lastTransfer) >= keepAlive;
+        
+        if (outMessage == NULL)
+            return;
+        if (ditherMode == BINARY_DITHER)
+            ditherFrame++;
+        if (compositor)
+            compositor->compose();
+        
+        outLength = encodeFrame(outMessage, refresh);
+        if (outLength && maxPower_mW && limitPower())
+            outLength = encodeFrame(outMessage, true);  // too bright, all of it again
+        
+        if (outLength == 0)
+            return;
+        lastTransfer = millis();
+        pendingShow = true;
+        sendMessage(outMessage, outLength, "transfer()");
+    }
+    
+    // Room for the most encodeFrame() can make of the strips as they are
+    // now, every led of every strip and a range header for every chunk of
+    // a tracked one. NULL if there is no memory for it.
+    unsigned char *frameBuffer() {
+        unsigned int size = 0;
+        
+        for (uint8_t strip = 0; strip < numStrips; strip++) {
+            unsigned int ranges = tracked[strip] ? (storeSize(strip) >> TRACK_CHUNK_SHIFT) + 1 : 1;
+            size += storeSize(strip) * 3 + ranges * 12;
+        }
+        if (size > frameSize) {
+            unsigned char *f = (unsigned char *)realloc(frame, size);
+            if (f == NULL) {
+                puts("transfer() out of memory");
+                return(NULL);
+            }
+            frame = f;
+            frameSize = size;
+        }
+        return(frame);
+    }
+    
+    // Encode what transfer() sends into out[], returns the number of bytes
+    unsigned int encodeFrame(unsigned char *outMessage, bool refresh) {
+        unsigned int outLength = 0;
+        uint8_t strips = (codecs & CODEC_STRIPS) ? numStrips : 1;
+        uint16_t start, count;
+        
+        for (uint8_t strip = 0; strip < strips; strip++) {
+            if (wholeStrip(strip)) {
+                // no shadow to find the changes in, all or nothing
+                uint16_t num = storeSize(strip);
+                uint64_t hash = wholeHash(strip);
+                bool moving = !planar[strip] && ditherMode == BINARY_DITHER && !wire16Exact;   // 16 bits dither
+                if (!refresh && !moving && sentNumLeds[strip] == num && hash == sentHash[strip])
+                    continue;
+                sentHash[strip] = hash;
+                sentNumLeds[strip] = num;
+                if (num)
+                    outLength += encode(strip, 0, num, &outMessage[outLength]);
+                continue;
+            }
+            if (tracked[strip] && !refresh && sentNumLeds[strip] == storeSize(strip)) {
+                outLength += encodeTracked(strip, &outMessage[outLength]);
+                continue;
+            }
+            if (tracked[strip])
+                tracked[strip]->clear();    // about to send all of it
+            
+            uint64_t hash = hash64(store(strip), storeSize(strip) * 3, 0);
+            
+            if (!refresh && sentNumLeds[strip] == storeSize(strip) && hash == sentHash[strip])
+                continue;                   // same frame as last time
+            
+            bool dirty = dirtyRange(strip, &start, &count);
+            sentHash[strip] = hash;
+            if (refresh) {
+                start = 0;
+                count = storeSize(strip);
+            } else if (!dirty) {
+                continue;
+            }
+            if (!(codecs & CODEC_RANGE)) {
+                start = 0;
+                count = storeSize(strip);
+            }
+            if (count == 0)
+                continue;
+            outLength += encode(strip, start, count, &outMessage[outLength]);
+        }
+        return(outLength);
+    }
+    
+    // The brightness the power budget allows for what the strips show,
+    // going by the sums encode() keeps. Correction and temperature are
+    // taken into account, gamma is not.
+    uint8_t powerBrightness() {
+        uint8_t strips = (codecs & CODEC_STRIPS) ? numStrips : 1;
+        uint32_t sum[3] = { 0, 0, 0 };
+        uint32_t num = 0;
+        
+        for (uint8_t strip = 0; strip < strips; strip++) {
+            for (int c = 0; c < 3; c++)
+                sum[c] += ledSum[strip][c];
+            num += storeSize(strip);
+        }
+        for (int c = 0; c < 3; c++) {
+            uint32_t scale = (correction.raw[c] + 1) * (temperature.raw[c] + 1);
+            if (correction.raw[c] == 0 || temperature.raw[c] == 0)
+                scale = 0;
+            sum[c] = ((uint64_t)sum[c] * scale) >> 16;
+        }
+        uint32_t full = calculate_unscaled_power_mW(sum, num, powerModel);
+        uint8_t b = max_brightness_for_power_mW(full, brightness, maxPower_mW);
+        power_mW = ((uint64_t)full * b) / 256;
+        return(b);
+    }
+    
+    // Move renderBrightness to what the budget allows. Returns true if it
+    // went down, the frame just encoded is then too bright. Going up it
+    // waits until it can go up by POWER_STEP, or all the way, rather than
+    // sending everything again every frame for one step more or less.
+    bool limitPower() {
+        uint8_t b = powerBrightness();
+        
+        if (b == renderBrightness)
+            return(false);
+        if (b > renderBrightness && b < brightness && b - renderBrightness < POWER_STEP)
+            return(false);
+        bool lower = b < renderBrightness;
+        renderBrightness = b;
+        renderSetup();
+        return(lower);
+    }
+    
+    // Send count leds of a strip starting at start, whether they changed or not
+    void transferRange(uint16_t start, uint16_t count, uint8_t strip = 0) {
+        unsigned char *outMessage;
+        uint16_t num;
+        uint16_t first, dirty;
+        
+        if (strip >= numStrips || (strip && !(codecs & CODEC_STRIPS)))
+            return;
+        num = storeSize(strip);
+        if (start >= num)
+            return;
+        if (count > num - start)
+            count = num - start;
+        
+        if (!wholeStrip(strip) && dirtyRange(strip, &first, &dirty) && dirty == num) {
+            // server has never seen this strip, the span alone won't do
+            start = 0;
+            count = num;
+        }
+        if (!(codecs & CODEC_RANGE)) {
+            start = 0;
+            count = num;
+        }
+        outMessage = frameBuffer();
+        if (outMessage == NULL)
+            return;
+        pendingShow = true;
+        unsigned int outLength = encode(strip, start, count, outMessage);
+        if (maxPower_mW && limitPower()) {
+            // too bright, and so is everything sent before at the old
+            // brightness: all strips again, which also keeps the hashes
+            outLength = encodeFrame(outMessage, true);
+            lastTransfer = millis();
+            sendMessage(outMessage, outLength, "transferRange()");
+            return;
+        }
+        
+        // the hash transfer() skips unchanged frames by has to be of what
+        // the server shows now, not of what it showed before the range
+        if (!wholeStrip(strip)) {
+            sentHash[strip] = hash64(sentLeds[strip], num * 3, 0);
+        } else if (start == 0 && count == num) {
+            sentHash[strip] = wholeHash(strip);
+            sentNumLeds[strip] = num;
+        } else {
+            sentNumLeds[strip] = 0;         // no shadow to hash, send it whole next time
+        }
+        sendMessage(outMessage, outLength, "transferRange()");
+    }
+    
+    void sendMessage(unsigned char *outMessage, unsigned int outLength, const char *caller) {
+        if( send(sock , outMessage , outLength , 0) < 0)
         {
-            puts("transfer() failed, reconnecting...");
+            printf("%s failed, reconnecting...\n", caller);
             close(sock);
             delay(1000);                // Sanity delay;
             Connect(server);
         }
-        
-        
-        
     }
     
+private:
+    // owns the frame buffer, the shadow copies and the thread pool
+    NetworkLed(const NetworkLed &);
+    NetworkLed & operator= (const NetworkLed &);
 };
 
 
@@ -15,6 +15,12 @@
 #define FastledShow             5           // Execute the show()
 #define FastledSetBrightness    6
 #define FastledSetNumLeds       11
+#define FastledHello            12          // host -> server, start of the capability handshake
+#define FastledCaps             13          // server -> host, answer to FastledHello
+#define FastledStripPixels      14          // strip id, encoding, then UNCOMPRESSED/PHASE2 payload
+#define FastledStripSetNumLeds  15          // strip id, number of leds
+#define FastledStripShow        16          // strip id or STRIP_ALL
+#define FastledRange            17          // strip id, start, count, encoding, then UNCOMPRESSED/PHASE2 payload
 
 #define SYN                     0x16
 #define SOH                     0x01
@@ -22,5 +28,29 @@
 #define ETX                     0x03
 #define DELIM                   0x20
 
+// Capability handshake
+// HELLO and CAPS carry the same payload after the command byte:
+//   version (1 byte), codecs (2 bytes), max frame (2 bytes), number of leds (2 bytes)
+// from version 2 on followed by the number of strips (1 byte), which is
+// only sent to a peer of version 2 or later.
+// all multi byte values in network byte order.
+// A server that never answers the HELLO is treated as protocol version 0,
+// which only knows UNCOMPRESSED and PHASE2.
+#define FASTLED_PROTOCOL_VERSION    2
+#define FASTLED_MAX_FRAME           6000    // largest encoded payload a peer has to buffer
+#define FASTLED_MAX_LEDS            3000
+
+// codec bits, reported in HELLO/CAPS
+#define CODEC_UNCOMPRESSED      0x0001
+#define CODEC_PHASE2            0x0002
+#define CODEC_STRIPS            0x0004      // FastledStrip* commands, several strips on one connection
+#define CODEC_RANGE             0x0008      // FastledRange, partial strip updates
+
+// Strip addressing
+// Strip 0 is what the legacy commands talk to, so a host that never
+// registers more than one strip keeps sending the old frames.
+#define FASTLED_MAX_STRIPS      8
+#define STRIP_ALL               0xff
+
 
 #endif /* FastledDefinitions_h */
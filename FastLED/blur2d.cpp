@@ -0,0 +1,193 @@
+//
+//  blur2d.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#include <stdio.h>          // puts
+#include <stdlib.h>         // malloc
+#include <string.h>         // memcpy
+
+#include "FastLED.hpp"
+#include "blur2d.h"
+#include "bulk8.h"
+
+// blur1d on a line works out to
+//     out[i] = qadd8(qadd8(scale8(in[i], keep), part[i-1]), part[i+1])
+// with part[i] = scale8(in[i], seep) and nothing beyond either end, all
+// taken from the values before the pass. bulk_blur8() computes exactly
+// that for three arrays, so every pass below just has to line up the
+// right original values and feed zeros at the edges.
+
+CBlur2d::CBlur2d(void)
+{
+    width = 0;
+    height = 0;
+    xy = NULL;
+    rowMajor = true;
+    source = NULL;
+    work = NULL;
+}
+
+CBlur2d::~CBlur2d(void)
+{
+    free(xy);
+    free(work);
+}
+
+bool CBlur2d::resize(uint16_t w, uint16_t h)
+{
+    uint32_t num = (uint32_t)w * h;
+
+    free(work);
+    work = NULL;
+    rowMajor = true;
+    source = NULL;
+    free(xy);
+    xy = num ? (uint16_t *)malloc(num * sizeof(uint16_t)) : NULL;
+    if (num && !xy) {
+        puts("CBlur2d::resize() out of memory");
+        width = 0;
+        height = 0;
+        return(false);
+    }
+    width = w;
+    height = h;
+    for (uint32_t i = 0; i < num; i++)
+        xy[i] = i;
+    return(true);
+}
+
+bool CBlur2d::mapped(const void *from)
+{
+    uint32_t num = (uint32_t)width * height;
+
+    source = from;
+    rowMajor = true;
+    for (uint32_t i = 0; i < num && rowMajor; i++)
+        rowMajor = (xy[i] == i);
+    if (!rowMajor && !work)
+        work = (CRGB *)malloc(num * sizeof(CRGB));
+    if (!rowMajor && !work) {
+        puts("CBlur2d::mapped() out of memory");
+        source = NULL;              // try again next time
+        return(false);
+    }
+    return(true);
+}
+
+void CBlur2d::blur(CRGB *leds, fract8 blur_amount, bool rows, bool columns, CThreadPool *pool)
+{
+    uint32_t num = (uint32_t)width * height;
+    uint8_t keep = 255 - blur_amount;
+    uint8_t seep = blur_amount >> 1;
+    CRGB *m = leds;
+
+    if (!rowMajor && !work)
+        return;                     // mapped() ran out of memory
+    if (!pool || pool->size() < 2) {
+        if (!rowMajor) {
+            m = work;
+            for (uint32_t i = 0; i < num; i++)
+                m[i] = leds[xy[i]];
+        }
+        if (rows)
+            blurRows(m, keep, seep, 0, height);
+        if (columns)
+            blurColumns(m, keep, seep, 0, width);
+        if (!rowMajor) {
+            for (uint32_t i = 0; i < num; i++)
+                leds[xy[i]] = m[i];
+        }
+        return;
+    }
+
+    // the same steps, each one spread over the pool
+    if (!rowMajor) {
+        m = work;
+        auto gather = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+                m[i] = leds[xy[i]];
+        };
+        pool->run(num, gather);
+    }
+    if (rows) {
+        auto blurSome = [&](uint32_t begin, uint32_t end) {
+            blurRows(m, keep, seep, begin, end);
+        };
+        pool->run(height, blurSome, 1);
+    }
+    if (columns) {
+        auto blurSome = [&](uint32_t begin, uint32_t end) {
+            uint32_t last = end * BLUR_STRIPE;
+            blurColumns(m, keep, seep, begin * BLUR_STRIPE, (last < width) ? last : width);
+        };
+        pool->run((width + BLUR_STRIPE - 1) / BLUR_STRIPE, blurSome, 1);
+    }
+    if (!rowMajor) {
+        auto scatter = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+                leds[xy[i]] = m[i];
+        };
+        pool->run(num, scatter);
+    }
+}
+
+// Each row is copied a tile at a time between the pixel left of it, as
+// it was before the last tile overwrote it, and the one right of it,
+// which is still untouched, black beyond the ends. Then it is blurred
+// back into place with its left and right neighbours as before and after.
+void CBlur2d::blurRows(CRGB *m, uint8_t keep, uint8_t seep, uint16_t first, uint16_t last)
+{
+    uint8_t scratch[(BLUR_TILE + 2) * 3];
+
+    for (uint16_t y = first; y < last; y++) {
+        uint8_t *row = (uint8_t *)&m[(uint32_t)y * width];
+
+        for (uint32_t x = 0; x < width; x += BLUR_TILE) {
+            unsigned int n = (width - x < BLUR_TILE) ? width - x : BLUR_TILE;
+
+            if (x == 0)
+                memset(scratch, 0, 3);
+            else
+                memcpy(scratch, scratch + BLUR_TILE * 3, 3);    // last pixel of the tile before
+            memcpy(scratch + 3, row + x * 3, n * 3);
+            if (x + n < width)
+                memcpy(scratch + 3 + n * 3, row + (x + n) * 3, 3);
+            else
+                memset(scratch + 3 + n * 3, 0, 3);
+            bulk_blur8(row + x * 3, scratch + 3, scratch, scratch + 6, n * 3, keep, seep);
+        }
+    }
+}
+
+// A tile of columns is walked top to bottom. The row below is still
+// untouched when we get to a row, the row above we saved before
+// overwriting it.
+void CBlur2d::blurColumns(CRGB *m, uint8_t keep, uint8_t seep, uint16_t first, uint16_t last)
+{
+    uint8_t scratch[3 * BLUR_TILE * 3];
+    uint8_t *zero = scratch + 2 * BLUR_TILE * 3;
+
+    memset(zero, 0, BLUR_TILE * 3);
+    for (uint32_t x = first; x < last; x += BLUR_TILE) {
+        unsigned int bytes = ((last - x < BLUR_TILE) ? last - x : BLUR_TILE) * 3;
+        uint8_t *above = scratch;
+        uint8_t *orig = scratch + BLUR_TILE * 3;
+
+        memset(above, 0, bytes);
+        for (uint16_t y = 0; y < height; y++) {
+            uint8_t *row = (uint8_t *)&m[(uint32_t)y * width + x];
+            const uint8_t *below = (y + 1 < height) ? row + width * 3 : zero;
+
+            memcpy(orig, row, bytes);
+            bulk_blur8(row, orig, above, below, bytes, keep, seep);
+
+            uint8_t *t = above;
+            above = orig;
+            orig = t;
+        }
+    }
+}
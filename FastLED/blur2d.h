@@ -0,0 +1,68 @@
+//
+//  blur2d.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef blur2d_h
+#define blur2d_h
+
+#include <stdint.h>
+
+#include "lib8tion.h"
+#include "pixeltypes.h"
+#include "threadpool.h"
+
+///@file blur2d.h
+/// blur filter for led matrices of up to 65535 leds
+
+#define BLUR_TILE   128             // leds per tile of a row or of columns, 3 tile rows stay in L1
+#define BLUR_STRIPE 16              // columns per unit of work when blurring in parallel
+
+/// Blurs a width x height matrix the same way blurRows()/blurColumns()
+/// do, but without calling XY() for every pixel.
+///
+/// xy[y * width + x] holds the led index of (x, y). Fill it once after
+/// resize() and call mapped(). If it is the plain row-major layout the
+/// leds are blurred in place, otherwise they are gathered into a
+/// row-major work copy first and scattered back afterwards.
+/// The rows are then blurred one at a time, the columns a tile of
+/// BLUR_TILE columns at a time, going down row by row so every access
+/// is sequential. The mapping is expected to be one to one.
+/// Rows go a tile at a time too, so the scratch of either pass is a
+/// few hundred bytes on the stack, also on the threads of a pool that
+/// the rows, and stripes of columns, are spread over.
+/// The led indexes are 16 bits, width * height must not be above 65535.
+class CBlur2d {
+public:
+    uint16_t width;
+    uint16_t height;
+    uint16_t *xy;                   // led index of every (x, y)
+    bool rowMajor;                  // xy is the identity
+    const void *source;             // what xy was filled from, given to mapped(), NULL after resize()
+
+    CBlur2d(void);
+    ~CBlur2d(void);
+
+    // set the matrix size, xy becomes the row-major layout. false if
+    // there is no memory for it, the matrix is 0 x 0 then.
+    bool resize(uint16_t w, uint16_t h);
+
+    // call after changing xy, from tells where the mapping came from.
+    // false if a layout that isn't row-major gets no work copy, blur()
+    // does nothing then.
+    bool mapped(const void *from = NULL);
+
+    void blur(CRGB *leds, fract8 blur_amount, bool rows = true, bool columns = true,
+              CThreadPool *pool = NULL);
+
+private:
+    CRGB *work;                     // row-major copy for other layouts
+
+    void blurRows(CRGB *m, uint8_t keep, uint8_t seep, uint16_t first, uint16_t last);
+    void blurColumns(CRGB *m, uint8_t keep, uint8_t seep, uint16_t first, uint16_t last);
+};
+
+#endif /* blur2d_h */
@@ -0,0 +1,1536 @@
+//
+//  bulk8.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>         // memset
+
+#include "lib8tion.h"
+#include "bulk8.h"
+
+#if !defined(FASTLED_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BULK8_X86
+#include <immintrin.h>
+#elif !defined(FASTLED_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define BULK8_NEON
+#include <arm_neon.h>
+#endif
+
+// The vector versions all work the same way: widen 8 or 16 bytes to
+// 16 bit lanes, multiply by the scale, keep the high byte and pack back.
+// That is exactly ((uint16_t)i * scale) >> 8, so they match scale8()
+// bit for bit. scale8_video adds 1 to every lane that was non zero,
+// the scale == 0 case is handled before we get here.
+
+/***************************************************************************
+ *   plain C, also does the tails the vector loops leave over
+ ***************************************************************************/
+
+static void scale8_c(uint8_t *p, unsigned int count, uint8_t scale)
+{
+    for (unsigned int i = 0; i < count; i++)
+        p[i] = scale8(p[i], scale);
+}
+
+static void scale8_video_c(uint8_t *p, unsigned int count, uint8_t scale)
+{
+    for (unsigned int i = 0; i < count; i++)
+        p[i] = scale8_video(p[i], scale);
+}
+
+static void scale8x3_c(uint8_t *p, unsigned int num_leds, uint8_t r, uint8_t g, uint8_t b)
+{
+    for (unsigned int i = 0; i < num_leds; i++, p += 3) {
+        p[0] = scale8(p[0], r);
+        p[1] = scale8(p[1], g);
+        p[2] = scale8(p[2], b);
+    }
+}
+
+// same sum as nblend() on a CRGB: the two scaled parts never add up
+// to more than 254, so there is nothing to saturate
+static void blend8_c(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count, uint8_t amount)
+{
+    uint8_t keep = 255 - amount;
+
+    for (unsigned int i = 0; i < count; i++)
+        out[i] = scale8_LEAVING_R1_DIRTY(a[i], keep) + scale8_LEAVING_R1_DIRTY(b[i], amount);
+    cleanup_R1();
+}
+
+static void blur8_c(uint8_t *out, const uint8_t *in, const uint8_t *before, const uint8_t *after,
+                    unsigned int count, uint8_t keep, uint8_t seep)
+{
+    for (unsigned int i = 0; i < count; i++)
+        out[i] = qadd8(qadd8(scale8(in[i], keep), scale8(before[i], seep)), scale8(after[i], seep));
+}
+
+static void scale16_c(uint16_t *p, unsigned int count, fract16 scale)
+{
+    for (unsigned int i = 0; i < count; i++)
+        p[i] = scale16(p[i], scale);
+}
+
+// as in blend8_c the two parts add up to less than 0xffff
+static void blend16_c(const uint16_t *a, const uint16_t *b, uint16_t *out, unsigned int count, fract16 amount)
+{
+    fract16 keep = 65535 - amount;
+
+    for (unsigned int i = 0; i < count; i++)
+        out[i] = scale16(a[i], keep) + scale16(b[i], amount);
+}
+
+static void lookup8x3_c(const uint8_t *index, uint8_t *out, unsigned int count, const uint32_t *table)
+{
+    for (unsigned int i = 0; i < count; i++, out += 3)
+        memcpy(out, &table[index[i]], 3);
+}
+
+static void dither16_c(const uint16_t *in, uint8_t *out, unsigned int count, uint8_t offset, uint8_t step)
+{
+    for (unsigned int i = 0; i < count; i++, offset += step) {
+        unsigned int v = (in[i] + offset) >> 8;
+        out[i] = (v > 255) ? 255 : v;
+    }
+}
+
+static void sum8x3_c(const uint8_t *p, unsigned int num_leds, uint32_t sum[3])
+{
+    for (unsigned int i = 0; i < num_leds; i++, p += 3) {
+        sum[0] += p[0];
+        sum[1] += p[1];
+        sum[2] += p[2];
+    }
+}
+
+static uint32_t sum8_c(const uint8_t *p, unsigned int count)
+{
+    uint32_t sum = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+        sum += p[i];
+    return(sum);
+}
+
+// xorshift128 (Marsaglia), one step of every lane, the new w goes out
+static void random8_c(uint32_t *s, uint8_t *out, unsigned int count)
+{
+    uint32_t *x = s, *y = s + RANDOM_LANES, *z = s + 2 * RANDOM_LANES, *w = s + 3 * RANDOM_LANES;
+    uint32_t step[RANDOM_LANES];
+
+    while (count) {
+        for (int l = 0; l < RANDOM_LANES; l++) {
+            uint32_t t = x[l] ^ (x[l] << 11);
+            x[l] = y[l];
+            y[l] = z[l];
+            z[l] = w[l];
+            w[l] = w[l] ^ (w[l] >> 19) ^ t ^ (t >> 8);
+            step[l] = w[l];
+        }
+        unsigned int n = (count < sizeof(step)) ? count : sizeof(step);
+        memcpy(out, step, n);
+        out += n;
+        count -= n;
+    }
+}
+
+// the 8 bit waves, the vector versions are templates on which one
+enum { WAVE_SIN8, WAVE_TRI8, WAVE_QUAD8, WAVE_CUBIC8 };
+
+static void wave8_c(const uint8_t *in, uint8_t *out, unsigned int count, int wave, uint8_t shift)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        uint8_t v = in[i] + shift;
+        switch (wave) {
+            case WAVE_SIN8: out[i] = sin8(v); break;
+            case WAVE_TRI8: out[i] = triwave8(v); break;
+            case WAVE_QUAD8: out[i] = quadwave8(v); break;
+            default: out[i] = cubicwave8(v); break;
+        }
+    }
+}
+
+static void sin16_c(const uint16_t *theta, int16_t *out, unsigned int count, uint16_t shift)
+{
+    for (unsigned int i = 0; i < count; i++)
+        out[i] = sin16(theta[i] + shift);
+}
+
+// the tables of sin16_C(), base and slope of its 8 sections
+static const uint16_t sin16_base[8] = { 0, 6393, 12539, 18204, 23170, 27245, 30273, 32137 };
+static const uint16_t sin16_slope[8] = { 49, 48, 44, 38, 31, 23, 14, 4 };
+
+// the ways of combining two arrays byte by byte, templates like the waves
+enum { MIX_QADD, MIX_MUL, MIX_MAX, MIX_MIN };
+
+static void mix8_c(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count, int op)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        switch (op) {
+            case MIX_QADD: out[i] = qadd8(a[i], b[i]); break;
+            case MIX_MUL: out[i] = scale8(a[i], b[i]); break;
+            case MIX_MAX: out[i] = (a[i] > b[i]) ? a[i] : b[i]; break;
+            default: out[i] = (a[i] < b[i]) ? a[i] : b[i]; break;
+        }
+    }
+}
+
+#ifdef BULK8_X86
+
+/***************************************************************************
+ *   x86: SSE2 and AVX2, picked at runtime
+ ***************************************************************************/
+
+// 0: plain C, 1: SSE2, 2: AVX2
+static int detectSimdLevel(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return(2);
+    if (__builtin_cpu_supports("sse2"))
+        return(1);
+    return(0);
+}
+
+static int simdLevel(void)
+{
+    static const int level = detectSimdLevel();     // once, thread safe
+    return(level);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i scale16_sse2(__m128i v, __m128i slo, __m128i shi)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), slo), 8);
+    __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), shi), 8);
+    return _mm_packus_epi16(lo, hi);
+}
+
+__attribute__((target("sse2")))
+static unsigned int scale8_sse2(uint8_t *p, unsigned int count, uint8_t scale, bool video)
+{
+    __m128i s = _mm_set1_epi16(scale);
+    __m128i zero = _mm_setzero_si128();
+    __m128i one = _mm_set1_epi8(video ? 1 : 0);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i *)(p + i));
+        __m128i r = scale16_sse2(v, s, s);
+        r = _mm_add_epi8(r, _mm_andnot_si128(_mm_cmpeq_epi8(v, zero), one));
+        _mm_storeu_si128((__m128i *)(p + i), r);
+    }
+    return(i);
+}
+
+__attribute__((target("sse2")))
+static unsigned int scale8x3_sse2(uint8_t *p, unsigned int count, const uint8_t *pattern)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i slo[3], shi[3];
+    unsigned int i;
+
+    for (int k = 0; k < 3; k++) {
+        __m128i s = _mm_loadu_si128((__m128i *)(pattern + 16 * k));
+        slo[k] = _mm_unpacklo_epi8(s, zero);
+        shi[k] = _mm_unpackhi_epi8(s, zero);
+    }
+    for (i = 0; i + 48 <= count; i += 48) {
+        for (int k = 0; k < 3; k++) {
+            __m128i v = _mm_loadu_si128((__m128i *)(p + i + 16 * k));
+            _mm_storeu_si128((__m128i *)(p + i + 16 * k), scale16_sse2(v, slo[k], shi[k]));
+        }
+    }
+    return(i);
+}
+
+// the 256 bit unpack and pack both work within 128 bit halves,
+// so the bytes come back out in the order they went in
+__attribute__((target("avx2")))
+static inline __m256i scale32_avx2(__m256i v, __m256i slo, __m256i shi)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), slo), 8);
+    __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), shi), 8);
+    return _mm256_packus_epi16(lo, hi);
+}
+
+__attribute__((target("avx2")))
+static unsigned int scale8_avx2(uint8_t *p, unsigned int count, uint8_t scale, bool video)
+{
+    __m256i s = _mm256_set1_epi16(scale);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i one = _mm256_set1_epi8(video ? 1 : 0);
+    unsigned int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i *)(p + i));
+        __m256i r = scale32_avx2(v, s, s);
+        r = _mm256_add_epi8(r, _mm256_andnot_si256(_mm256_cmpeq_epi8(v, zero), one));
+        _mm256_storeu_si256((__m256i *)(p + i), r);
+    }
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int scale8x3_avx2(uint8_t *p, unsigned int count, const uint8_t *pattern)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i slo[3], shi[3];
+    unsigned int i;
+
+    for (int k = 0; k < 3; k++) {
+        __m256i s = _mm256_loadu_si256((__m256i *)(pattern + 32 * k));
+        slo[k] = _mm256_unpacklo_epi8(s, zero);
+        shi[k] = _mm256_unpackhi_epi8(s, zero);
+    }
+    for (i = 0; i + 96 <= count; i += 96) {
+        for (int k = 0; k < 3; k++) {
+            __m256i v = _mm256_loadu_si256((__m256i *)(p + i + 32 * k));
+            _mm256_storeu_si256((__m256i *)(p + i + 32 * k), scale32_avx2(v, slo[k], shi[k]));
+        }
+    }
+    return(i);
+}
+
+// out may be a or b, every vector is loaded before it is stored
+__attribute__((target("sse2")))
+static unsigned int blend8_sse2(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count, uint8_t amount)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i keep = _mm_set1_epi16(255 - amount);
+    __m128i amt = _mm_set1_epi16(amount);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128((__m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((__m128i *)(b + i));
+        __m128i lo = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), keep), 8),
+                                   _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), amt), 8));
+        __m128i hi = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), keep), 8),
+                                   _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), amt), 8));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+    }
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int blend8_avx2(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count, uint8_t amount)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i keep = _mm256_set1_epi16(255 - amount);
+    __m256i amt = _mm256_set1_epi16(amount);
+    unsigned int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i va = _mm256_loadu_si256((__m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((__m256i *)(b + i));
+        __m256i lo = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), keep), 8),
+                                      _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), amt), 8));
+        __m256i hi = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), keep), 8),
+                                      _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), amt), 8));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_packus_epi16(lo, hi));
+    }
+    return(i);
+}
+
+__attribute__((target("sse2")))
+static unsigned int blur8_sse2(uint8_t *out, const uint8_t *in, const uint8_t *before, const uint8_t *after,
+                               unsigned int count, uint8_t keep, uint8_t seep)
+{
+    __m128i k = _mm_set1_epi16(keep);
+    __m128i s = _mm_set1_epi16(seep);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m128i c = scale16_sse2(_mm_loadu_si128((__m128i *)(in + i)), k, k);
+        __m128i l = scale16_sse2(_mm_loadu_si128((__m128i *)(before + i)), s, s);
+        __m128i r = scale16_sse2(_mm_loadu_si128((__m128i *)(after + i)), s, s);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_adds_epu8(_mm_adds_epu8(c, l), r));
+    }
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int blur8_avx2(uint8_t *out, const uint8_t *in, const uint8_t *before, const uint8_t *after,
+                               unsigned int count, uint8_t keep, uint8_t seep)
+{
+    __m256i k = _mm256_set1_epi16(keep);
+    __m256i s = _mm256_set1_epi16(seep);
+    unsigned int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i c = scale32_avx2(_mm256_loadu_si256((__m256i *)(in + i)), k, k);
+        __m256i l = scale32_avx2(_mm256_loadu_si256((__m256i *)(before + i)), s, s);
+        __m256i r = scale32_avx2(_mm256_loadu_si256((__m256i *)(after + i)), s, s);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_adds_epu8(_mm256_adds_epu8(c, l), r));
+    }
+    return(i);
+}
+
+// mulhi is (v * scale) >> 16, scale16() exactly
+__attribute__((target("sse2")))
+static unsigned int scale16_sse2(uint16_t *p, unsigned int count, fract16 scale)
+{
+    __m128i s = _mm_set1_epi16(scale);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= count; i += 8)
+        _mm_storeu_si128((__m128i *)(p + i), _mm_mulhi_epu16(_mm_loadu_si128((__m128i *)(p + i)), s));
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int scale16_avx2(uint16_t *p, unsigned int count, fract16 scale)
+{
+    __m256i s = _mm256_set1_epi16(scale);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16)
+        _mm256_storeu_si256((__m256i *)(p + i), _mm256_mulhi_epu16(_mm256_loadu_si256((__m256i *)(p + i)), s));
+    return(i);
+}
+
+__attribute__((target("sse2")))
+static unsigned int blend16_sse2(const uint16_t *a, const uint16_t *b, uint16_t *out, unsigned int count, fract16 amount)
+{
+    __m128i keep = _mm_set1_epi16(65535 - amount);
+    __m128i amt = _mm_set1_epi16(amount);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i va = _mm_mulhi_epu16(_mm_loadu_si128((__m128i *)(a + i)), keep);
+        __m128i vb = _mm_mulhi_epu16(_mm_loadu_si128((__m128i *)(b + i)), amt);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_add_epi16(va, vb));
+    }
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int blend16_avx2(const uint16_t *a, const uint16_t *b, uint16_t *out, unsigned int count, fract16 amount)
+{
+    __m256i keep = _mm256_set1_epi16(65535 - amount);
+    __m256i amt = _mm256_set1_epi16(amount);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m256i va = _mm256_mulhi_epu16(_mm256_loadu_si256((__m256i *)(a + i)), keep);
+        __m256i vb = _mm256_mulhi_epu16(_mm256_loadu_si256((__m256i *)(b + i)), amt);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_add_epi16(va, vb));
+    }
+    return(i);
+}
+
+// Eight 4 byte entries per gather, the pad bytes are squeezed out per
+// 128 bit half, which leaves 12 good bytes in each. Every half is stored
+// as 16 bytes, the 4 too many are overwritten by the next store, so we
+// stop while there are at least 10 indexes left.
+__attribute__((target("avx2")))
+static unsigned int lookup8x3_avx2(const uint8_t *index, uint8_t *out, unsigned int count, const uint32_t *table)
+{
+    __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    unsigned int i;
+
+    for (i = 0; i + 10 <= count; i += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)(index + i)));
+        __m256i v = _mm256_shuffle_epi8(_mm256_i32gather_epi32((const int *)table, idx, 4), pack);
+        _mm_storeu_si128((__m128i *)(out + i * 3), _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i *)(out + i * 3 + 12), _mm256_extracti128_si256(v, 1));
+    }
+    return(i);
+}
+
+// The dither offsets are kept in 16 bit lanes, the ramp holds
+// lane * step and the low byte of ramp + offset is the lane's offset.
+// adds_epu16 saturates at 0xffff, which still shifts down to 255.
+__attribute__((target("sse2")))
+static unsigned int dither16_sse2(const uint16_t *in, uint8_t *out, unsigned int count, uint8_t offset, uint8_t step)
+{
+    __m128i mask = _mm_set1_epi16(0xff);
+    __m128i ramp = _mm_setr_epi16(0, step, 2 * step, 3 * step, 4 * step, 5 * step, 6 * step, 7 * step);
+    __m128i half = _mm_set1_epi16(8 * step);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16, offset += 16 * step) {
+        __m128i dlo = _mm_and_si128(_mm_add_epi16(ramp, _mm_set1_epi16(offset)), mask);
+        __m128i dhi = _mm_and_si128(_mm_add_epi16(dlo, half), mask);
+        __m128i lo = _mm_adds_epu16(_mm_loadu_si128((__m128i *)(in + i)), dlo);
+        __m128i hi = _mm_adds_epu16(_mm_loadu_si128((__m128i *)(in + i + 8)), dhi);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int dither16_avx2(const uint16_t *in, uint8_t *out, unsigned int count, uint8_t offset, uint8_t step)
+{
+    __m256i mask = _mm256_set1_epi16(0xff);
+    __m256i ramp = _mm256_setr_epi16(0, step, 2 * step, 3 * step, 4 * step, 5 * step, 6 * step, 7 * step,
+                                     8 * step, 9 * step, 10 * step, 11 * step, 12 * step, 13 * step, 14 * step, 15 * step);
+    __m256i half = _mm256_set1_epi16(16 * step);
+    unsigned int i;
+
+    for (i = 0; i + 32 <= count; i += 32, offset += 32 * step) {
+        __m256i dlo = _mm256_and_si256(_mm256_add_epi16(ramp, _mm256_set1_epi16(offset)), mask);
+        __m256i dhi = _mm256_and_si256(_mm256_add_epi16(dlo, half), mask);
+        __m256i lo = _mm256_adds_epu16(_mm256_loadu_si256((__m256i *)(in + i)), dlo);
+        __m256i hi = _mm256_adds_epu16(_mm256_loadu_si256((__m256i *)(in + i + 16)), dhi);
+        // packus works per 128 bit half, put the quarters back in order
+        __m256i r = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_permute4x64_epi64(r, 0xd8));
+    }
+    return(i);
+}
+
+// psadbw against zero adds up 8 bytes at a time into a 64 bit lane. The
+// triplets are split into colors by masking, masks[c] has 0xff on the
+// bytes of color c of 32 triplets.
+__attribute__((target("sse2")))
+static unsigned int sum8x3_sse2(const uint8_t *p, unsigned int count, const uint8_t *masks, uint32_t sum[3])
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc[3] = { zero, zero, zero };
+    __m128i m[3][3];
+    unsigned int i;
+
+    for (int c = 0; c < 3; c++)
+        for (int k = 0; k < 3; k++)
+            m[c][k] = _mm_loadu_si128((__m128i *)(masks + 96 * c + 16 * k));
+    for (i = 0; i + 48 <= count; i += 48) {
+        for (int k = 0; k < 3; k++) {
+            __m128i v = _mm_loadu_si128((__m128i *)(p + i + 16 * k));
+            for (int c = 0; c < 3; c++)
+                acc[c] = _mm_add_epi64(acc[c], _mm_sad_epu8(_mm_and_si128(v, m[c][k]), zero));
+        }
+    }
+    for (int c = 0; c < 3; c++)
+        sum[c] += _mm_cvtsi128_si32(acc[c]) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc[c], acc[c]));
+    return(i);
+}
+
+__attribute__((target("sse2")))
+static unsigned int sum8_sse2(const uint8_t *p, unsigned int count, uint32_t *sum)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16)
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((__m128i *)(p + i)), zero));
+    *sum += _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc));
+    return(i);
+}
+
+// the lanes of random8_c, two vectors of 4
+__attribute__((target("sse2")))
+static unsigned int random8_sse2(uint32_t *s, uint8_t *out, unsigned int count)
+{
+    __m128i v[4][2];
+    unsigned int i;
+
+    for (int k = 0; k < 4; k++)
+        for (int h = 0; h < 2; h++)
+            v[k][h] = _mm_loadu_si128((__m128i *)(s + k * RANDOM_LANES + 4 * h));
+    for (i = 0; i + 4 * RANDOM_LANES <= count; i += 4 * RANDOM_LANES) {
+        for (int h = 0; h < 2; h++) {
+            __m128i t = _mm_xor_si128(v[0][h], _mm_slli_epi32(v[0][h], 11));
+            __m128i w = v[3][h];
+            v[0][h] = v[1][h];
+            v[1][h] = v[2][h];
+            v[2][h] = w;
+            w = _mm_xor_si128(_mm_xor_si128(w, _mm_srli_epi32(w, 19)),
+                              _mm_xor_si128(t, _mm_srli_epi32(t, 8)));
+            v[3][h] = w;
+            _mm_storeu_si128((__m128i *)(out + i + 16 * h), w);
+        }
+    }
+    for (int k = 0; k < 4; k++)
+        for (int h = 0; h < 2; h++)
+            _mm_storeu_si128((__m128i *)(s + k * RANDOM_LANES + 4 * h), v[k][h]);
+    return(i);
+}
+
+// The waves on 16 bit lanes holding a byte each: the integer steps of
+// sin8_C(), triwave8(), ease8InOutQuad() and ease8InOutCubic() with the
+// branches turned into masks, so they give the same bytes. The section
+// tables of sin8 are picked by comparing. cubicwave8 can come out as
+// 256, the saturating pack makes that 255 as ease8InOutCubic() does.
+template<int W> __attribute__((target("sse2")))
+static inline __m128i wave16_sse2(__m128i t)
+{
+    const __m128i ff = _mm_set1_epi16(0xff);
+    __m128i m80 = _mm_cmpeq_epi16(_mm_and_si128(t, _mm_set1_epi16(0x80)), _mm_set1_epi16(0x80));
+
+    if (W == WAVE_SIN8) {
+        __m128i m40 = _mm_cmpeq_epi16(_mm_and_si128(t, _mm_set1_epi16(0x40)), _mm_set1_epi16(0x40));
+        __m128i offset = _mm_and_si128(_mm_xor_si128(t, m40), _mm_set1_epi16(0x3f));
+        __m128i secoffset = _mm_sub_epi16(_mm_and_si128(offset, _mm_set1_epi16(0x0f)), m40);
+        __m128i section = _mm_srli_epi16(offset, 4);
+        __m128i b = _mm_setzero_si128(), m16 = _mm_setzero_si128();
+        for (int k = 0; k < 4; k++) {
+            __m128i e = _mm_cmpeq_epi16(section, _mm_set1_epi16(k));
+            b = _mm_or_si128(b, _mm_and_si128(e, _mm_set1_epi16(b_m16_interleave[2 * k])));
+            m16 = _mm_or_si128(m16, _mm_and_si128(e, _mm_set1_epi16(b_m16_interleave[2 * k + 1])));
+        }
+        __m128i y = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(m16, secoffset), 4), b);
+        y = _mm_sub_epi16(_mm_xor_si128(y, m80), m80);
+        return _mm_and_si128(_mm_add_epi16(y, _mm_set1_epi16(128)), ff);
+    }
+    __m128i i = _mm_slli_epi16(_mm_and_si128(_mm_xor_si128(t, m80), _mm_set1_epi16(0x7f)), 1);
+    if (W == WAVE_TRI8)
+        return i;
+    if (W == WAVE_QUAD8) {
+        __m128i mi = _mm_cmpeq_epi16(_mm_and_si128(i, _mm_set1_epi16(0x80)), _mm_set1_epi16(0x80));
+        __m128i j = _mm_and_si128(_mm_xor_si128(i, mi), ff);
+        __m128i jj = _mm_srli_epi16(_mm_mullo_epi16(j, _mm_add_epi16(j, _mm_set1_epi16(1))), 8);
+        return _mm_and_si128(_mm_xor_si128(_mm_slli_epi16(jj, 1), mi), ff);
+    }
+    __m128i ii = _mm_srli_epi16(_mm_mullo_epi16(i, i), 8);
+    __m128i iii = _mm_srli_epi16(_mm_mullo_epi16(ii, i), 8);
+    return _mm_sub_epi16(_mm_add_epi16(ii, _mm_add_epi16(ii, ii)), _mm_add_epi16(iii, iii));
+}
+
+template<int W> __attribute__((target("sse2")))
+static unsigned int wave8_sse2(const uint8_t *in, uint8_t *out, unsigned int count, uint8_t shift)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i s = _mm_set1_epi8(shift);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m128i v = _mm_add_epi8(_mm_loadu_si128((__m128i *)(in + i)), s);
+        __m128i lo = wave16_sse2<W>(_mm_unpacklo_epi8(v, zero));
+        __m128i hi = wave16_sse2<W>(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(lo, hi));
+    }
+    return(i);
+}
+
+// sin16_C() 8 at a time, the same way
+__attribute__((target("sse2")))
+static unsigned int sin16_sse2(const uint16_t *theta, int16_t *out, unsigned int count, uint16_t shift)
+{
+    __m128i s = _mm_set1_epi16(shift);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i t = _mm_add_epi16(_mm_loadu_si128((__m128i *)(theta + i)), s);
+        __m128i m40 = _mm_cmpeq_epi16(_mm_and_si128(t, _mm_set1_epi16(0x4000)), _mm_set1_epi16(0x4000));
+        __m128i offset = _mm_srli_epi16(_mm_and_si128(t, _mm_set1_epi16(0x3fff)), 3);
+        offset = _mm_xor_si128(offset, _mm_and_si128(m40, _mm_set1_epi16(2047)));
+        __m128i section = _mm_srli_epi16(offset, 8);
+        __m128i b = _mm_setzero_si128(), m = _mm_setzero_si128();
+        for (int k = 0; k < 8; k++) {
+            __m128i e = _mm_cmpeq_epi16(section, _mm_set1_epi16(k));
+            b = _mm_or_si128(b, _mm_and_si128(e, _mm_set1_epi16(sin16_base[k])));
+            m = _mm_or_si128(m, _mm_and_si128(e, _mm_set1_epi16(sin16_slope[k])));
+        }
+        __m128i y = _mm_add_epi16(_mm_mullo_epi16(m, _mm_srli_epi16(_mm_and_si128(offset, _mm_set1_epi16(0xff)), 1)), b);
+        __m128i m80 = _mm_srai_epi16(t, 15);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_sub_epi16(_mm_xor_si128(y, m80), m80));
+    }
+    return(i);
+}
+
+template<int W> __attribute__((target("avx2")))
+static inline __m256i wave16_avx2(__m256i t)
+{
+    const __m256i ff = _mm256_set1_epi16(0xff);
+    __m256i m80 = _mm256_cmpeq_epi16(_mm256_and_si256(t, _mm256_set1_epi16(0x80)), _mm256_set1_epi16(0x80));
+
+    if (W == WAVE_SIN8) {
+        __m256i m40 = _mm256_cmpeq_epi16(_mm256_and_si256(t, _mm256_set1_epi16(0x40)), _mm256_set1_epi16(0x40));
+        __m256i offset = _mm256_and_si256(_mm256_xor_si256(t, m40), _mm256_set1_epi16(0x3f));
+        __m256i secoffset = _mm256_sub_epi16(_mm256_and_si256(offset, _mm256_set1_epi16(0x0f)), m40);
+        __m256i section = _mm256_srli_epi16(offset, 4);
+        __m256i b = _mm256_setzero_si256(), m16 = _mm256_setzero_si256();
+        for (int k = 0; k < 4; k++) {
+            __m256i e = _mm256_cmpeq_epi16(section, _mm256_set1_epi16(k));
+            b = _mm256_or_si256(b, _mm256_and_si256(e, _mm256_set1_epi16(b_m16_interleave[2 * k])));
+            m16 = _mm256_or_si256(m16, _mm256_and_si256(e, _mm256_set1_epi16(b_m16_interleave[2 * k + 1])));
+        }
+        __m256i y = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(m16, secoffset), 4), b);
+        y = _mm256_sub_epi16(_mm256_xor_si256(y, m80), m80);
+        return _mm256_and_si256(_mm256_add_epi16(y, _mm256_set1_epi16(128)), ff);
+    }
+    __m256i i = _mm256_slli_epi16(_mm256_and_si256(_mm256_xor_si256(t, m80), _mm256_set1_epi16(0x7f)), 1);
+    if (W == WAVE_TRI8)
+        return i;
+    if (W == WAVE_QUAD8) {
+        __m256i mi = _mm256_cmpeq_epi16(_mm256_and_si256(i, _mm256_set1_epi16(0x80)), _mm256_set1_epi16(0x80));
+        __m256i j = _mm256_and_si256(_mm256_xor_si256(i, mi), ff);
+        __m256i jj = _mm256_srli_epi16(_mm256_mullo_epi16(j, _mm256_add_epi16(j, _mm256_set1_epi16(1))), 8);
+        return _mm256_and_si256(_mm256_xor_si256(_mm256_slli_epi16(jj, 1), mi), ff);
+    }
+    __m256i ii = _mm256_srli_epi16(_mm256_mullo_epi16(i, i), 8);
+    __m256i iii = _mm256_srli_epi16(_mm256_mullo_epi16(ii, i), 8);
+    return _mm256_sub_epi16(_mm256_add_epi16(ii, _mm256_add_epi16(ii, ii)), _mm256_add_epi16(iii, iii));
+}
+
+// unpack and pack both work within 128 bit halves, so the bytes end up
+// where they came from
+template<int W> __attribute__((target("avx2")))
+static unsigned int wave8_avx2(const uint8_t *in, uint8_t *out, unsigned int count, uint8_t shift)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i s = _mm256_set1_epi8(shift);
+    unsigned int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_add_epi8(_mm256_loadu_si256((__m256i *)(in + i)), s);
+        __m256i lo = wave16_avx2<W>(_mm256_unpacklo_epi8(v, zero));
+        __m256i hi = wave16_avx2<W>(_mm256_unpackhi_epi8(v, zero));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_packus_epi16(lo, hi));
+    }
+    return(i);
+}
+
+// with AVX2 the section tables are a byte shuffle, each lane picks the
+// two bytes of its entry
+__attribute__((target("avx2")))
+static unsigned int sin16_avx2(const uint16_t *theta, int16_t *out, unsigned int count, uint16_t shift)
+{
+    __m256i s = _mm256_set1_epi16(shift);
+    __m256i base = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)sin16_base));
+    __m256i slope = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)sin16_slope));
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m256i t = _mm256_add_epi16(_mm256_loadu_si256((__m256i *)(theta + i)), s);
+        __m256i m40 = _mm256_cmpeq_epi16(_mm256_and_si256(t, _mm256_set1_epi16(0x4000)), _mm256_set1_epi16(0x4000));
+        __m256i offset = _mm256_srli_epi16(_mm256_and_si256(t, _mm256_set1_epi16(0x3fff)), 3);
+        offset = _mm256_xor_si256(offset, _mm256_and_si256(m40, _mm256_set1_epi16(2047)));
+        __m256i section = _mm256_srli_epi16(offset, 8);
+        __m256i idx = _mm256_add_epi16(_mm256_mullo_epi16(section, _mm256_set1_epi16(0x0202)), _mm256_set1_epi16(0x0100));
+        __m256i b = _mm256_shuffle_epi8(base, idx);
+        __m256i m = _mm256_shuffle_epi8(slope, idx);
+        __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(m, _mm256_srli_epi16(_mm256_and_si256(offset, _mm256_set1_epi16(0xff)), 1)), b);
+        __m256i m80 = _mm256_srai_epi16(t, 15);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_sub_epi16(_mm256_xor_si256(y, m80), m80));
+    }
+    return(i);
+}
+
+// qadd8, max and min are single instructions, scale8 by another byte
+// array widens both to 16 bits like scale16_sse2() does
+template<int W> __attribute__((target("sse2")))
+static unsigned int mix8_sse2(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count)
+{
+    __m128i zero = _mm_setzero_si128();
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128((__m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((__m128i *)(b + i));
+        __m128i r;
+        if (W == MIX_QADD)
+            r = _mm_adds_epu8(va, vb);
+        else if (W == MIX_MAX)
+            r = _mm_max_epu8(va, vb);
+        else if (W == MIX_MIN)
+            r = _mm_min_epu8(va, vb);
+        else {
+            __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+            __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+            r = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+        }
+        _mm_storeu_si128((__m128i *)(out + i), r);
+    }
+    return(i);
+}
+
+template<int W> __attribute__((target("avx2")))
+static unsigned int mix8_avx2(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count)
+{
+    __m256i zero = _mm256_setzero_si256();
+    unsigned int i;
+
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i va = _mm256_loadu_si256((__m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((__m256i *)(b + i));
+        __m256i r;
+        if (W == MIX_QADD)
+            r = _mm256_adds_epu8(va, vb);
+        else if (W == MIX_MAX)
+            r = _mm256_max_epu8(va, vb);
+        else if (W == MIX_MIN)
+            r = _mm256_min_epu8(va, vb);
+        else {
+            __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), _mm256_unpacklo_epi8(vb, zero));
+            __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), _mm256_unpackhi_epi8(vb, zero));
+            r = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+        }
+        _mm256_storeu_si256((__m256i *)(out + i), r);
+    }
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static uint32_t hsum64_avx2(__m256i acc)
+{
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    return _mm_cvtsi128_si32(s) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(s, s));
+}
+
+__attribute__((target("avx2")))
+static unsigned int sum8x3_avx2(const uint8_t *p, unsigned int count, const uint8_t *masks, uint32_t sum[3])
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i acc[3] = { zero, zero, zero };
+    __m256i m[3][3];
+    unsigned int i;
+
+    for (int c = 0; c < 3; c++)
+        for (int k = 0; k < 3; k++)
+            m[c][k] = _mm256_loadu_si256((__m256i *)(masks + 96 * c + 32 * k));
+    for (i = 0; i + 96 <= count; i += 96) {
+        for (int k = 0; k < 3; k++) {
+            __m256i v = _mm256_loadu_si256((__m256i *)(p + i + 32 * k));
+            for (int c = 0; c < 3; c++)
+                acc[c] = _mm256_add_epi64(acc[c], _mm256_sad_epu8(_mm256_and_si256(v, m[c][k]), zero));
+        }
+    }
+    for (int c = 0; c < 3; c++)
+        sum[c] += hsum64_avx2(acc[c]);
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int sum8_avx2(const uint8_t *p, unsigned int count, uint32_t *sum)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    unsigned int i;
+
+    for (i = 0; i + 32 <= count; i += 32)
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((__m256i *)(p + i)), zero));
+    *sum += hsum64_avx2(acc);
+    return(i);
+}
+
+__attribute__((target("avx2")))
+static unsigned int random8_avx2(uint32_t *s, uint8_t *out, unsigned int count)
+{
+    __m256i x = _mm256_loadu_si256((__m256i *)s);
+    __m256i y = _mm256_loadu_si256((__m256i *)(s + RANDOM_LANES));
+    __m256i z = _mm256_loadu_si256((__m256i *)(s + 2 * RANDOM_LANES));
+    __m256i w = _mm256_loadu_si256((__m256i *)(s + 3 * RANDOM_LANES));
+    unsigned int i;
+
+    for (i = 0; i + 4 * RANDOM_LANES <= count; i += 4 * RANDOM_LANES) {
+        __m256i t = _mm256_xor_si256(x, _mm256_slli_epi32(x, 11));
+        x = y;
+        y = z;
+        z = w;
+        w = _mm256_xor_si256(_mm256_xor_si256(w, _mm256_srli_epi32(w, 19)),
+                             _mm256_xor_si256(t, _mm256_srli_epi32(t, 8)));
+        _mm256_storeu_si256((__m256i *)(out + i), w);
+    }
+    _mm256_storeu_si256((__m256i *)s, x);
+    _mm256_storeu_si256((__m256i *)(s + RANDOM_LANES), y);
+    _mm256_storeu_si256((__m256i *)(s + 2 * RANDOM_LANES), z);
+    _mm256_storeu_si256((__m256i *)(s + 3 * RANDOM_LANES), w);
+    return(i);
+}
+
+static unsigned int scale8_simd(uint8_t *p, unsigned int count, uint8_t scale, bool video)
+{
+    switch (simdLevel()) {
+        case 2: return(scale8_avx2(p, count, scale, video));
+        case 1: return(scale8_sse2(p, count, scale, video));
+    }
+    return(0);
+}
+
+static unsigned int scale8x3_simd(uint8_t *p, unsigned int count, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8_t pattern[96];            // 32 rgb triplets, enough for three AVX2 registers
+
+    for (int i = 0; i < 96; i += 3) {
+        pattern[i] = r;
+        pattern[i+1] = g;
+        pattern[i+2] = b;
+    }
+    switch (simdLevel()) {
+        case 2: return(scale8x3_avx2(p, count, pattern));
+        case 1: return(scale8x3_sse2(p, count, pattern));
+    }
+    return(0);
+}
+
+static unsigned int blend8_simd(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count, uint8_t amount)
+{
+    switch (simdLevel()) {
+        case 2: return(blend8_avx2(a, b, out, count, amount));
+        case 1: return(blend8_sse2(a, b, out, count, amount));
+    }
+    return(0);
+}
+
+static unsigned int blur8_simd(uint8_t *out, const uint8_t *in, const uint8_t *before, const uint8_t *after,
+                               unsigned int count, uint8_t keep, uint8_t seep)
+{
+    switch (simdLevel()) {
+        case 2: return(blur8_avx2(out, in, before, after, count, keep, seep));
+        case 1: return(blur8_sse2(out, in, before, after, count, keep, seep));
+    }
+    return(0);
+}
+
+static unsigned int scale16_simd(uint16_t *p, unsigned int count, fract16 scale)
+{
+    switch (simdLevel()) {
+        case 2: return(scale16_avx2(p, count, scale));
+        case 1: return(scale16_sse2(p, count, scale));
+    }
+    return(0);
+}
+
+static unsigned int blend16_simd(const uint16_t *a, const uint16_t *b, uint16_t *out, unsigned int count, fract16 amount)
+{
+    switch (simdLevel()) {
+        case 2: return(blend16_avx2(a, b, out, count, amount));
+        case 1: return(blend16_sse2(a, b, out, count, amount));
+    }
+    return(0);
+}
+
+// SSE2 has no gather, the plain loop is as good
+static unsigned int lookup8x3_simd(const uint8_t *index, uint8_t *out, unsigned int count, const uint32_t *table)
+{
+    if (simdLevel() == 2)
+        return(lookup8x3_avx2(index, out, count, table));
+    return(0);
+}
+
+static unsigned int dither16_simd(const uint16_t *in, uint8_t *out, unsigned int count, uint8_t offset, uint8_t step)
+{
+    switch (simdLevel()) {
+        case 2: return(dither16_avx2(in, out, count, offset, step));
+        case 1: return(dither16_sse2(in, out, count, offset, step));
+    }
+    return(0);
+}
+
+static unsigned int sum8x3_simd(const uint8_t *p, unsigned int count, uint32_t sum[3])
+{
+    static const struct SumMasks {
+        uint8_t m[3 * 96];
+        SumMasks() {
+            for (int i = 0; i < 3 * 96; i++)
+                m[i] = (i % 3 == i / 96) ? 0xff : 0;
+        }
+    } masks;
+
+    switch (simdLevel()) {
+        case 2: return(sum8x3_avx2(p, count, masks.m, sum));
+        case 1: return(sum8x3_sse2(p, count, masks.m, sum));
+    }
+    return(0);
+}
+
+static unsigned int sum8_simd(const uint8_t *p, unsigned int count, uint32_t *sum)
+{
+    switch (simdLevel()) {
+        case 2: return(sum8_avx2(p, count, sum));
+        case 1: return(sum8_sse2(p, count, sum));
+    }
+    return(0);
+}
+
+static unsigned int random8_simd(uint32_t *s, uint8_t *out, unsigned int count)
+{
+    switch (simdLevel()) {
+        case 2: return(random8_avx2(s, out, count));
+        case 1: return(random8_sse2(s, out, count));
+    }
+    return(0);
+}
+
+template<int W> static unsigned int wave8_level(const uint8_t *in, uint8_t *out, unsigned int count, uint8_t shift)
+{
+    switch (simdLevel()) {
+        case 2: return(wave8_avx2<W>(in, out, count, shift));
+        case 1: return(wave8_sse2<W>(in, out, count, shift));
+    }
+    return(0);
+}
+
+template<int W> static unsigned int mix8_level(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count)
+{
+    switch (simdLevel()) {
+        case 2: return(mix8_avx2<W>(a, b, out, count));
+        case 1: return(mix8_sse2<W>(a, b, out, count));
+    }
+    return(0);
+}
+
+static unsigned int sin16_simd(const uint16_t *theta, int16_t *out, unsigned int count, uint16_t shift)
+{
+    switch (simdLevel()) {
+        case 2: return(sin16_avx2(theta, out, count, shift));
+        case 1: return(sin16_sse2(theta, out, count, shift));
+    }
+    return(0);
+}
+
+#elif defined(BULK8_NEON)
+
+/***************************************************************************
+ *   ARM: NEON is always there on the hosts we care about
+ ***************************************************************************/
+
+static inline uint8x16_t scale16_neon(uint8x16_t v, uint8x8_t s)
+{
+    return vcombine_u8(vshrn_n_u16(vmull_u8(vget_low_u8(v), s), 8),
+                       vshrn_n_u16(vmull_u8(vget_high_u8(v), s), 8));
+}
+
+static unsigned int scale8_simd(uint8_t *p, unsigned int count, uint8_t scale, bool video)
+{
+    uint8x8_t s = vdup_n_u8(scale);
+    uint8x16_t one = vdupq_n_u8(video ? 1 : 0);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(p + i);
+        uint8x16_t r = scale16_neon(v, s);
+        r = vaddq_u8(r, vandq_u8(vtstq_u8(v, v), one));
+        vst1q_u8(p + i, r);
+    }
+    return(i);
+}
+
+// vld3q/vst3q split the triplets into one register per color for us
+static unsigned int scale8x3_simd(uint8_t *p, unsigned int count, uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8x8_t sr = vdup_n_u8(r);
+    uint8x8_t sg = vdup_n_u8(g);
+    uint8x8_t sb = vdup_n_u8(b);
+    unsigned int i;
+
+    for (i = 0; i + 48 <= count; i += 48) {
+        uint8x16x3_t v = vld3q_u8(p + i);
+        v.val[0] = scale16_neon(v.val[0], sr);
+        v.val[1] = scale16_neon(v.val[1], sg);
+        v.val[2] = scale16_neon(v.val[2], sb);
+        vst3q_u8(p + i, v);
+    }
+    return(i);
+}
+
+static unsigned int blend8_simd(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count, uint8_t amount)
+{
+    uint8x8_t keep = vdup_n_u8(255 - amount);
+    uint8x8_t amt = vdup_n_u8(amount);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        vst1q_u8(out + i, vaddq_u8(scale16_neon(va, keep), scale16_neon(vb, amt)));
+    }
+    return(i);
+}
+
+static unsigned int blur8_simd(uint8_t *out, const uint8_t *in, const uint8_t *before, const uint8_t *after,
+                               unsigned int count, uint8_t keep, uint8_t seep)
+{
+    uint8x8_t k = vdup_n_u8(keep);
+    uint8x8_t s = vdup_n_u8(seep);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        uint8x16_t c = scale16_neon(vld1q_u8(in + i), k);
+        uint8x16_t l = scale16_neon(vld1q_u8(before + i), s);
+        uint8x16_t r = scale16_neon(vld1q_u8(after + i), s);
+        vst1q_u8(out + i, vqaddq_u8(vqaddq_u8(c, l), r));
+    }
+    return(i);
+}
+
+static inline uint16x8_t scale16_neon(uint16x8_t v, uint16x4_t s)
+{
+    return vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(v), s), 16),
+                        vshrn_n_u32(vmull_u16(vget_high_u16(v), s), 16));
+}
+
+static unsigned int scale16_simd(uint16_t *p, unsigned int count, fract16 scale)
+{
+    uint16x4_t s = vdup_n_u16(scale);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= count; i += 8)
+        vst1q_u16(p + i, scale16_neon(vld1q_u16(p + i), s));
+    return(i);
+}
+
+static unsigned int blend16_simd(const uint16_t *a, const uint16_t *b, uint16_t *out, unsigned int count, fract16 amount)
+{
+    uint16x4_t keep = vdup_n_u16(65535 - amount);
+    uint16x4_t amt = vdup_n_u16(amount);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= count; i += 8)
+        vst1q_u16(out + i, vaddq_u16(scale16_neon(vld1q_u16(a + i), keep), scale16_neon(vld1q_u16(b + i), amt)));
+    return(i);
+}
+
+// no gather on NEON either
+static unsigned int lookup8x3_simd(const uint8_t *, uint8_t *, unsigned int, const uint32_t *)
+{
+    return(0);
+}
+
+static unsigned int dither16_simd(const uint16_t *in, uint8_t *out, unsigned int count, uint8_t offset, uint8_t step)
+{
+    static const uint16_t lanes[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    uint16x8_t mask = vdupq_n_u16(0xff);
+    uint16x8_t ramp = vmulq_n_u16(vld1q_u16(lanes), step);
+    uint16x8_t half = vdupq_n_u16(8 * step);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16, offset += 16 * step) {
+        uint16x8_t dlo = vandq_u16(vaddq_u16(ramp, vdupq_n_u16(offset)), mask);
+        uint16x8_t dhi = vandq_u16(vaddq_u16(dlo, half), mask);
+        uint16x8_t lo = vqaddq_u16(vld1q_u16(in + i), dlo);
+        uint16x8_t hi = vqaddq_u16(vld1q_u16(in + i + 8), dhi);
+        vst1q_u8(out + i, vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+    }
+    return(i);
+}
+
+static inline uint32_t hsum32_neon(uint32x4_t acc)
+{
+    uint64x2_t s = vpaddlq_u32(acc);
+    return (uint32_t)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+}
+
+// vld3q splits the colors, then pairwise widening adds
+static unsigned int sum8x3_simd(const uint8_t *p, unsigned int count, uint32_t sum[3])
+{
+    uint32x4_t acc[3] = { vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0) };
+    unsigned int i;
+
+    for (i = 0; i + 48 <= count; i += 48) {
+        uint8x16x3_t v = vld3q_u8(p + i);
+        for (int c = 0; c < 3; c++)
+            acc[c] = vpadalq_u16(acc[c], vpaddlq_u8(v.val[c]));
+    }
+    for (int c = 0; c < 3; c++)
+        sum[c] += hsum32_neon(acc[c]);
+    return(i);
+}
+
+static unsigned int sum8_simd(const uint8_t *p, unsigned int count, uint32_t *sum)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16)
+        acc = vpadalq_u16(acc, vpaddlq_u8(vld1q_u8(p + i)));
+    *sum += hsum32_neon(acc);
+    return(i);
+}
+
+static unsigned int random8_simd(uint32_t *s, uint8_t *out, unsigned int count)
+{
+    uint32x4_t v[4][2];
+    unsigned int i;
+
+    for (int k = 0; k < 4; k++)
+        for (int h = 0; h < 2; h++)
+            v[k][h] = vld1q_u32(s + k * RANDOM_LANES + 4 * h);
+    for (i = 0; i + 4 * RANDOM_LANES <= count; i += 4 * RANDOM_LANES) {
+        for (int h = 0; h < 2; h++) {
+            uint32x4_t t = veorq_u32(v[0][h], vshlq_n_u32(v[0][h], 11));
+            uint32x4_t w = v[3][h];
+            v[0][h] = v[1][h];
+            v[1][h] = v[2][h];
+            v[2][h] = w;
+            w = veorq_u32(veorq_u32(w, vshrq_n_u32(w, 19)), veorq_u32(t, vshrq_n_u32(t, 8)));
+            v[3][h] = w;
+            vst1q_u8(out + i + 16 * h, vreinterpretq_u8_u32(w));
+        }
+    }
+    for (int k = 0; k < 4; k++)
+        for (int h = 0; h < 2; h++)
+            vst1q_u32(s + k * RANDOM_LANES + 4 * h, v[k][h]);
+    return(i);
+}
+
+// the x86 wave16 on NEON, the saturating narrow does what packus does
+template<int W> static inline uint16x8_t wave16_neon(uint16x8_t t)
+{
+    const uint16x8_t ff = vdupq_n_u16(0xff);
+    uint16x8_t m80 = vtstq_u16(t, vdupq_n_u16(0x80));
+
+    if (W == WAVE_SIN8) {
+        uint16x8_t m40 = vtstq_u16(t, vdupq_n_u16(0x40));
+        uint16x8_t offset = vandq_u16(veorq_u16(t, m40), vdupq_n_u16(0x3f));
+        uint16x8_t secoffset = vsubq_u16(vandq_u16(offset, vdupq_n_u16(0x0f)), m40);
+        uint16x8_t section = vshrq_n_u16(offset, 4);
+        uint16x8_t b = vdupq_n_u16(0), m16 = vdupq_n_u16(0);
+        for (int k = 0; k < 4; k++) {
+            uint16x8_t e = vceqq_u16(section, vdupq_n_u16(k));
+            b = vorrq_u16(b, vandq_u16(e, vdupq_n_u16(b_m16_interleave[2 * k])));
+            m16 = vorrq_u16(m16, vandq_u16(e, vdupq_n_u16(b_m16_interleave[2 * k + 1])));
+        }
+        uint16x8_t y = vaddq_u16(vshrq_n_u16(vmulq_u16(m16, secoffset), 4), b);
+        y = vsubq_u16(veorq_u16(y, m80), m80);
+        return vandq_u16(vaddq_u16(y, vdupq_n_u16(128)), ff);
+    }
+    uint16x8_t i = vshlq_n_u16(vandq_u16(veorq_u16(t, m80), vdupq_n_u16(0x7f)), 1);
+    if (W == WAVE_TRI8)
+        return i;
+    if (W == WAVE_QUAD8) {
+        uint16x8_t mi = vtstq_u16(i, vdupq_n_u16(0x80));
+        uint16x8_t j = vandq_u16(veorq_u16(i, mi), ff);
+        uint16x8_t jj = vshrq_n_u16(vmulq_u16(j, vaddq_u16(j, vdupq_n_u16(1))), 8);
+        return vandq_u16(veorq_u16(vshlq_n_u16(jj, 1), mi), ff);
+    }
+    uint16x8_t ii = vshrq_n_u16(vmulq_u16(i, i), 8);
+    uint16x8_t iii = vshrq_n_u16(vmulq_u16(ii, i), 8);
+    return vsubq_u16(vmulq_n_u16(ii, 3), vaddq_u16(iii, iii));
+}
+
+template<int W> static unsigned int wave8_level(const uint8_t *in, uint8_t *out, unsigned int count, uint8_t shift)
+{
+    uint8x16_t s = vdupq_n_u8(shift);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        uint8x16_t v = vaddq_u8(vld1q_u8(in + i), s);
+        uint16x8_t lo = wave16_neon<W>(vmovl_u8(vget_low_u8(v)));
+        uint16x8_t hi = wave16_neon<W>(vmovl_u8(vget_high_u8(v)));
+        vst1q_u8(out + i, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+    }
+    return(i);
+}
+
+template<int W> static unsigned int mix8_level(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        uint8x16_t r;
+        if (W == MIX_QADD)
+            r = vqaddq_u8(va, vb);
+        else if (W == MIX_MAX)
+            r = vmaxq_u8(va, vb);
+        else if (W == MIX_MIN)
+            r = vminq_u8(va, vb);
+        else
+            r = vcombine_u8(vshrn_n_u16(vmull_u8(vget_low_u8(va), vget_low_u8(vb)), 8),
+                            vshrn_n_u16(vmull_u8(vget_high_u8(va), vget_high_u8(vb)), 8));
+        vst1q_u8(out + i, r);
+    }
+    return(i);
+}
+
+static unsigned int sin16_simd(const uint16_t *theta, int16_t *out, unsigned int count, uint16_t shift)
+{
+    uint16x8_t s = vdupq_n_u16(shift);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        uint16x8_t t = vaddq_u16(vld1q_u16(theta + i), s);
+        uint16x8_t m40 = vtstq_u16(t, vdupq_n_u16(0x4000));
+        uint16x8_t offset = vshrq_n_u16(vandq_u16(t, vdupq_n_u16(0x3fff)), 3);
+        offset = veorq_u16(offset, vandq_u16(m40, vdupq_n_u16(2047)));
+        uint16x8_t section = vshrq_n_u16(offset, 8);
+        uint16x8_t b = vdupq_n_u16(0), m = vdupq_n_u16(0);
+        for (int k = 0; k < 8; k++) {
+            uint16x8_t e = vceqq_u16(section, vdupq_n_u16(k));
+            b = vorrq_u16(b, vandq_u16(e, vdupq_n_u16(sin16_base[k])));
+            m = vorrq_u16(m, vandq_u16(e, vdupq_n_u16(sin16_slope[k])));
+        }
+        uint16x8_t y = vaddq_u16(vmulq_u16(m, vshrq_n_u16(vandq_u16(offset, vdupq_n_u16(0xff)), 1)), b);
+        uint16x8_t m80 = vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(t), 15));
+        vst1q_s16(out + i, vreinterpretq_s16_u16(vsubq_u16(veorq_u16(y, m80), m80)));
+    }
+    return(i);
+}
+
+#else
+
+static unsigned int lookup8x3_simd(const uint8_t *, uint8_t *, unsigned int, const uint32_t *)
+{
+    return(0);
+}
+
+static unsigned int scale16_simd(uint16_t *, unsigned int, fract16)
+{
+    return(0);
+}
+
+static unsigned int blend16_simd(const uint16_t *, const uint16_t *, uint16_t *, unsigned int, fract16)
+{
+    return(0);
+}
+
+static unsigned int dither16_simd(const uint16_t *, uint8_t *, unsigned int, uint8_t, uint8_t)
+{
+    return(0);
+}
+
+static unsigned int sum8x3_simd(const uint8_t *, unsigned int, uint32_t *)
+{
+    return(0);
+}
+
+static unsigned int sum8_simd(const uint8_t *, unsigned int, uint32_t *)
+{
+    return(0);
+}
+
+static unsigned int random8_simd(uint32_t *, uint8_t *, unsigned int)
+{
+    return(0);
+}
+
+template<int W> static unsigned int wave8_level(const uint8_t *, uint8_t *, unsigned int, uint8_t)
+{
+    return(0);
+}
+
+template<int W> static unsigned int mix8_level(const uint8_t *, const uint8_t *, uint8_t *, unsigned int)
+{
+    return(0);
+}
+
+static unsigned int sin16_simd(const uint16_t *, int16_t *, unsigned int, uint16_t)
+{
+    return(0);
+}
+
+static unsigned int scale8_simd(uint8_t *, unsigned int, uint8_t, bool)
+{
+    return(0);
+}
+
+static unsigned int scale8x3_simd(uint8_t *, unsigned int, uint8_t, uint8_t, uint8_t)
+{
+    return(0);
+}
+
+static unsigned int blend8_simd(const uint8_t *, const uint8_t *, uint8_t *, unsigned int, uint8_t)
+{
+    return(0);
+}
+
+static unsigned int blur8_simd(uint8_t *, const uint8_t *, const uint8_t *, const uint8_t *,
+                               unsigned int, uint8_t, uint8_t)
+{
+    return(0);
+}
+
+#endif
+
+/***************************************************************************
+ *   public entry points: vector loop first, plain C for what is left
+ ***************************************************************************/
+
+void bulk_scale8(uint8_t *p, unsigned int count, uint8_t scale)
+{
+    if (scale == 0) {
+        memset(p, 0, count);
+        return;
+    }
+    unsigned int done = scale8_simd(p, count, scale, false);
+    scale8_c(p + done, count - done, scale);
+}
+
+void bulk_scale8_video(uint8_t *p, unsigned int count, uint8_t scale)
+{
+    if (scale == 0) {
+        memset(p, 0, count);
+        return;
+    }
+    unsigned int done = scale8_simd(p, count, scale, true);
+    scale8_video_c(p + done, count - done, scale);
+}
+
+void bulk_scale8x3(uint8_t *p, unsigned int num_leds, uint8_t r, uint8_t g, uint8_t b)
+{
+    // the vector loops only ever stop on a whole triplet
+    unsigned int done = scale8x3_simd(p, num_leds * 3, r, g, b);
+    scale8x3_c(p + done, num_leds - done / 3, r, g, b);
+}
+
+void bulk_blend8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count, uint8_t amount)
+{
+    // nblend() special cases these two, so do we
+    if (amount == 0) {
+        if (out != a)
+            memmove(out, a, count);
+        return;
+    }
+    if (amount == 255) {
+        if (out != b)
+            memmove(out, b, count);
+        return;
+    }
+    unsigned int done = blend8_simd(a, b, out, count, amount);
+    blend8_c(a + done, b + done, out + done, count - done, amount);
+}
+
+void bulk_nblend8(uint8_t *existing, const uint8_t *overlay, unsigned int count, uint8_t amount)
+{
+    bulk_blend8(existing, overlay, existing, count, amount);
+}
+
+void bulk_blur8(uint8_t *out, const uint8_t *in, const uint8_t *before, const uint8_t *after,
+                unsigned int count, uint8_t keep, uint8_t seep)
+{
+    unsigned int done = blur8_simd(out, in, before, after, count, keep, seep);
+    blur8_c(out + done, in + done, before + done, after + done, count - done, keep, seep);
+}
+
+void bulk_scale16(uint16_t *p, unsigned int count, fract16 scale)
+{
+    unsigned int done = scale16_simd(p, count, scale);
+    scale16_c(p + done, count - done, scale);
+}
+
+void bulk_blend16(const uint16_t *a, const uint16_t *b, uint16_t *out, unsigned int count, fract16 amount)
+{
+    if (amount == 0) {
+        if (out != a)
+            memmove(out, a, count * 2);
+        return;
+    }
+    if (amount == 65535) {
+        if (out != b)
+            memmove(out, b, count * 2);
+        return;
+    }
+    unsigned int done = blend16_simd(a, b, out, count, amount);
+    blend16_c(a + done, b + done, out + done, count - done, amount);
+}
+
+void bulk_lookup8x3(const uint8_t *index, uint8_t *out, unsigned int count, const uint32_t *table)
+{
+    unsigned int done = lookup8x3_simd(index, out, count, table);
+    lookup8x3_c(index + done, out + done * 3, count - done, table);
+}
+
+void bulk_dither16(const uint16_t *in, uint8_t *out, unsigned int count, uint8_t offset, uint8_t step)
+{
+    unsigned int done = dither16_simd(in, out, count, offset, step);
+    dither16_c(in + done, out + done, count - done, offset + done * step, step);
+}
+
+void bulk_sum8x3(const uint8_t *p, unsigned int num_leds, uint32_t sum[3])
+{
+    // whole triplets again
+    unsigned int done = sum8x3_simd(p, num_leds * 3, sum);
+    sum8x3_c(p + done, num_leds - done / 3, sum);
+}
+
+uint32_t bulk_sum8(const uint8_t *p, unsigned int count)
+{
+    uint32_t sum = 0;
+    unsigned int done = sum8_simd(p, count, &sum);
+    return(sum + sum8_c(p + done, count - done));
+}
+
+void bulk_random8(uint32_t *state, uint8_t *out, unsigned int count)
+{
+    unsigned int done = random8_simd(state, out, count);
+    random8_c(state, out + done, count - done);
+}
+
+static void wave8(const uint8_t *in, uint8_t *out, unsigned int count, int wave, uint8_t shift)
+{
+    unsigned int done;
+
+    switch (wave) {
+        case WAVE_SIN8: done = wave8_level<WAVE_SIN8>(in, out, count, shift); break;
+        case WAVE_TRI8: done = wave8_level<WAVE_TRI8>(in, out, count, shift); break;
+        case WAVE_QUAD8: done = wave8_level<WAVE_QUAD8>(in, out, count, shift); break;
+        default: done = wave8_level<WAVE_CUBIC8>(in, out, count, shift); break;
+    }
+    wave8_c(in + done, out + done, count - done, wave, shift);
+}
+
+void bulk_sin8(const uint8_t *theta, uint8_t *out, unsigned int count)
+{
+    wave8(theta, out, count, WAVE_SIN8, 0);
+}
+
+void bulk_cos8(const uint8_t *theta, uint8_t *out, unsigned int count)
+{
+    wave8(theta, out, count, WAVE_SIN8, 64);
+}
+
+void bulk_triwave8(const uint8_t *in, uint8_t *out, unsigned int count)
+{
+    wave8(in, out, count, WAVE_TRI8, 0);
+}
+
+void bulk_quadwave8(const uint8_t *in, uint8_t *out, unsigned int count)
+{
+    wave8(in, out, count, WAVE_QUAD8, 0);
+}
+
+void bulk_cubicwave8(const uint8_t *in, uint8_t *out, unsigned int count)
+{
+    wave8(in, out, count, WAVE_CUBIC8, 0);
+}
+
+void bulk_sin16(const uint16_t *theta, int16_t *out, unsigned int count)
+{
+    unsigned int done = sin16_simd(theta, out, count, 0);
+    sin16_c(theta + done, out + done, count - done, 0);
+}
+
+void bulk_cos16(const uint16_t *theta, int16_t *out, unsigned int count)
+{
+    unsigned int done = sin16_simd(theta, out, count, 16384);
+    sin16_c(theta + done, out + done, count - done, 16384);
+}
+
+void bulk_ramp8(uint8_t *out, unsigned int count, uint16_t phase, uint16_t step)
+{
+    for (unsigned int i = 0; i < count; i++, phase += step)
+        out[i] = phase >> 8;
+}
+
+void bulk_ramp16(uint16_t *out, unsigned int count, uint16_t phase, uint16_t step)
+{
+    for (unsigned int i = 0; i < count; i++, phase += step)
+        out[i] = phase;
+}
+
+void bulk_qadd8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count)
+{
+    unsigned int done = mix8_level<MIX_QADD>(a, b, out, count);
+    mix8_c(a + done, b + done, out + done, count - done, MIX_QADD);
+}
+
+void bulk_mul8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count)
+{
+    unsigned int done = mix8_level<MIX_MUL>(a, b, out, count);
+    mix8_c(a + done, b + done, out + done, count - done, MIX_MUL);
+}
+
+void bulk_max8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count)
+{
+    unsigned int done = mix8_level<MIX_MAX>(a, b, out, count);
+    mix8_c(a + done, b + done, out + done, count - done, MIX_MAX);
+}
+
+void bulk_min8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count)
+{
+    unsigned int done = mix8_level<MIX_MIN>(a, b, out, count);
+    mix8_c(a + done, b + done, out + done, count - done, MIX_MIN);
+}
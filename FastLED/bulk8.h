@@ -0,0 +1,120 @@
+//
+//  bulk8.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef bulk8_h
+#define bulk8_h
+
+#include <stdint.h>
+
+///@file bulk8.h
+/// scale8 and friends over whole arrays, using SSE2/AVX2 or NEON where
+/// the host has it. Every function gives exactly the same bytes as calling
+/// its lib8tion counterpart on each element, a CRGB array is just treated
+/// as a flat stream of 3 * num_leds bytes.
+///
+/// On x86 the widest instruction set the cpu supports is picked at runtime,
+/// define FASTLED_NO_SIMD to always use the plain C loops.
+
+///@defgroup Bulk Bulk array functions
+///@{
+
+/// p[i] = scale8(p[i], scale) for count bytes
+void bulk_scale8(uint8_t *p, unsigned int count, uint8_t scale);
+
+/// p[i] = scale8_video(p[i], scale) for count bytes
+void bulk_scale8_video(uint8_t *p, unsigned int count, uint8_t scale);
+
+/// scale8 every r, g and b of num_leds rgb triplets by its own scale,
+/// as fadeUsingColor does
+void bulk_scale8x3(uint8_t *p, unsigned int num_leds, uint8_t r, uint8_t g, uint8_t b);
+
+/// out[i] = blend of a[i] and amount/255 of b[i], as nblend() does it.
+/// out may be the same array as a or b, but must not partially overlap them.
+void bulk_blend8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count, uint8_t amount);
+
+/// in place version of bulk_blend8, existing[i] = blend(existing[i], overlay[i])
+void bulk_nblend8(uint8_t *existing, const uint8_t *overlay, unsigned int count, uint8_t amount);
+
+/// one step of the blur filter: out[i] = in[i] scaled by keep, plus
+/// before[i] and after[i] scaled by seep, saturating, as blur1d does it.
+/// out may be in, but must not be before or after.
+void bulk_blur8(uint8_t *out, const uint8_t *in, const uint8_t *before, const uint8_t *after,
+                unsigned int count, uint8_t keep, uint8_t seep);
+
+/// p[i] = scale16(p[i], scale) for count 16 bit values, for CRGB16 arrays.
+/// An 8 bit scale s is the same as scale16by8 with scale = s << 8.
+void bulk_scale16(uint16_t *p, unsigned int count, uint16_t scale);
+
+/// 16 bit version of bulk_blend8, out[i] = scale16(a[i], 65535 - amount)
+/// + scale16(b[i], amount). Amount 0 gives a, 65535 gives b.
+void bulk_blend16(const uint16_t *a, const uint16_t *b, uint16_t *out, unsigned int count, uint16_t amount);
+
+/// out[3i..3i+2] = the first three bytes of table[index[i]], for count
+/// indexes. table has 256 entries of 4 bytes, e.g. a CPaletteLut.
+/// Uses an AVX2 gather where there is one.
+void bulk_lookup8x3(const uint8_t *index, uint8_t *out, unsigned int count, const uint32_t *table);
+
+/// 8.8 fixed point down to bytes with an ordered dither added first,
+/// out[i] = min(255, (in[i] + (uint8_t)(offset + i * step)) >> 8).
+/// step 0 and offset 128 just rounds.
+void bulk_dither16(const uint16_t *in, uint8_t *out, unsigned int count, uint8_t offset, uint8_t step);
+
+/// sum[0..2] += the sums of the first, second and third bytes of
+/// num_leds triplets, e.g. the red, green and blue of a CRGB array
+void bulk_sum8x3(const uint8_t *p, unsigned int num_leds, uint32_t sum[3]);
+
+/// the sum of count bytes
+uint32_t bulk_sum8(const uint8_t *p, unsigned int count);
+
+/// lanes of the bulk random generator, its state is 4 * RANDOM_LANES words
+#define RANDOM_LANES    8
+
+/// count random bytes from RANDOM_LANES xorshift128 generators run side by
+/// side, state[k * RANDOM_LANES + lane] is word k of a lane. Every step
+/// gives 4 bytes of every lane, what count leaves of the last step is
+/// thrown away. The state must not be all zero in any lane.
+void bulk_random8(uint32_t *state, uint8_t *out, unsigned int count);
+
+/// out[i] = sin8(theta[i]) and cos8(theta[i]), for count angles.
+/// out may be theta.
+void bulk_sin8(const uint8_t *theta, uint8_t *out, unsigned int count);
+void bulk_cos8(const uint8_t *theta, uint8_t *out, unsigned int count);
+
+/// out[i] = triwave8(in[i]), quadwave8(in[i]) and cubicwave8(in[i]).
+/// out may be in.
+void bulk_triwave8(const uint8_t *in, uint8_t *out, unsigned int count);
+void bulk_quadwave8(const uint8_t *in, uint8_t *out, unsigned int count);
+void bulk_cubicwave8(const uint8_t *in, uint8_t *out, unsigned int count);
+
+/// out[i] = sin16(theta[i]) and cos16(theta[i]), out may be theta
+void bulk_sin16(const uint16_t *theta, int16_t *out, unsigned int count);
+void bulk_cos16(const uint16_t *theta, int16_t *out, unsigned int count);
+
+/// The phase of a wave moving along the leds: out[i] is the high byte of
+/// phase + i * step, an 8.8 fixed point angle for bulk_sin8() & co. Fill
+/// an array with it and run the wave over it in place.
+void bulk_ramp8(uint8_t *out, unsigned int count, uint16_t phase, uint16_t step);
+
+/// out[i] = phase + i * step, angles for bulk_sin16()
+void bulk_ramp16(uint16_t *out, unsigned int count, uint16_t phase, uint16_t step);
+
+/// out[i] = qadd8(a[i], b[i]), the saturating add of CRGB::operator+=
+void bulk_qadd8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count);
+
+/// out[i] = scale8(a[i], b[i]), each byte scaled by the other as
+/// CRGB::nscale8(const CRGB &) does
+void bulk_mul8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count);
+
+/// out[i] = the larger and the smaller of a[i] and b[i], CRGB::operator|=
+/// and operator&=. For all four out may be a or b.
+void bulk_max8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count);
+void bulk_min8(const uint8_t *a, const uint8_t *b, uint8_t *out, unsigned int count);
+
+///@}
+
+#endif /* bulk8_h */
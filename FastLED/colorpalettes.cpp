@@ -0,0 +1,262 @@
+//
+//  colorpalettes.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>
+
+#include "FastLED.hpp"
+#include "colorpalettes.h"
+#include "bulk8.h"
+
+/***************************************************************************
+ *   Function   : ColorFromPalette
+ *   Description: color of index in a 16 entry palette. The high 4 bits
+ *                pick the entry, with LINEARBLEND the low 4 bits blend
+ *                towards the next one (entry 15 blends towards entry 0).
+ *                A brightness below 255 scales like scale8_video, but
+ *                one higher so 254 doesn't lose as much.
+ *   Parameters : pal - the palette
+ *                index - 0-255 position in it
+ *                brightness - 0-255
+ *                blendType - NOBLEND or LINEARBLEND
+ *   Returned   : the color
+ ***************************************************************************/
+
+static inline CRGB paletteBrightness(uint8_t red, uint8_t green, uint8_t blue, uint8_t brightness)
+{
+    if( brightness != 255) {
+        if( brightness ) {
+            brightness++; // adjust for rounding
+            if( red )   { red = scale8_LEAVING_R1_DIRTY( red, brightness);     red++; }
+            if( green ) { green = scale8_LEAVING_R1_DIRTY( green, brightness); green++; }
+            if( blue )  { blue = scale8_LEAVING_R1_DIRTY( blue, brightness);   blue++; }
+            cleanup_R1();
+        } else {
+            red = 0;
+            green = 0;
+            blue = 0;
+        }
+    }
+    return CRGB( red, green, blue);
+}
+
+CRGB ColorFromPalette( const CRGBPalette16& pal, uint8_t index, uint8_t brightness, TBlendType blendType)
+{
+    uint8_t hi4 = index >> 4;
+    uint8_t lo4 = index & 0x0F;
+    const CRGB* entry = &(pal[0]) + hi4;
+    uint8_t red1   = entry->red;
+    uint8_t green1 = entry->green;
+    uint8_t blue1  = entry->blue;
+
+    if( lo4 && blendType != NOBLEND) {
+        if( hi4 == 15 ) {
+            entry = &(pal[0]);
+        } else {
+            entry++;
+        }
+        uint8_t f2 = lo4 << 4;
+        uint8_t f1 = 255 - f2;
+
+        red1   = scale8_LEAVING_R1_DIRTY( red1,   f1) + scale8_LEAVING_R1_DIRTY( entry->red,   f2);
+        green1 = scale8_LEAVING_R1_DIRTY( green1, f1) + scale8_LEAVING_R1_DIRTY( entry->green, f2);
+        blue1  = scale8_LEAVING_R1_DIRTY( blue1,  f1) + scale8_LEAVING_R1_DIRTY( entry->blue,  f2);
+        cleanup_R1();
+    }
+    return paletteBrightness( red1, green1, blue1, brightness);
+}
+
+CRGB ColorFromPalette( const CRGBPalette256& pal, uint8_t index, uint8_t brightness, TBlendType)
+{
+    const CRGB* entry = &(pal[0]) + index;
+
+    return paletteBrightness( entry->red, entry->green, entry->blue, brightness);
+}
+
+CRGBPalette256::CRGBPalette256( const CRGBPalette16& rhs)
+{
+    for (int i = 0; i < 256; i++)
+        entries[i] = ColorFromPalette( rhs, i, 255, LINEARBLEND);
+}
+
+/***************************************************************************
+ *   CPaletteLut
+ ***************************************************************************/
+
+bool CPaletteLut::same( const CRGB *colors, int count, uint8_t b, TBlendType blend, bool is256)
+{
+    uint64_t h = hash64(colors, count * sizeof(CRGB), 0);
+
+    if (valid && from256 == is256 && brightness == b && blendType == blend && key == h)
+        return(true);
+    valid = true;
+    from256 = is256;
+    brightness = b;
+    blendType = blend;
+    key = h;
+    return(false);
+}
+
+void CPaletteLut::build( const CRGBPalette16& pal, uint8_t b, TBlendType blend)
+{
+    if (same(pal.entries, 16, b, blend, false))
+        return;
+    for (int i = 0; i < 256; i++) {
+        CRGB c = ColorFromPalette(pal, i, b, blend);
+        table[i] = 0;
+        memcpy(&table[i], c.raw, 3);
+    }
+}
+
+void CPaletteLut::build( const CRGBPalette256& pal, uint8_t b)
+{
+    if (same(pal.entries, 256, b, NOBLEND, true))
+        return;
+    for (int i = 0; i < 256; i++) {
+        CRGB c = ColorFromPalette(pal, i, b);
+        table[i] = 0;
+        memcpy(&table[i], c.raw, 3);
+    }
+}
+
+void CPaletteLut::map( const uint8_t *index, CRGB *out, unsigned int count) const
+{
+    bulk_lookup8x3(index, (uint8_t *)out, count, table);
+}
+
+/***************************************************************************
+ *   predefined palettes
+ ***************************************************************************/
+
+const TProgmemRGBPalette16 CloudColors_p =
+{
+    CRGB::Blue,
+    CRGB::DarkBlue,
+    CRGB::DarkBlue,
+    CRGB::DarkBlue,
+
+    CRGB::DarkBlue,
+    CRGB::DarkBlue,
+    CRGB::DarkBlue,
+    CRGB::DarkBlue,
+
+    CRGB::Blue,
+    CRGB::DarkBlue,
+    CRGB::SkyBlue,
+    CRGB::SkyBlue,
+
+    CRGB::LightBlue,
+    CRGB::White,
+    CRGB::LightBlue,
+    CRGB::SkyBlue
+};
+
+const TProgmemRGBPalette16 LavaColors_p =
+{
+    CRGB::Black,
+    CRGB::Maroon,
+    CRGB::Black,
+    CRGB::Maroon,
+
+    CRGB::DarkRed,
+    CRGB::Maroon,
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+
+    CRGB::DarkRed,
+    CRGB::DarkRed,
+    CRGB::Red,
+    CRGB::Orange,
+
+    CRGB::White,
+    CRGB::Orange,
+    CRGB::Red,
+    CRGB::DarkRed
+};
+
+const TProgmemRGBPalette16 OceanColors_p =
+{
+    CRGB::MidnightBlue,
+    CRGB::DarkBlue,
+    CRGB::MidnightBlue,
+    CRGB::Navy,
+
+    CRGB::DarkBlue,
+    CRGB::MediumBlue,
+    CRGB::SeaGreen,
+    CRGB::Teal,
+
+    CRGB::CadetBlue,
+    CRGB::Blue,
+    CRGB::DarkCyan,
+    CRGB::CornflowerBlue,
+
+    CRGB::Aquamarine,
+    CRGB::SeaGreen,
+    CRGB::Aqua,
+    CRGB::LightSkyBlue
+};
+
+const TProgmemRGBPalette16 ForestColors_p =
+{
+    CRGB::DarkGreen,
+    CRGB::DarkGreen,
+    CRGB::DarkOliveGreen,
+    CRGB::DarkGreen,
+
+    CRGB::Green,
+    CRGB::ForestGreen,
+    CRGB::OliveDrab,
+    CRGB::Green,
+
+    CRGB::SeaGreen,
+    CRGB::MediumAquamarine,
+    CRGB::LimeGreen,
+    CRGB::YellowGreen,
+
+    CRGB::LightGreen,
+    CRGB::LawnGreen,
+    CRGB::MediumAquamarine,
+    CRGB::ForestGreen
+};
+
+// the hsv2rgb_rainbow colors at hue 0, 16, 32, ...
+const TProgmemRGBPalette16 RainbowColors_p =
+{
+    0xFF0000, 0xD52A00, 0xAB5500, 0xAB7F00,
+    0xABAB00, 0x56D500, 0x00FF00, 0x00D52A,
+    0x00AB55, 0x0056AA, 0x0000FF, 0x2A00D5,
+    0x5500AB, 0x7F0081, 0xAB0055, 0xD5002B
+};
+
+// every second one of them black
+const TProgmemRGBPalette16 RainbowStripeColors_p =
+{
+    0xFF0000, 0x000000, 0xAB5500, 0x000000,
+    0xABAB00, 0x000000, 0x00FF00, 0x000000,
+    0x00AB55, 0x000000, 0x0000FF, 0x000000,
+    0x5500AB, 0x000000, 0xAB0055, 0x000000
+};
+
+// a rainbow with the greens left out
+const TProgmemRGBPalette16 PartyColors_p =
+{
+    0x5500AB, 0x84007C, 0xB5004B, 0xE5001B,
+    0xE81700, 0xB84700, 0xAB7700, 0xABAB00,
+    0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E,
+    0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9
+};
+
+// black, red, yellow, white
+const TProgmemRGBPalette16 HeatColors_p =
+{
+    0x000000,
+    0x330000, 0x660000, 0x990000, 0xCC0000, 0xFF0000,
+    0xFF3300, 0xFF6600, 0xFF9900, 0xFFCC00, 0xFFFF00,
+    0xFFFF33, 0xFFFF66, 0xFFFF99, 0xFFFFCC, 0xFFFFFF
+};
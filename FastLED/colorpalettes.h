@@ -0,0 +1,171 @@
+//
+//  colorpalettes.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef colorpalettes_h
+#define colorpalettes_h
+
+#include <stdint.h>
+#include <string.h>
+
+#include "pixeltypes.h"
+#include "colorutils.h"
+
+///@file colorpalettes.h
+/// color palettes, ColorFromPalette and a few predefined palettes
+
+///@defgroup Palettes Color palettes
+///@{
+
+/// 16 colors as 0xRRGGBB, the way the predefined palettes are stored
+typedef uint32_t TProgmemRGBPalette16[16];
+
+/// 16 colors, ColorFromPalette() blends between them for the indexes in between
+class CRGBPalette16 {
+public:
+    CRGB entries[16];
+
+    CRGBPalette16() {}
+
+    CRGBPalette16( const CRGB& c00, const CRGB& c01, const CRGB& c02, const CRGB& c03,
+                  const CRGB& c04, const CRGB& c05, const CRGB& c06, const CRGB& c07,
+                  const CRGB& c08, const CRGB& c09, const CRGB& c10, const CRGB& c11,
+                  const CRGB& c12, const CRGB& c13, const CRGB& c14, const CRGB& c15)
+    {
+        entries[0] = c00; entries[1] = c01; entries[2] = c02; entries[3] = c03;
+        entries[4] = c04; entries[5] = c05; entries[6] = c06; entries[7] = c07;
+        entries[8] = c08; entries[9] = c09; entries[10] = c10; entries[11] = c11;
+        entries[12] = c12; entries[13] = c13; entries[14] = c14; entries[15] = c15;
+    }
+
+    CRGBPalette16( const TProgmemRGBPalette16& rhs)
+    {
+        for (int i = 0; i < 16; i++)
+            entries[i] = CRGB(rhs[i]);
+    }
+
+    // all one color
+    CRGBPalette16( const CRGB& c)
+    {
+        for (int i = 0; i < 16; i++)
+            entries[i] = c;
+    }
+
+    inline CRGB& operator[] (uint8_t x) __attribute__((always_inline))
+    {
+        return entries[x];
+    }
+
+    inline const CRGB& operator[] (uint8_t x) const __attribute__((always_inline))
+    {
+        return entries[x];
+    }
+
+    operator CRGB*()
+    {
+        return &(entries[0]);
+    }
+
+    bool operator== (const CRGBPalette16& rhs) const
+    {
+        return memcmp(entries, rhs.entries, sizeof(entries)) == 0;
+    }
+
+    bool operator!= (const CRGBPalette16& rhs) const
+    {
+        return !(*this == rhs);
+    }
+};
+
+/// A color for every index, precomputed
+class CRGBPalette256 {
+public:
+    CRGB entries[256];
+
+    CRGBPalette256() {}
+
+    // the 16 colors blended out to all 256 indexes
+    CRGBPalette256( const CRGBPalette16& rhs);
+
+    CRGBPalette256( const TProgmemRGBPalette16& rhs)
+    {
+        *this = CRGBPalette256(CRGBPalette16(rhs));
+    }
+
+    inline CRGB& operator[] (uint8_t x) __attribute__((always_inline))
+    {
+        return entries[x];
+    }
+
+    inline const CRGB& operator[] (uint8_t x) const __attribute__((always_inline))
+    {
+        return entries[x];
+    }
+
+    operator CRGB*()
+    {
+        return &(entries[0]);
+    }
+
+    bool operator== (const CRGBPalette256& rhs) const
+    {
+        return memcmp(entries, rhs.entries, sizeof(entries)) == 0;
+    }
+
+    bool operator!= (const CRGBPalette256& rhs) const
+    {
+        return !(*this == rhs);
+    }
+};
+
+/// ColorFromPalette - the color of index in a palette, scaled to brightness.
+///                    With LINEARBLEND the 16 entry palette blends between
+///                    neighbouring entries, the last one wraps to the first.
+CRGB ColorFromPalette( const CRGBPalette16& pal, uint8_t index, uint8_t brightness = 255,
+                      TBlendType blendType = LINEARBLEND);
+CRGB ColorFromPalette( const CRGBPalette256& pal, uint8_t index, uint8_t brightness = 255,
+                      TBlendType blendType = NOBLEND);
+
+/// The colors ColorFromPalette() gives for all 256 indexes, for one
+/// palette, brightness and blend type, kept as 4 bytes per color so a
+/// vector gather can fetch them. build() only does the work if any of
+/// them changed since the last call.
+class CPaletteLut {
+public:
+    uint32_t table[256];                    // r, g, b and a pad byte, in memory order
+
+    CPaletteLut() : valid(false) {}
+
+    void build( const CRGBPalette16& pal, uint8_t brightness, TBlendType blendType);
+    void build( const CRGBPalette256& pal, uint8_t brightness);
+
+    // out[i] = the color of index[i]
+    void map( const uint8_t *index, CRGB *out, unsigned int count) const;
+
+private:
+    bool valid;
+    bool from256;
+    uint8_t brightness;
+    TBlendType blendType;
+    uint64_t key;                           // hash64 of the palette it was built from
+
+    bool same( const CRGB *colors, int count, uint8_t b, TBlendType blend, bool is256);
+};
+
+/// predefined palettes
+extern const TProgmemRGBPalette16 CloudColors_p;
+extern const TProgmemRGBPalette16 LavaColors_p;
+extern const TProgmemRGBPalette16 OceanColors_p;
+extern const TProgmemRGBPalette16 ForestColors_p;
+extern const TProgmemRGBPalette16 RainbowColors_p;
+extern const TProgmemRGBPalette16 RainbowStripeColors_p;
+extern const TProgmemRGBPalette16 PartyColors_p;
+extern const TProgmemRGBPalette16 HeatColors_p;
+
+///@}
+
+#endif /* colorpalettes_h */
@@ -0,0 +1,108 @@
+//
+//  fastrandom.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef fastrandom_h
+#define fastrandom_h
+
+#include <stdint.h>
+
+#include "pixeltypes.h"
+#include "bulk8.h"
+
+///@file fastrandom.h
+/// random numbers with their own state, one byte at a time or whole arrays
+
+/// A random generator that is an object rather than the one global
+/// rand16seed, so every thread or strip can have its own. It runs
+/// RANDOM_LANES xorshift128 generators side by side (see bulk_random8),
+/// random8() and friends take their bytes from a buffer of one step of
+/// all of them. The numbers are not the ones random8() gives for the same
+/// seed, but random8(lim) and random16(lim) scale them the same way.
+class CRandom {
+public:
+    CRandom(uint32_t seed = RAND16_SEED) {
+        setSeed(seed);
+    }
+    
+    // splitmix32 spreads the seed over all the lanes, so seeds next to
+    // each other still give unrelated streams
+    void setSeed(uint32_t seed) {
+        for (int i = 0; i < 4 * RANDOM_LANES; i++) {
+            uint32_t z = (seed += 0x9E3779B9);
+            z = (z ^ (z >> 16)) * 0x85EBCA6B;
+            z = (z ^ (z >> 13)) * 0xC2B2AE35;
+            state[i] = z ^ (z >> 16);
+        }
+        // a lane that is all zero stays zero
+        for (int l = 0; l < RANDOM_LANES; l++)
+            if (!(state[l] | state[RANDOM_LANES + l] | state[2 * RANDOM_LANES + l] | state[3 * RANDOM_LANES + l]))
+                state[l] = 1;
+        used = sizeof(buffer);
+    }
+    
+    uint8_t random8() {
+        if (used == sizeof(buffer)) {
+            bulk_random8(state, buffer, sizeof(buffer));
+            used = 0;
+        }
+        return buffer[used++];
+    }
+    
+    uint8_t random8(uint8_t lim) {
+        return scale8(random8(), lim);
+    }
+    
+    uint8_t random8(uint8_t min, uint8_t lim) {
+        return random8(lim - min) + min;
+    }
+    
+    uint16_t random16() {
+        uint16_t r = random8();
+        return r | random8() << 8;
+    }
+    
+    uint16_t random16(uint16_t lim) {
+        return ((uint32_t)lim * random16()) >> 16;
+    }
+    
+    uint16_t random16(uint16_t min, uint16_t lim) {
+        return random16(lim - min) + min;
+    }
+    
+    uint32_t random32() {
+        uint32_t r = random16();
+        return r | (uint32_t)random16() << 16;
+    }
+    
+    // count random bytes, straight from the vector generator
+    void random8_fill(uint8_t *out, unsigned int count) {
+        bulk_random8(state, out, count);
+    }
+    
+    // A random color for about density / 256 of the leds, the others are
+    // left as they are. Every led uses 4 random bytes, one to decide and
+    // three for the color.
+    void random_pixels(CRGB *leds, unsigned int num_leds, uint8_t density) {
+        uint8_t r[64 * 4];
+        
+        for (unsigned int i = 0; i < num_leds; i += 64) {
+            unsigned int n = (num_leds - i < 64) ? num_leds - i : 64;
+            bulk_random8(state, r, n * 4);
+            for (unsigned int j = 0; j < n; j++)
+                if (r[j * 4] < density)
+                    leds[i + j] = CRGB(r[j * 4 + 1], r[j * 4 + 2], r[j * 4 + 3]);
+        }
+    }
+    
+private:
+    uint32_t state[4 * RANDOM_LANES];
+    uint8_t buffer[4 * RANDOM_LANES];
+    uint8_t used;                           // bytes of buffer handed out
+};
+
+#endif /* fastrandom_h */
@@ -380,26 +380,219 @@ void hsv2rgb_rainbow( const CHSV& hsv, CRGB& rgb)
 }
 
 
+// Array versions.
+//
+// These do HSV_BATCH pixels at a time, one pixel per lane of a GCC
+// vector, so the compiler can map them onto SSE2/AVX2 or NEON.
+// Every branch of the scalar code above becomes a select between lanes:
+// the hue section picks its ramp formula through a compare mask instead
+// of the if/else tree. All intermediate products are 8 x 8 bits, so
+// 16 bit lanes hold them exactly and the output is identical to the
+// single pixel functions. Whatever is left over at the end goes
+// through those.
+
+#define HSV_BATCH 8
+
+typedef uint16_t hsv_vec __attribute__((vector_size(HSV_BATCH * 2)));
+
+// lanes where mask is set come from a, the others from b
+static inline hsv_vec hsv_select(hsv_vec mask, hsv_vec a, hsv_vec b)
+{
+    return (a & mask) | (b & ~mask);
+}
+
+static inline hsv_vec hsv_mask(hsv_vec a, uint16_t b)
+{
+    return (hsv_vec)(a == b);
+}
+
+static inline void hsv_load(const struct CHSV *phsv, hsv_vec &h, hsv_vec &s, hsv_vec &v)
+{
+    for (int i = 0; i < HSV_BATCH; i++) {
+        h[i] = phsv[i].hue;
+        s[i] = phsv[i].sat;
+        v[i] = phsv[i].val;
+    }
+}
+
+static inline void hsv_store(struct CRGB *prgb, hsv_vec r, hsv_vec g, hsv_vec b)
+{
+    for (int i = 0; i < HSV_BATCH; i++) {
+        prgb[i].r = r[i];
+        prgb[i].g = g[i];
+        prgb[i].b = b[i];
+    }
+}
+
+// hsv2rgb_raw_C, hue 0..191
+static inline void hsv2rgb_raw_batch(hsv_vec hue, hsv_vec sat, hsv_vec val, struct CRGB *prgb)
+{
+    hsv_vec floor = (val * (255 - sat)) >> 8;
+    hsv_vec amp = val - floor;
+    hsv_vec section = hue >> 6;
+    hsv_vec offset = hue & (HSV_SECTION_3 - 1);
+    hsv_vec up = ((offset * amp) >> 6) + floor;
+    hsv_vec down = ((((HSV_SECTION_3 - 1) - offset) * amp) >> 6) + floor;
+    
+    hsv_vec s0 = hsv_mask(section, 0);
+    hsv_vec s1 = hsv_mask(section, 1);
+    
+    hsv_store(prgb,
+              hsv_select(s0, down, hsv_select(s1, floor, up)),
+              hsv_select(s0, up, hsv_select(s1, down, floor)),
+              hsv_select(s0, floor, hsv_select(s1, up, down)));
+}
+
 void hsv2rgb_raw(const struct CHSV * phsv, struct CRGB * prgb, int numLeds) {
-    for(int i = 0; i < numLeds; i++) {
+    int i = 0;
+    for( ; i + HSV_BATCH <= numLeds; i += HSV_BATCH) {
+        hsv_vec hue, sat, val;
+        hsv_load(&phsv[i], hue, sat, val);
+        hsv2rgb_raw_batch(hue, sat, val, &prgb[i]);
+    }
+    for( ; i < numLeds; i++) {
         hsv2rgb_raw(phsv[i], prgb[i]);
     }
 }
 
+// hsv2rgb_rainbow with Y1 on and Y2, G2, Gscale off, as above
+static inline void hsv2rgb_rainbow_batch(hsv_vec hue, hsv_vec sat, hsv_vec val, struct CRGB *prgb)
+{
+    hsv_vec offset8 = (hue & 0x1F) << 3;
+    hsv_vec third = (offset8 * (256 / 3)) >> 8;
+    hsv_vec twothirds = (offset8 * ((256 * 2) / 3)) >> 8;
+    hsv_vec section = hue >> 5;
+    hsv_vec zero = hue ^ hue;
+    hsv_vec r = zero, g = zero, b = zero;
+    hsv_vec m;
+    
+    // one section per lane, so exactly one of these applies
+    m = hsv_mask(section, 0);   // R -> O
+    r |= m & (K255 - third);    g |= m & third;
+    m = hsv_mask(section, 1);   // O -> Y
+    r |= m & K171;              g |= m & (K85 + third);
+    m = hsv_mask(section, 2);   // Y -> G
+    r |= m & (K171 - twothirds); g |= m & (K171 + third);
+    m = hsv_mask(section, 3);   // G -> A
+    g |= m & (K255 - third);    b |= m & third;
+    m = hsv_mask(section, 4);   // A -> B
+    g |= m & (K171 - twothirds); b |= m & (K85 + twothirds);
+    m = hsv_mask(section, 5);   // B -> P
+    r |= m & third;             b |= m & (K255 - third);
+    m = hsv_mask(section, 6);   // P -- K
+    r |= m & (K85 + third);     b |= m & (K171 - third);
+    m = hsv_mask(section, 7);   // K -> R
+    r |= m & (K171 + third);    b |= m & (K85 - third);
+    
+    // desaturate: at sat == 255 this works out to no change,
+    // so only sat == 0 needs its own case
+    hsv_vec desat = ((255 - sat) * (255 - sat)) >> 8;
+    m = hsv_mask(sat, 0);
+    r = hsv_select(m, zero + 255, (((r * sat) >> 8) - (hsv_vec)(r != 0) + desat) & 0xFF);
+    g = hsv_select(m, zero + 255, (((g * sat) >> 8) - (hsv_vec)(g != 0) + desat) & 0xFF);
+    b = hsv_select(m, zero + 255, (((b * sat) >> 8) - (hsv_vec)(b != 0) + desat) & 0xFF);
+    
+    // dim: again no change at val == 255, val == 0 goes black
+    hsv_vec dim = ((val * val) >> 8) - (hsv_vec)(val != 0);
+    m = ~hsv_mask(val, 0);
+    r = m & (((r * dim) >> 8) - (hsv_vec)(r != 0));
+    g = m & (((g * dim) >> 8) - (hsv_vec)(g != 0));
+    b = m & (((b * dim) >> 8) - (hsv_vec)(b != 0));
+    
+    hsv_store(prgb, r, g, b);
+}
+
 void hsv2rgb_rainbow( const struct CHSV* phsv, struct CRGB * prgb, int numLeds) {
-    for(int i = 0; i < numLeds; i++) {
+    int i = 0;
+    for( ; i + HSV_BATCH <= numLeds; i += HSV_BATCH) {
+        hsv_vec hue, sat, val;
+        hsv_load(&phsv[i], hue, sat, val);
+        hsv2rgb_rainbow_batch(hue, sat, val, &prgb[i]);
+    }
+    for( ; i < numLeds; i++) {
         hsv2rgb_rainbow(phsv[i], prgb[i]);
     }
 }
 
 void hsv2rgb_spectrum( const struct CHSV* phsv, struct CRGB * prgb, int numLeds) {
-    for(int i = 0; i < numLeds; i++) {
+    int i = 0;
+    for( ; i + HSV_BATCH <= numLeds; i += HSV_BATCH) {
+        hsv_vec hue, sat, val;
+        hsv_load(&phsv[i], hue, sat, val);
+        hsv2rgb_raw_batch((hue * 192) >> 8, sat, val, &prgb[i]);
+    }
+    for( ; i < numLeds; i++) {
         hsv2rgb_spectrum(phsv[i], prgb[i]);
     }
 }
 
 
 
+// Table driven hsv2rgb_rainbow.
+//
+// The value step at the end of hsv2rgb_rainbow is exactly
+// scale8_video(c, scale8_video(val, val)) on each channel, so the
+// conversion splits into a lookup of the full value color for
+// (hue, sat) and one multiply per channel. The table holds all 64K
+// (sat, hue) pairs, 192KB, sat major so a fill_rainbow with its fixed
+// saturation only ever touches one 768 byte row of it.
+
+static CRGB *build_rainbow_table()
+{
+    CRGB *table = (CRGB *)malloc(256 * 256 * sizeof(CRGB));
+    CHSV row[256];
+    
+    if (table == NULL)
+        return NULL;            // computed it is
+    for (int sat = 0; sat < 256; sat++) {
+        for (int hue = 0; hue < 256; hue++)
+            row[hue] = CHSV(hue, sat, 255);
+        hsv2rgb_rainbow(row, &table[sat << 8], 256);
+    }
+    return table;
+}
+
+static const CRGB *rainbow_table()
+{
+    static const CRGB *table = build_rainbow_table();   // once, thread safe
+    return table;
+}
+
+void hsv2rgb_rainbow_lut( const struct CHSV* phsv, struct CRGB * prgb, int numLeds) {
+    const CRGB *table = rainbow_table();
+    int i = 0;
+    
+    if (table == NULL) {
+        hsv2rgb_rainbow(phsv, prgb, numLeds);
+        return;
+    }
+    for( ; i + HSV_BATCH <= numLeds; i += HSV_BATCH) {
+        hsv_vec r, g, b, val;
+        for (int j = 0; j < HSV_BATCH; j++) {
+            const CRGB &c = table[(phsv[i+j].sat << 8) | phsv[i+j].hue];
+            r[j] = c.r;
+            g[j] = c.g;
+            b[j] = c.b;
+            val[j] = phsv[i+j].val;
+        }
+        // scale8_video(val, val), then scale8_video of every channel by that
+        hsv_vec dim = ((val * val) >> 8) - (hsv_vec)(val != 0);
+        hsv_vec on = (hsv_vec)(dim != 0);
+        r = ((r * dim) >> 8) - (on & (hsv_vec)(r != 0));
+        g = ((g * dim) >> 8) - (on & (hsv_vec)(g != 0));
+        b = ((b * dim) >> 8) - (on & (hsv_vec)(b != 0));
+        hsv_store(&prgb[i], r, g, b);
+    }
+    for( ; i < numLeds; i++) {
+        const CRGB &c = table[(phsv[i].sat << 8) | phsv[i].hue];
+        uint8_t dim = scale8_video(phsv[i].val, phsv[i].val);
+        prgb[i].r = scale8_video(c.r, dim);
+        prgb[i].g = scale8_video(c.g, dim);
+        prgb[i].b = scale8_video(c.b, dim);
+    }
+}
+
+
 #define FIXFRAC8(N,D) (((N)*256)/(D))
 
 // This function is only an approximation, and it is not
@@ -598,3 +791,138 @@ CHSV rgb2hsv_approximate( const CRGB& rgb)
 
 
 
+
+
+// Array version of rgb2hsv_approximate.
+//
+// Four pixels at a time in 32 bit lanes, so the scale up products fit.
+// The two sqrt16 calls and the two divides become lookups in tables
+// built once on first use, and every if/else in the scalar function
+// becomes a compare mask. Both reciprocals work out to no change at
+// the boundary values (x * 257 / 256 == x for any byte), so they can
+// be applied to every lane. The result is identical to the scalar code.
+
+#define RGB2HSV_BATCH 4
+
+typedef uint32_t rgb2hsv_vec __attribute__((vector_size(RGB2HSV_BATCH * 4)));
+
+struct rgb2hsv_tables {
+    uint8_t  sqrt[256];             // sqrt16(x * 256)
+    uint16_t recip[256];            // 65535 / x, 0 treated as 1
+    
+    rgb2hsv_tables() {
+        for (int x = 0; x < 256; x++) {
+            sqrt[x] = sqrt16(x * 256);
+            recip[x] = 65535 / (x ? x : 1);
+        }
+    }
+};
+
+static const rgb2hsv_tables &rgb2hsv_table()
+{
+    static const rgb2hsv_tables tables;     // once, thread safe
+    return tables;
+}
+
+static inline rgb2hsv_vec rgb2hsv_select(rgb2hsv_vec mask, rgb2hsv_vec a, rgb2hsv_vec b)
+{
+    return (a & mask) | (b & ~mask);
+}
+
+static inline rgb2hsv_vec rgb2hsv_qsub8(rgb2hsv_vec a, rgb2hsv_vec b)
+{
+    return (rgb2hsv_vec)(a > b) & (a - b);
+}
+
+static inline rgb2hsv_vec rgb2hsv_scale8(rgb2hsv_vec a, uint8_t scale)
+{
+    return (a * scale) >> 8;
+}
+
+static void rgb2hsv_batch(const struct CRGB *prgb, struct CHSV *phsv, const rgb2hsv_tables &t)
+{
+    rgb2hsv_vec r, g, b, desat, s, recip, v;
+    
+    for (int i = 0; i < RGB2HSV_BATCH; i++) {
+        r[i] = prgb[i].r;
+        g[i] = prgb[i].g;
+        b[i] = prgb[i].b;
+    }
+    desat = rgb2hsv_select((rgb2hsv_vec)(r < g), r, g);
+    desat = rgb2hsv_select((rgb2hsv_vec)(desat < b), desat, b);
+    r -= desat;
+    g -= desat;
+    b -= desat;
+    
+    rgb2hsv_vec gray = (rgb2hsv_vec)((r + g + b) == 0);
+    
+    // undo 'dimming' of saturation, and scale up for it
+    for (int i = 0; i < RGB2HSV_BATCH; i++) {
+        s[i] = 255 - t.sqrt[desat[i]];
+        recip[i] = t.recip[s[i]];
+    }
+    r = ((r * recip) >> 8) & 0xFF;
+    g = ((g * recip) >> 8) & 0xFF;
+    b = ((b * recip) >> 8) & 0xFF;
+    
+    // scale up for low values, unless total > 255
+    rgb2hsv_vec total = r + g + b;
+    rgb2hsv_vec low = (rgb2hsv_vec)(total <= 255);
+    for (int i = 0; i < RGB2HSV_BATCH; i++)
+        recip[i] = t.recip[total[i] & 0xFF];
+    recip = rgb2hsv_select(low, recip, recip - recip + 257);
+    r = ((r * recip) >> 8) & 0xFF;
+    g = ((g * recip) >> 8) & 0xFF;
+    b = ((b * recip) >> 8) & 0xFF;
+    
+    // undo 'dimming' of brightness, sqrt[255] is 255. The scalar code
+    // bumps a total of 0 up to 1 before dividing, and keeps using it.
+    total += (rgb2hsv_vec)(total == 0) & 1;
+    rgb2hsv_vec sum = desat + total;
+    sum = rgb2hsv_select((rgb2hsv_vec)(sum > 255), sum - sum + 255, sum);
+    for (int i = 0; i < RGB2HSV_BATCH; i++)
+        v[i] = low[i] ? t.sqrt[sum[i]] : 255;
+    
+    // every candidate hue, then pick the one the scalar code would
+    rgb2hsv_vec hRed    = (uint32_t)HUE_RED + rgb2hsv_scale8(g, FIXFRAC8(32,85));
+    rgb2hsv_vec hPink   = (HUE_PURPLE + HUE_PINK) / 2 + rgb2hsv_scale8(rgb2hsv_qsub8(r, r - r + 128), FIXFRAC8(48,128));
+    rgb2hsv_vec hOrange = (uint32_t)HUE_ORANGE + rgb2hsv_scale8(rgb2hsv_qsub8((g - r + 86) & 0xFF, r - r + 4), FIXFRAC8(32,85));
+    rgb2hsv_vec radj    = rgb2hsv_scale8(rgb2hsv_qsub8(r - r + 171, r), 47);
+    rgb2hsv_vec gadj    = rgb2hsv_scale8(rgb2hsv_qsub8(g, g - g + 171), 96);
+    rgb2hsv_vec hYellow = (uint32_t)HUE_YELLOW + (((radj + gadj) & 0xFF) >> 1);
+    rgb2hsv_vec hGreen  = (uint32_t)HUE_GREEN + rgb2hsv_scale8(b, FIXFRAC8(32,85));
+    rgb2hsv_vec hAqua   = (uint32_t)HUE_AQUA + rgb2hsv_scale8(rgb2hsv_qsub8(b, b - b + 85), FIXFRAC8(8,42));
+    rgb2hsv_vec hBlue0  = (uint32_t)HUE_AQUA + ((HUE_BLUE - HUE_AQUA) / 4) + rgb2hsv_scale8(rgb2hsv_qsub8(b, b - b + 128), FIXFRAC8(24,128));
+    rgb2hsv_vec hBlue   = (uint32_t)HUE_BLUE + rgb2hsv_scale8(r, FIXFRAC8(32,85));
+    rgb2hsv_vec hPurple = (uint32_t)HUE_PURPLE + rgb2hsv_scale8(rgb2hsv_qsub8(r, r - r + 85), FIXFRAC8(32,85));
+    
+    rgb2hsv_vec hR = rgb2hsv_select((rgb2hsv_vec)(g == 0), hPink,
+                                    rgb2hsv_select((rgb2hsv_vec)(r - g > g), hRed, hOrange));
+    rgb2hsv_vec hG = rgb2hsv_select((rgb2hsv_vec)(b == 0), hYellow,
+                                    rgb2hsv_select((rgb2hsv_vec)(g - b > b), hGreen, hAqua));
+    rgb2hsv_vec hB = rgb2hsv_select((rgb2hsv_vec)(r == 0), hBlue0,
+                                    rgb2hsv_select((rgb2hsv_vec)(b - r > r), hBlue, hPurple));
+    rgb2hsv_vec highR = (rgb2hsv_vec)((r >= g) & (r >= b));
+    rgb2hsv_vec highG = (rgb2hsv_vec)(g >= b);
+    rgb2hsv_vec h = rgb2hsv_select(highR, hR, rgb2hsv_select(highG, hG, hB)) + 1;
+    
+    for (int i = 0; i < RGB2HSV_BATCH; i++) {
+        if (gray[i])
+            phsv[i] = CHSV(0, 0, 255 - s[i]);
+        else
+            phsv[i] = CHSV(h[i], s[i], v[i]);
+    }
+}
+
+void rgb2hsv_approximate( const struct CRGB * prgb, struct CHSV * phsv, int numLeds)
+{
+    const rgb2hsv_tables &t = rgb2hsv_table();
+    int i = 0;
+    
+    for( ; i + RGB2HSV_BATCH <= numLeds; i += RGB2HSV_BATCH) {
+        rgb2hsv_batch(&prgb[i], &phsv[i], t);
+    }
+    for( ; i < numLeds; i++) {
+        phsv[i] = rgb2hsv_approximate(prgb[i]);
+    }
+}
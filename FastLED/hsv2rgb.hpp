@@ -26,6 +26,14 @@ void hsv2rgb_rainbow( const struct CHSV& hsv, struct CRGB& rgb);
 void hsv2rgb_rainbow( const struct CHSV* phsv, struct CRGB * prgb, int numLeds);
 #define HUE_MAX_RAINBOW 255
 
+// hsv2rgb_rainbow_lut - same output as hsv2rgb_rainbow, but looks the
+//                       full brightness color up in a 192KB (hue, sat)
+//                       table that is built on the first call.
+//                       Faster when the table stays in cache, e.g. few
+//                       distinct saturations as in fill_rainbow.
+
+void hsv2rgb_rainbow_lut( const struct CHSV* phsv, struct CRGB * prgb, int numLeds);
+
 
 // hsv2rgb_spectrum - convert a hue, saturation, and value to RGB
 //                    using a mathematically straight spectrum (vs
@@ -93,6 +101,10 @@ void hsv2rgb_raw(const struct CHSV* phsv, struct CRGB * prgb, int numLeds);
 //
 CHSV rgb2hsv_approximate( const CRGB& rgb);
 
+// rgb2hsv_approximate for a whole array, same results as calling the
+// above on every pixel, without the branches and divides
+void rgb2hsv_approximate( const struct CRGB * prgb, struct CHSV * phsv, int numLeds);
+
 
 
 #endif /* hsv2rgb_hpp */
@@ -0,0 +1,178 @@
+//
+//  layers.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "FastLED.hpp"
+#include "layers.h"
+#include "bulk8.h"
+
+CCompositor::CCompositor(CRGB *out, uint16_t num) : damage(out, num)
+{
+    leds = out;
+    numLeds = num;
+    output = NULL;
+    background = CRGB::Black;
+    seenBackground = background;
+    numLayers = 0;
+}
+
+CCompositor::CCompositor(CTrackedLeds & out) : CCompositor(out.leds, out.numLeds)
+{
+    output = &out;
+}
+
+int CCompositor::addLayer(CLayer & l)
+{
+    if (l.numLeds != numLeds || numLayers >= MAX_LAYERS) {
+        puts("addLayer() layer doesn't fit");
+        return(-1);
+    }
+    l.seen = false;                     // compose() does all of it
+    layers[numLayers] = &l;
+    return(numLayers++);
+}
+
+void CCompositor::removeLayer(CLayer & l)
+{
+    for (uint8_t n = 0; n < numLayers; n++) {
+        if (layers[n] != &l)
+            continue;
+        memmove(&layers[n], &layers[n + 1], (numLayers - n - 1) * sizeof(layers[0]));
+        numLayers--;
+        if (l.seen && l.seenShows)
+            damage.markAll();
+        return;
+    }
+}
+
+bool CCompositor::touch(const CRGB *l, uint16_t count)
+{
+    for (uint8_t n = 0; n < numLayers; n++) {
+        if (layers[n]->contains(l, count)) {
+            layers[n]->mark(l - layers[n]->leds, count);
+            return(true);
+        }
+    }
+    return(false);
+}
+
+/***************************************************************************
+ *   Function   : compose
+ *   Description: Collect the chunks the layers wrote to and composite
+ *                the runs of them into the output. A layer that changed
+ *                its settings, or came or went, changes every chunk.
+ *                What hidden layers write to is dropped, they are done
+ *                all over when they show again.
+ *   Parameters : none
+ *   Returned   : number of leds composited
+ ***************************************************************************/
+
+unsigned int CCompositor::compose()
+{
+    unsigned int words = (damage.numChunks + 63) / 64;
+    unsigned int done = 0;
+    uint16_t chunk = 0, run;
+
+    if (background != seenBackground) {
+        seenBackground = background;
+        damage.markAll();
+    }
+    for (uint8_t n = 0; n < numLayers; n++) {
+        CLayer *l = layers[n];
+        bool shows = l->shows();
+
+        if (!l->seen || l->mode != l->seenMode || l->opacity != l->seenOpacity || shows != l->seenShows) {
+            if (shows || (l->seen && l->seenShows))
+                damage.markAll();
+            l->seen = true;
+            l->seenMode = l->mode;
+            l->seenOpacity = l->opacity;
+            l->seenShows = shows;
+        }
+        if (shows)
+            for (unsigned int w = 0; w < words; w++)
+                damage.dirty[w] |= l->dirty[w];
+        l->clear();
+    }
+
+    while (damage.nextDirty(&chunk, &run)) {
+        uint32_t start = (uint32_t)chunk << TRACK_CHUNK_SHIFT;
+        uint32_t count = (uint32_t)run << TRACK_CHUNK_SHIFT;
+
+        if (start + count > numLeds)
+            count = numLeds - start;
+        composeSpan(start, count);
+        if (output)
+            output->mark(start, count);
+        done += count;
+        chunk += run;
+    }
+    damage.clear();
+    return(done);
+}
+
+// mixed[] = out[] combined with layer[] as mode says, count bytes
+static void mixLayer(const uint8_t *out, const uint8_t *layer, uint8_t *mixed, unsigned int count, TLayerMode mode)
+{
+    switch (mode) {
+        case LAYER_ADD: bulk_qadd8(out, layer, mixed, count); break;
+        case LAYER_MULTIPLY: bulk_mul8(out, layer, mixed, count); break;
+        case LAYER_MAX: bulk_max8(out, layer, mixed, count); break;
+        default: bulk_min8(out, layer, mixed, count); break;
+    }
+}
+
+// Put one layer on top of out[]. Normal layers are just a blend, the
+// others are mixed into out[] straight away at full opacity and through
+// a block on the stack below it.
+static void composeLayer(uint8_t *out, const uint8_t *layer, unsigned int count, TLayerMode mode, uint8_t opacity)
+{
+    uint8_t mixed[COMPOSE_BLOCK * 3];
+
+    if (mode == LAYER_NORMAL) {
+        bulk_nblend8(out, layer, count, opacity);
+        return;
+    }
+    if (opacity == 255) {
+        mixLayer(out, layer, out, count, mode);
+        return;
+    }
+    for (unsigned int i = 0; i < count; i += sizeof(mixed)) {
+        unsigned int n = (count - i < sizeof(mixed)) ? count - i : sizeof(mixed);
+        mixLayer(out + i, layer + i, mixed, n, mode);
+        bulk_nblend8(out + i, mixed, n, opacity);
+    }
+}
+
+// Composite count leds from start. Everything below the topmost opaque
+// normal layer is covered by it, so that one is copied and the ones
+// below it aren't looked at.
+void CCompositor::composeSpan(uint16_t start, uint16_t count)
+{
+    uint8_t *out = (uint8_t *)&leds[start];
+    int n;
+
+    for (n = numLayers - 1; n >= 0; n--)
+        if (layers[n]->shows() && layers[n]->mode == LAYER_NORMAL && layers[n]->opacity == 255)
+            break;
+    if (n >= 0) {
+        memcpy(out, &layers[n]->leds[start], count * 3);
+    } else {
+        for (uint16_t i = 0; i < count; i++)
+            leds[start + i] = background;
+    }
+
+    for (n++; n < numLayers; n++) {
+        CLayer *l = layers[n];
+        if (l->shows())
+            composeLayer(out, (const uint8_t *)&l->leds[start], count * 3, l->mode, l->opacity);
+    }
+}
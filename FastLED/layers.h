@@ -0,0 +1,118 @@
+//
+//  layers.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef layers_h
+#define layers_h
+
+#include <stdint.h>
+#include <stdio.h>          // puts
+#include <stdlib.h>         // calloc, abort
+
+#include "pixeltypes.h"
+#include "trackedleds.h"
+
+///@file layers.h
+/// led buffers stacked on top of each other and composited into one
+
+#define MAX_LAYERS      8
+#define COMPOSE_BLOCK   256                 // leds mixed at a time for a layer below full opacity
+
+/// How a layer goes on top of what is below it
+typedef enum {
+    LAYER_NORMAL,                           // covers it
+    LAYER_ADD,                              // qadd8, CRGB::operator+=
+    LAYER_MULTIPLY,                         // scale8 by the layer, CRGB::nscale8(const CRGB &)
+    LAYER_MAX,                              // the brighter of the two, CRGB::operator|=
+    LAYER_MIN                               // the darker of the two, CRGB::operator&=
+} TLayerMode;
+
+/// One layer of a CCompositor, with leds of its own. Writes are tracked
+/// the way a CTrackedLeds does it, so writes through the raw pointer need
+/// a mark(). Below opacity 255 the combined color is nblend()ed over
+/// what is underneath by that much. mode, opacity and visible can be
+/// changed any time, the next compose() redoes the whole layer.
+class CLayer : public CTrackedLeds {
+public:
+    TLayerMode mode;
+    uint8_t opacity;
+    bool visible;
+
+    CLayer(uint16_t num, TLayerMode m = LAYER_NORMAL, uint8_t o = 255)
+        : CTrackedLeds((CRGB *)calloc(num, sizeof(CRGB)), num) {
+        if (num && leds == NULL) {
+            puts("CLayer out of memory");
+            abort();
+        }
+        mode = m;
+        opacity = o;
+        visible = true;
+        seen = false;
+    }
+
+    ~CLayer() {
+        free(leds);
+    }
+
+    // does it change anything at all
+    bool shows() const {
+        return visible && opacity;
+    }
+
+private:
+    friend class CCompositor;
+    bool seen;                              // by compose(), since it was added
+    TLayerMode seenMode;                    // the settings compose() last used
+    uint8_t seenOpacity;
+    bool seenShows;
+
+    // owns its leds, and CTrackedLeds can't be copied either
+    CLayer(const CLayer &);
+    CLayer & operator= (const CLayer &);
+};
+
+/// Composites up to MAX_LAYERS layers, bottom first, over a background
+/// color into an output buffer. compose() only redoes the chunks some
+/// layer wrote to since the last time, and only marks those in the output
+/// if that is a CTrackedLeds, so transfer() doesn't look at the rest
+/// either. The output is overwritten there, drawing into it directly
+/// is lost the next time the layers above it change.
+class CCompositor {
+public:
+    CRGB *leds;                             // where the layers end up
+    uint16_t numLeds;
+    CTrackedLeds *output;                   // NULL if the output is a plain array
+    CRGB background;                        // below the bottom layer, black by default
+    CLayer *layers[MAX_LAYERS];             // bottom first
+    uint8_t numLayers;
+
+    CCompositor(CRGB *out, uint16_t num);
+    CCompositor(CTrackedLeds & out);
+
+    // put l on top of the others, returns its index or -1
+    int addLayer(CLayer & l);
+    void removeLayer(CLayer & l);
+
+    // mark the leds of a layer as written to, false if they are not in one
+    bool touch(const CRGB *l, uint16_t count);
+
+    // redo everything the next compose()
+    void invalidate() {
+        damage.markAll();
+    }
+
+    // bring the output up to date, returns the number of leds redone
+    unsigned int compose();
+
+private:
+    CTrackedLeds damage;                    // output chunks compose() has to redo
+    CRGB seenBackground;
+
+    void composeSpan(uint16_t start, uint16_t count);
+};
+
+#endif /* layers_h */
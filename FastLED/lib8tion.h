@@ -480,6 +480,21 @@ LIB8STATIC uint8_t ease8InOutQuad( uint8_t i)
     return jj2;
 }
 
+/// ease16InOutQuad: 16-bit quadratic ease-in / ease-out function
+LIB8STATIC uint16_t ease16InOutQuad( uint16_t i)
+{
+    uint16_t j = i;
+    if( j & 0x8000 ) {
+        j = 65535 - j;
+    }
+    uint16_t jj  = scale16( j, j);
+    uint16_t jj2 = jj << 1;
+    if( i & 0x8000 ) {
+        jj2 = 65535 - jj2;
+    }
+    return jj2;
+}
+
 
 /// ease8InOutCubic: 8-bit cubic ease-in / ease-out function
 ///                 Takes around 18 cycles on AVR
@@ -695,7 +710,14 @@ typedef q<uint16_t, 12,4> q124;
 // that provides similar functionality.
 // You can also force use of the get_millisecond_timer function
 // by #defining USE_GET_MILLISECOND_TIMER.
+//
+// Here it is a frame clock (FastLED.cpp): call frame_clock_begin() before
+// working out a frame and every wave and timer in it sees the same time,
+// read from the system clock only once. NetworkLed::show() of all strips
+// ends the frame, show(strip) doesn't. Outside a frame it is millis().
 uint32_t get_millisecond_timer();
+void frame_clock_begin();
+void frame_clock_end();
 #define GET_MILLIS get_millisecond_timer
 
 
@@ -911,15 +933,29 @@ typedef CEveryNTimePeriods<uint8_t,hours8> CEveryNHours;
 #define CONCAT_HELPER( x, y ) x##y
 #define CONCAT_MACRO( x, y ) CONCAT_HELPER( x, y )
 #define EVERY_N_MILLIS(N) EVERY_N_MILLIS_I(CONCAT_MACRO(PER, __COUNTER__ ),N)
-#define EVERY_N_MILLIS_I(NAME,N) static CEveryNMillis NAME(N); if( NAME )
 #define EVERY_N_SECONDS(N) EVERY_N_SECONDS_I(CONCAT_MACRO(PER, __COUNTER__ ),N)
-#define EVERY_N_SECONDS_I(NAME,N) static CEveryNSeconds NAME(N); if( NAME )
 #define EVERY_N_BSECONDS(N) EVERY_N_BSECONDS_I(CONCAT_MACRO(PER, __COUNTER__ ),N)
-#define EVERY_N_BSECONDS_I(NAME,N) static CEveryNBSeconds NAME(N); if( NAME )
 #define EVERY_N_MINUTES(N) EVERY_N_MINUTES_I(CONCAT_MACRO(PER, __COUNTER__ ),N)
-#define EVERY_N_MINUTES_I(NAME,N) static CEveryNMinutes NAME(N); if( NAME )
 #define EVERY_N_HOURS(N) EVERY_N_HOURS_I(CONCAT_MACRO(PER, __COUNTER__ ),N)
+
+#ifdef FASTLED_TIMER_WHEEL
+// The timers go on timerWheel, which frame_clock_begin() steps once per
+// frame, and the test at the call site only looks at a flag. A loop
+// without frame_clock_begin() still works, the test steps the wheel
+// up to the clock itself when nothing else did.
+#include "timerwheel.h"
+#define EVERY_N_MILLIS_I(NAME,N) static CWheelTimer NAME(N); if( NAME )
+#define EVERY_N_SECONDS_I(NAME,N) static CWheelTimer NAME((uint32_t)(N) * 1000); if( NAME )
+#define EVERY_N_BSECONDS_I(NAME,N) static CWheelTimer NAME((uint32_t)(N) * 1024); if( NAME )
+#define EVERY_N_MINUTES_I(NAME,N) static CWheelTimer NAME((uint32_t)(N) * 60000); if( NAME )
+#define EVERY_N_HOURS_I(NAME,N) static CWheelTimer NAME((uint32_t)(N) * 3600000); if( NAME )
+#else
+#define EVERY_N_MILLIS_I(NAME,N) static CEveryNMillis NAME(N); if( NAME )
+#define EVERY_N_SECONDS_I(NAME,N) static CEveryNSeconds NAME(N); if( NAME )
+#define EVERY_N_BSECONDS_I(NAME,N) static CEveryNBSeconds NAME(N); if( NAME )
+#define EVERY_N_MINUTES_I(NAME,N) static CEveryNMinutes NAME(N); if( NAME )
 #define EVERY_N_HOURS_I(NAME,N) static CEveryNHours NAME(N); if( NAME )
+#endif
 
 #define CEveryNMilliseconds CEveryNMillis
 #define EVERY_N_MILLISECONDS(N) EVERY_N_MILLIS(N)
@@ -23,6 +23,7 @@ void setup() {
     strip1.Connect((char *)"10.0.1.11");
     strip1.SetNumLeds(100);
     strip1.setBrightness(40);
+    strip1.setColorOrder(BGR);
     strip1.clear();
     
     for (int i = 0; i < 40; i++)
@@ -32,6 +33,7 @@ void setup() {
 void loop() {
     static uint8_t gHue = 0;
     for ( int i = 0; i < 100; i++) {
+        frame_clock_begin();            // show() ends it
         strip1.fadeToBlackBy(leds, 100, 50);
         leds[i] = CHSV(gHue++, 240,240);
         strip1.transfer();
@@ -0,0 +1,176 @@
+//
+//  matrixlayout.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef matrixlayout_h
+#define matrixlayout_h
+
+#include <stdint.h>
+
+#include "pixeltypes.h"
+
+///@file matrixlayout.h
+/// how the leds of a matrix are wired, as types instead of an XY() callback
+///
+/// Every layout has a width, a height and index(x, y), which returns the
+/// led number of column x, row y. For the template layouts all of it is
+/// known at compile time and index() is static, so a loop over a matrix
+/// compiles down to plain arithmetic the compiler can inline and vectorize:
+///
+///     typedef CSerpentineLayout<16, 16> Layout;
+///     for (uint16_t y = 0; y < Layout::height; y++)
+///         for (uint16_t x = 0; x < Layout::width; x++)
+///             leds[Layout::index(x, y)] = CHSV(x * 16 + y, 255, 255);
+///
+/// CTableLayout covers wiring that doesn't follow any pattern.
+///
+/// The led numbers are 16 bits, a layout has at most LAYOUT_MAX_LEDS
+/// leds. The template layouts check that when they are compiled,
+/// NetworkLed::setLayout() checks a CTableLayout when it gets one.
+
+#define LAYOUT_MAX_LEDS     65535
+
+///@defgroup Layouts Matrix layouts
+///@{
+
+/// rows one after the other, all left to right
+template<uint16_t W, uint16_t H> struct CRowMajorLayout {
+    static const uint16_t width = W;
+    static const uint16_t height = H;
+    static_assert((uint32_t)W * H <= LAYOUT_MAX_LEDS, "too many leds for a layout");
+
+    static inline uint16_t index(uint16_t x, uint16_t y) {
+        return y * W + x;
+    }
+};
+
+/// rows one after the other, every second row right to left
+template<uint16_t W, uint16_t H> struct CSerpentineLayout {
+    static const uint16_t width = W;
+    static const uint16_t height = H;
+    static_assert((uint32_t)W * H <= LAYOUT_MAX_LEDS, "too many leds for a layout");
+
+    static inline uint16_t index(uint16_t x, uint16_t y) {
+        return y * W + ((y & 1) ? (W - 1 - x) : x);
+    }
+};
+
+/// columns one after the other, all top to bottom
+template<uint16_t W, uint16_t H> struct CColumnMajorLayout {
+    static const uint16_t width = W;
+    static const uint16_t height = H;
+    static_assert((uint32_t)W * H <= LAYOUT_MAX_LEDS, "too many leds for a layout");
+
+    static inline uint16_t index(uint16_t x, uint16_t y) {
+        return x * H + y;
+    }
+};
+
+/// columns one after the other, every second column bottom to top
+template<uint16_t W, uint16_t H> struct CColumnSerpentineLayout {
+    static const uint16_t width = W;
+    static const uint16_t height = H;
+    static_assert((uint32_t)W * H <= LAYOUT_MAX_LEDS, "too many leds for a layout");
+
+    static inline uint16_t index(uint16_t x, uint16_t y) {
+        return x * H + ((x & 1) ? (H - 1 - y) : y);
+    }
+};
+
+/// PX x PY panels, each wired as PANEL, chained row by row.
+/// With SERPENTINE every second row of panels is chained right to left.
+template<class PANEL, uint16_t PX, uint16_t PY, bool SERPENTINE = false> struct CTiledLayout {
+    static const uint16_t width = PANEL::width * PX;
+    static const uint16_t height = PANEL::height * PY;
+    static_assert((uint64_t)PANEL::width * PANEL::height * PX * PY <= LAYOUT_MAX_LEDS, "too many leds for a layout");
+
+    static inline uint16_t index(uint16_t x, uint16_t y) {
+        uint16_t col = x / PANEL::width;
+        uint16_t row = y / PANEL::height;
+        if (SERPENTINE && (row & 1))
+            col = PX - 1 - col;
+        return (row * PX + col) * (PANEL::width * PANEL::height)
+            + PANEL::index(x % PANEL::width, y % PANEL::height);
+    }
+};
+
+/// LAYOUT turned by ROTATE quarter turns clockwise, after mirroring
+/// left to right if MIRROR is set. Turning by 1 or 3 swaps width and height.
+template<class LAYOUT, uint8_t ROTATE = 0, bool MIRROR = false> struct CTransformedLayout {
+    static const uint16_t width = (ROTATE & 1) ? LAYOUT::height : LAYOUT::width;
+    static const uint16_t height = (ROTATE & 1) ? LAYOUT::width : LAYOUT::height;
+
+    static inline uint16_t index(uint16_t x, uint16_t y) {
+        if (MIRROR)
+            x = width - 1 - x;
+        switch (ROTATE & 3) {
+            case 1:  return LAYOUT::index(y, LAYOUT::height - 1 - x);
+            case 2:  return LAYOUT::index(LAYOUT::width - 1 - x, LAYOUT::height - 1 - y);
+            case 3:  return LAYOUT::index(LAYOUT::width - 1 - y, x);
+            default: return LAYOUT::index(x, y);
+        }
+    }
+};
+
+/// Irregular wiring: table[y * width + x] is the led number of (x, y).
+/// The table is not copied and has to stay around.
+struct CTableLayout {
+    uint16_t width;
+    uint16_t height;
+    const uint16_t *table;
+
+    CTableLayout(uint16_t w, uint16_t h, const uint16_t *t) : width(w), height(h), table(t) {}
+
+    inline uint16_t index(uint16_t x, uint16_t y) const {
+        return table[y * width + x];
+    }
+};
+
+/// Tells layouts apart, to know when a table built from one is out of
+/// date. All layouts of a type map the same, a table layout maps as its
+/// table says.
+template<class LAYOUT> const void *layoutTag(const LAYOUT &)
+{
+    static const char tag = 0;
+    return &tag;
+}
+
+inline const void *layoutTag(const CTableLayout & layout)
+{
+    return layout.table;
+}
+
+/// Write the led number of every (x, y) of a layout to table,
+/// row-major, e.g. to turn a template layout into a CTableLayout
+/// that can be chosen at runtime.
+template<class LAYOUT> void layoutTable(const LAYOUT & layout, uint16_t *table)
+{
+    for (uint16_t y = 0; y < layout.height; y++)
+        for (uint16_t x = 0; x < layout.width; x++)
+            table[(uint32_t)y * layout.width + x] = layout.index(x, y);
+}
+
+/// A led array seen through a layout, m(x, y) is the led at column x, row y
+template<class LAYOUT> class CMatrix {
+public:
+    CRGB *leds;
+    LAYOUT layout;
+
+    CMatrix(CRGB *l, const LAYOUT & lay = LAYOUT()) : leds(l), layout(lay) {}
+
+    inline CRGB& operator() (uint16_t x, uint16_t y) __attribute__((always_inline))
+    {
+        return leds[layout.index(x, y)];
+    }
+
+    inline uint16_t width() const { return layout.width; }
+    inline uint16_t height() const { return layout.height; }
+};
+
+///@}
+
+#endif /* matrixlayout_h */
@@ -0,0 +1,753 @@
+//
+//  noise.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#include <stdint.h>
+#include <string.h>
+
+#include "FastLED.hpp"
+#include "noise.h"
+
+// Ken Perlin's permutation, the same one upstream uses. Cell coordinates
+// are 8 bits and every index wraps, so P(255 + 1) is P(0).
+static const uint8_t p[256] = {
+    151,160,137, 91, 90, 15,131, 13,201, 95, 96, 53,194,233,  7,225,
+    140, 36,103, 30, 69,142,  8, 99, 37,240, 21, 10, 23,190,  6,148,
+    247,120,234, 75,  0, 26,197, 62, 94,252,219,203,117, 35, 11, 32,
+     57,177, 33, 88,237,149, 56, 87,174, 20,125,136,171,168, 68,175,
+     74,165, 71,134,139, 48, 27,166, 77,146,158,231, 83,111,229,122,
+     60,211,133,230,220,105, 92, 41, 55, 46,245, 40,244,102,143, 54,
+     65, 25, 63,161,  1,216, 80, 73,209, 76,132,187,208, 89, 18,169,
+    200,196,135,130,116,188,159, 86,164,100,109,198,173,186,  3, 64,
+     52,217,226,250,124,123,  5,202, 38,147,118,126,255, 82, 85,212,
+    207,206, 59,227, 47, 16, 58, 17,182,189, 28, 42,223,183,170,213,
+    119,248,152,  2, 44,154,163, 70,221,153,101,155,167, 43,172,  9,
+    129, 22, 39,253, 19, 98,108,110, 79,113,224,232,178,185,112,104,
+    218,246, 97,228,251, 34,242,193,238,210,144, 12,191,179,162,241,
+     81, 51,145,235,249, 14,239,107, 49,192,214, 31,181,199,106,157,
+    184, 84,204,176,115,121, 50, 45,127,  4,150,254,138,236,205, 93,
+    222,114, 67, 29, 24, 72,243,141,128,195, 78, 66,215, 61,156,180
+};
+
+#define P(x)    p[(uint8_t)(x)]
+
+// Hashes of the corners of the cell at X, Y, Z, in the order
+// (0,0,0) (1,0,0) (0,1,0) (1,1,0) (0,0,1) (1,0,1) (0,1,1) (1,1,1).
+// The 2d noise uses the first 4 with Z = 0, the 1d noise the first 2
+// with Y = Z = 0, that is exactly what upstream hashes for those.
+static inline void cornerHashes(uint8_t X, uint8_t Y, uint8_t Z, int corners, uint8_t *h)
+{
+    uint8_t A = P(X) + Y;
+    uint8_t AA = P(A) + Z;
+    uint8_t B = P(X + 1) + Y;
+    uint8_t BA = P(B) + Z;
+
+    h[0] = P(AA);
+    h[1] = P(BA);
+    if (corners == 2)
+        return;
+
+    uint8_t AB = P(A + 1) + Z;
+    uint8_t BB = P(B + 1) + Z;
+
+    h[2] = P(AB);
+    h[3] = P(BB);
+    if (corners == 4)
+        return;
+    h[4] = P(AA + 1);
+    h[5] = P(BA + 1);
+    h[6] = P(AB + 1);
+    h[7] = P(BB + 1);
+}
+
+/***************************************************************************
+ *   16 bit noise
+ ***************************************************************************/
+
+static inline int16_t grad16(uint8_t hash, int16_t x, int16_t y, int16_t z)
+{
+    hash = hash & 15;
+    int16_t u = hash < 8 ? x : y;
+    int16_t v = hash < 4 ? y : (hash == 12 || hash == 14) ? x : z;
+    if (hash & 1) u = -u;
+    if (hash & 2) v = -v;
+    return avg15(u, v);
+}
+
+static inline int16_t grad16(uint8_t hash, int16_t x, int16_t y)
+{
+    hash = hash & 7;
+    int16_t u, v;
+    if (hash < 4) { u = x; v = y; } else { u = y; v = x; }
+    if (hash & 1) u = -u;
+    if (hash & 2) v = -v;
+    return avg15(u, v);
+}
+
+static inline int16_t grad16(uint8_t hash, int16_t x)
+{
+    hash = hash & 15;
+    int16_t u, v;
+    if (hash > 8) { u = x; v = x; }
+    else if (hash < 4) { u = x; v = 1; }
+    else { u = 1; v = x; }
+    if (hash & 1) u = -u;
+    if (hash & 2) v = -v;
+    return avg15(u, v);
+}
+
+int16_t inoise16_raw(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint8_t h[8];
+    cornerHashes(x >> 16, y >> 16, z >> 16, 8, h);
+
+    // position in the cell, signed for grad16() and eased for the lerps
+    int16_t xx = (x & 0xFFFF) >> 1;
+    int16_t yy = (y & 0xFFFF) >> 1;
+    int16_t zz = (z & 0xFFFF) >> 1;
+    uint16_t N = 0x8000;
+    uint16_t u = ease16InOutQuad(x);
+    uint16_t v = ease16InOutQuad(y);
+    uint16_t w = ease16InOutQuad(z);
+
+    int16_t X1 = lerp15by16(grad16(h[0], xx, yy, zz), grad16(h[1], xx - N, yy, zz), u);
+    int16_t X2 = lerp15by16(grad16(h[2], xx, yy - N, zz), grad16(h[3], xx - N, yy - N, zz), u);
+    int16_t X3 = lerp15by16(grad16(h[4], xx, yy, zz - N), grad16(h[5], xx - N, yy, zz - N), u);
+    int16_t X4 = lerp15by16(grad16(h[6], xx, yy - N, zz - N), grad16(h[7], xx - N, yy - N, zz - N), u);
+
+    int16_t Y1 = lerp15by16(X1, X2, v);
+    int16_t Y2 = lerp15by16(X3, X4, v);
+
+    return lerp15by16(Y1, Y2, w);
+}
+
+int16_t inoise16_raw(uint32_t x, uint32_t y)
+{
+    uint8_t h[4];
+    cornerHashes(x >> 16, y >> 16, 0, 4, h);
+
+    int16_t xx = (x & 0xFFFF) >> 1;
+    int16_t yy = (y & 0xFFFF) >> 1;
+    uint16_t N = 0x8000;
+    uint16_t u = ease16InOutQuad(x);
+    uint16_t v = ease16InOutQuad(y);
+
+    int16_t X1 = lerp15by16(grad16(h[0], xx, yy), grad16(h[1], xx - N, yy), u);
+    int16_t X2 = lerp15by16(grad16(h[2], xx, yy - N), grad16(h[3], xx - N, yy - N), u);
+
+    return lerp15by16(X1, X2, v);
+}
+
+int16_t inoise16_raw(uint32_t x)
+{
+    uint8_t h[2];
+    cornerHashes(x >> 16, 0, 0, 2, h);
+
+    int16_t xx = (x & 0xFFFF) >> 1;
+    uint16_t N = 0x8000;
+    uint16_t u = ease16InOutQuad(x);
+
+    return lerp15by16(grad16(h[0], xx), grad16(h[1], xx - N), u);
+}
+
+// the raw values shifted and stretched to about the full 16 bits
+static inline uint16_t noise16Scale3(int32_t raw) { return ((uint32_t)(raw + 19052) * 440) >> 8; }
+static inline uint16_t noise16Scale2(int32_t raw) { return ((uint32_t)(raw + 17308) * 484) >> 8; }
+static inline uint16_t noise16Scale1(int32_t raw) { return (uint32_t)(raw + 17308) << 1; }
+
+uint16_t inoise16(uint32_t x, uint32_t y, uint32_t z)
+{
+    return noise16Scale3(inoise16_raw(x, y, z));
+}
+
+uint16_t inoise16(uint32_t x, uint32_t y)
+{
+    return noise16Scale2(inoise16_raw(x, y));
+}
+
+uint16_t inoise16(uint32_t x)
+{
+    return noise16Scale1(inoise16_raw(x));
+}
+
+/***************************************************************************
+ *   8 bit noise
+ ***************************************************************************/
+
+static inline int8_t grad8(uint8_t hash, int8_t x, int8_t y, int8_t z)
+{
+    hash &= 0xF;
+    int8_t u = (hash & 8) ? y : x;
+    int8_t v = hash < 4 ? y : (hash == 12 || hash == 14) ? x : z;
+    if (hash & 1) u = -u;
+    if (hash & 2) v = -v;
+    return avg7(u, v);
+}
+
+static inline int8_t grad8(uint8_t hash, int8_t x, int8_t y)
+{
+    int8_t u, v;
+    if (hash & 4) { u = y; v = x; } else { u = x; v = y; }
+    if (hash & 1) u = -u;
+    if (hash & 2) v = -v;
+    return avg7(u, v);
+}
+
+static inline int8_t grad8(uint8_t hash, int8_t x)
+{
+    int8_t u, v;
+    if (hash & 8) { u = x; v = x; }
+    else if (hash & 4) { u = 1; v = x; }
+    else { u = x; v = 1; }
+    if (hash & 1) u = -u;
+    if (hash & 2) v = -v;
+    return avg7(u, v);
+}
+
+static inline int8_t lerp7by8(int8_t a, int8_t b, fract8 frac)
+{
+    if (b > a)
+        return a + scale8(b - a, frac);
+    return a - scale8(a - b, frac);
+}
+
+int8_t inoise8_raw(uint16_t x, uint16_t y, uint16_t z)
+{
+    uint8_t h[8];
+    cornerHashes(x >> 8, y >> 8, z >> 8, 8, h);
+
+    int8_t xx = (uint8_t)x >> 1;
+    int8_t yy = (uint8_t)y >> 1;
+    int8_t zz = (uint8_t)z >> 1;
+    uint8_t N = 0x80;
+    uint8_t u = ease8InOutQuad(x);
+    uint8_t v = ease8InOutQuad(y);
+    uint8_t w = ease8InOutQuad(z);
+
+    int8_t X1 = lerp7by8(grad8(h[0], xx, yy, zz), grad8(h[1], xx - N, yy, zz), u);
+    int8_t X2 = lerp7by8(grad8(h[2], xx, yy - N, zz), grad8(h[3], xx - N, yy - N, zz), u);
+    int8_t X3 = lerp7by8(grad8(h[4], xx, yy, zz - N), grad8(h[5], xx - N, yy, zz - N), u);
+    int8_t X4 = lerp7by8(grad8(h[6], xx, yy - N, zz - N), grad8(h[7], xx - N, yy - N, zz - N), u);
+
+    int8_t Y1 = lerp7by8(X1, X2, v);
+    int8_t Y2 = lerp7by8(X3, X4, v);
+
+    return lerp7by8(Y1, Y2, w);
+}
+
+int8_t inoise8_raw(uint16_t x, uint16_t y)
+{
+    uint8_t h[4];
+    cornerHashes(x >> 8, y >> 8, 0, 4, h);
+
+    int8_t xx = (uint8_t)x >> 1;
+    int8_t yy = (uint8_t)y >> 1;
+    uint8_t N = 0x80;
+    uint8_t u = ease8InOutQuad(x);
+    uint8_t v = ease8InOutQuad(y);
+
+    int8_t X1 = lerp7by8(grad8(h[0], xx, yy), grad8(h[1], xx - N, yy), u);
+    int8_t X2 = lerp7by8(grad8(h[2], xx, yy - N), grad8(h[3], xx - N, yy - N), u);
+
+    return lerp7by8(X1, X2, v);
+}
+
+int8_t inoise8_raw(uint16_t x)
+{
+    uint8_t h[2];
+    cornerHashes(x >> 8, 0, 0, 2, h);
+
+    int8_t xx = (uint8_t)x >> 1;
+    uint8_t N = 0x80;
+    uint8_t u = ease8InOutQuad(x);
+
+    return lerp7by8(grad8(h[0], xx), grad8(h[1], xx - N), u);
+}
+
+// -64..64 doubled to 0..255
+static inline uint8_t noise8Scale(int8_t raw)
+{
+    uint8_t n = raw + 64;
+    return qadd8(n, n);
+}
+
+uint8_t inoise8(uint16_t x, uint16_t y, uint16_t z)
+{
+    return noise8Scale(inoise8_raw(x, y, z));
+}
+
+uint8_t inoise8(uint16_t x, uint16_t y)
+{
+    return noise8Scale(inoise8_raw(x, y));
+}
+
+uint8_t inoise8(uint16_t x)
+{
+    return noise8Scale(inoise8_raw(x));
+}
+
+/***************************************************************************
+ *   rows
+ ***************************************************************************/
+
+// These do a batch of points at a time, one per lane of a GCC vector,
+// the same way the hsv2rgb array versions do. Only the corner hashes are
+// looked up lane by lane, everything after that is lane arithmetic with
+// the branches of grad and lerp turned into selects. The lanes are 32
+// bits wide and every place the scalar code truncates to int16/int8
+// (negating -32768, the averages, the lerps) is sign extended from 16/8
+// bits again, so the results are bit for bit the scalar ones.
+//
+// Everything down to the row loops is forced inline and takes the vector
+// type as a template parameter. The plain build uses 4 lanes, one SSE2 or
+// NEON register. On x86 the rows are built a second time for AVX2 with 8
+// lanes and picked at run time; 8 lanes split over two SSE2 registers
+// are slower than the scalar code, so that one is AVX2 only.
+
+#if !defined(FASTLED_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NOISE_AVX2
+#endif
+
+// the 32 byte vectors don't fit the calling convention without AVX, but
+// nothing using them is ever called, it is all inlined
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+#define NOISE_INLINE    static inline __attribute__((always_inline))
+
+typedef int32_t noise_vec4 __attribute__((vector_size(16)));
+typedef uint32_t noise_uvec4 __attribute__((vector_size(16)));
+typedef int32_t noise_vec8 __attribute__((vector_size(32)));
+typedef uint32_t noise_uvec8 __attribute__((vector_size(32)));
+
+template<class V> struct noise_unsigned;
+template<> struct noise_unsigned<noise_vec4> { typedef noise_uvec4 type; };
+template<> struct noise_unsigned<noise_vec8> { typedef noise_uvec8 type; };
+
+// lanes where mask is set come from a, the others from b
+template<class V> NOISE_INLINE V noise_select(const V &mask, const V &a, const V &b)
+{
+    return (a & mask) | (b & ~mask);
+}
+
+template<class V> NOISE_INLINE V noise_s16(const V &a)
+{
+    typedef typename noise_unsigned<V>::type U;
+    return (V)((U)a << 16) >> 16;
+}
+
+template<class V> NOISE_INLINE V noise_s8(const V &a)
+{
+    typedef typename noise_unsigned<V>::type U;
+    return (V)((U)a << 24) >> 24;
+}
+
+template<class V> NOISE_INLINE V noise_set(int32_t a)
+{
+    V v = {};
+    return v + a;
+}
+
+// negates the lanes where hash bit 0 / 1 is set, then avg15/avg7
+template<class V> NOISE_INLINE V noise_avg16(const V &hash, const V &u, const V &v)
+{
+    V nu = noise_s16(noise_select((V)((hash & 1) != 0), -u, u));
+    V nv = noise_s16(noise_select((V)((hash & 2) != 0), -v, v));
+    return noise_s16(((nu + nv) >> 1) + (nu & 1));
+}
+
+template<class V> NOISE_INLINE V noise_avg8(const V &hash, const V &u, const V &v)
+{
+    V nu = noise_s8(noise_select((V)((hash & 1) != 0), -u, u));
+    V nv = noise_s8(noise_select((V)((hash & 2) != 0), -v, v));
+    return noise_s8(((nu + nv) >> 1) + (nu & 1));
+}
+
+template<class V> NOISE_INLINE V grad16_batch(const V &h, const V &x, const V &y, const V &z)
+{
+    V hash = h & 15;
+    V u = noise_select((V)(hash < 8), x, y);
+    V v = noise_select((V)(hash < 4), y, noise_select((V)((hash == 12) | (hash == 14)), x, z));
+    return noise_avg16(hash, u, v);
+}
+
+template<class V> NOISE_INLINE V grad16_batch(const V &hash, const V &x, const V &y)
+{
+    V swap = (hash & 4) != 0;
+    return noise_avg16(hash, noise_select(swap, y, x), noise_select(swap, x, y));
+}
+
+template<class V> NOISE_INLINE V grad16_batch(const V &h, const V &x)
+{
+    V hash = h & 15;
+    V one = noise_set<V>(1);
+    V all = hash > 8;
+    V low = hash < 4;
+    V u = noise_select(all, x, noise_select(low, x, one));
+    V v = noise_select(all, x, noise_select(low, one, x));
+    return noise_avg16(hash, u, v);
+}
+
+template<class V> NOISE_INLINE V grad8_batch(const V &h, const V &x, const V &y, const V &z)
+{
+    V hash = h & 15;
+    V u = noise_select((V)((hash & 8) != 0), y, x);
+    V v = noise_select((V)(hash < 4), y, noise_select((V)((hash == 12) | (hash == 14)), x, z));
+    return noise_avg8(hash, u, v);
+}
+
+template<class V> NOISE_INLINE V grad8_batch(const V &hash, const V &x, const V &y)
+{
+    V swap = (hash & 4) != 0;
+    return noise_avg8(hash, noise_select(swap, y, x), noise_select(swap, x, y));
+}
+
+template<class V> NOISE_INLINE V grad8_batch(const V &hash, const V &x)
+{
+    V one = noise_set<V>(1);
+    V all = (hash & 8) != 0;
+    V four = (hash & 4) != 0;
+    V u = noise_select(all, x, noise_select(four, one, x));
+    V v = noise_select(all, x, noise_select(four, x, one));
+    return noise_avg8(hash, u, v);
+}
+
+// lerp15by16 / lerp7by8, mask is the width of the unsigned delta
+template<class V> NOISE_INLINE V lerp_batch(const V &a, const V &b, const V &frac, int shift, uint32_t mask)
+{
+    typedef typename noise_unsigned<V>::type U;
+    V up = b > a;
+    U delta = (U)noise_select(up, b - a, a - b) & mask;
+    V scaled = (V)((delta * (U)frac) >> shift);
+    return noise_select(up, a + scaled, a - scaled);
+}
+
+template<class V> NOISE_INLINE V lerp16_batch(const V &a, const V &b, const V &frac)
+{
+    return noise_s16(lerp_batch(a, b, frac, 16, 0xFFFF));
+}
+
+template<class V> NOISE_INLINE V lerp8_batch(const V &a, const V &b, const V &frac)
+{
+    return noise_s8(lerp_batch(a, b, frac, 8, 0xFF));
+}
+
+template<class V> NOISE_INLINE V ease16_batch(const V &i)
+{
+    V top = (i & 0x8000) != 0;
+    V j = noise_select(top, 65535 - i, i);
+    V jj2 = (((j * j) >> 16) << 1) & 0xFFFF;
+    return noise_select(top, 65535 - jj2, jj2);
+}
+
+template<class V> NOISE_INLINE V ease8_batch(const V &i)
+{
+    V top = (i & 0x80) != 0;
+    V j = noise_select(top, 255 - i, i);
+    V jj2 = (((j * (j + 1)) >> 8) << 1) & 0xFF;
+    return noise_select(top, 255 - jj2, jj2);
+}
+
+// The lanes of one batch: the eased and the signed position in the cell,
+// and the hashes of the 2^D corners. Points along a row mostly share
+// their cell with the one before, so the hashes of the last cell are kept.
+template<class V> struct noise_lanes {
+    enum { count = sizeof(V) / 4 };
+    V u;
+    V xx;
+    V h[8];
+    int cell;
+    uint8_t hash[8];
+};
+
+template<class V> NOISE_INLINE void noise_load(noise_lanes<V> &l, uint32_t x, uint32_t scale, int bits,
+                                               uint8_t Y, uint8_t Z, int corners)
+{
+    const int lanes = noise_lanes<V>::count;
+    uint32_t fracMask = (1 << bits) - 1;
+    int32_t pos[lanes];
+    int32_t h[8][lanes];
+
+    for (int k = 0; k < lanes; k++) {
+        uint8_t X = x >> bits;
+        if (X != l.cell) {
+            l.cell = X;
+            cornerHashes(X, Y, Z, corners, l.hash);
+        }
+        for (int c = 0; c < corners; c++)
+            h[c][k] = l.hash[c];
+        pos[k] = x & fracMask;
+        x += scale;
+    }
+    for (int c = 0; c < corners; c++)
+        memcpy(&l.h[c], h[c], sizeof(V));
+    V frac;
+    memcpy(&frac, pos, sizeof(V));
+    l.xx = frac >> 1;
+    l.u = (bits == 16) ? ease16_batch(frac) : ease8_batch(frac);
+}
+
+template<int D, class V> NOISE_INLINE void noise16_row(uint16_t *out, unsigned int count, uint32_t x, int32_t scale,
+                                                       uint32_t y, uint32_t z)
+{
+    typedef typename noise_unsigned<V>::type U;
+    const int corners = 1 << D;
+    const int lanes = noise_lanes<V>::count;
+    V N = noise_set<V>(0x8000);
+    V yy = noise_set<V>((y & 0xFFFF) >> 1);
+    V zz = noise_set<V>((z & 0xFFFF) >> 1);
+    V v = ease16_batch(noise_set<V>(y & 0xFFFF));
+    V w = ease16_batch(noise_set<V>(z & 0xFFFF));
+    noise_lanes<V> l = {};
+    unsigned int i = 0;
+
+    l.cell = -1;
+    for ( ; i + lanes <= count; i += lanes) {
+        V ans;
+
+        noise_load(l, x + i * scale, scale, 16, y >> 16, z >> 16, corners);
+        V xn = l.xx - N;
+        if (D == 3) {
+            V yn = yy - N, zn = zz - N;
+            V X1 = lerp16_batch(grad16_batch(l.h[0], l.xx, yy, zz), grad16_batch(l.h[1], xn, yy, zz), l.u);
+            V X2 = lerp16_batch(grad16_batch(l.h[2], l.xx, yn, zz), grad16_batch(l.h[3], xn, yn, zz), l.u);
+            V X3 = lerp16_batch(grad16_batch(l.h[4], l.xx, yy, zn), grad16_batch(l.h[5], xn, yy, zn), l.u);
+            V X4 = lerp16_batch(grad16_batch(l.h[6], l.xx, yn, zn), grad16_batch(l.h[7], xn, yn, zn), l.u);
+            ans = lerp16_batch(lerp16_batch(X1, X2, v), lerp16_batch(X3, X4, v), w);
+            ans = (V)(((U)(ans + 19052) * 440) >> 8);
+        } else if (D == 2) {
+            V yn = yy - N;
+            V X1 = lerp16_batch(grad16_batch(l.h[0], l.xx, yy), grad16_batch(l.h[1], xn, yy), l.u);
+            V X2 = lerp16_batch(grad16_batch(l.h[2], l.xx, yn), grad16_batch(l.h[3], xn, yn), l.u);
+            ans = lerp16_batch(X1, X2, v);
+            ans = (V)(((U)(ans + 17308) * 484) >> 8);
+        } else {
+            ans = lerp16_batch(grad16_batch(l.h[0], l.xx), grad16_batch(l.h[1], xn), l.u);
+            ans = (V)((U)(ans + 17308) << 1);
+        }
+        for (int k = 0; k < lanes; k++)
+            out[i + k] = ans[k];
+    }
+    for ( ; i < count; i++) {
+        uint32_t px = x + i * scale;
+        out[i] = (D == 3) ? inoise16(px, y, z) : (D == 2) ? inoise16(px, y) : inoise16(px);
+    }
+}
+
+template<int D, class V> NOISE_INLINE void noise8_row(uint8_t *out, unsigned int count, uint16_t x, int scale,
+                                                      uint16_t y, uint16_t z)
+{
+    const int corners = 1 << D;
+    const int lanes = noise_lanes<V>::count;
+    V N = noise_set<V>(0x80);
+    V yy = noise_set<V>((uint8_t)y >> 1);
+    V zz = noise_set<V>((uint8_t)z >> 1);
+    V v = ease8_batch(noise_set<V>((uint8_t)y));
+    V w = ease8_batch(noise_set<V>((uint8_t)z));
+    noise_lanes<V> l = {};
+    unsigned int i = 0;
+
+    l.cell = -1;
+    for ( ; i + lanes <= count; i += lanes) {
+        V ans;
+
+        noise_load(l, x + i * scale, scale, 8, y >> 8, z >> 8, corners);
+        V xn = l.xx - N;
+        if (D == 3) {
+            V yn = yy - N, zn = zz - N;
+            V X1 = lerp8_batch(grad8_batch(l.h[0], l.xx, yy, zz), grad8_batch(l.h[1], xn, yy, zz), l.u);
+            V X2 = lerp8_batch(grad8_batch(l.h[2], l.xx, yn, zz), grad8_batch(l.h[3], xn, yn, zz), l.u);
+            V X3 = lerp8_batch(grad8_batch(l.h[4], l.xx, yy, zn), grad8_batch(l.h[5], xn, yy, zn), l.u);
+            V X4 = lerp8_batch(grad8_batch(l.h[6], l.xx, yn, zn), grad8_batch(l.h[7], xn, yn, zn), l.u);
+            ans = lerp8_batch(lerp8_batch(X1, X2, v), lerp8_batch(X3, X4, v), w);
+        } else if (D == 2) {
+            V yn = yy - N;
+            V X1 = lerp8_batch(grad8_batch(l.h[0], l.xx, yy), grad8_batch(l.h[1], xn, yy), l.u);
+            V X2 = lerp8_batch(grad8_batch(l.h[2], l.xx, yn), grad8_batch(l.h[3], xn, yn), l.u);
+            ans = lerp8_batch(X1, X2, v);
+        } else {
+            ans = lerp8_batch(grad8_batch(l.h[0], l.xx), grad8_batch(l.h[1], xn), l.u);
+        }
+        // noise8Scale()
+        ans = (ans + 64) & 0xFF;
+        ans = ans + ans;
+        ans = noise_select((V)(ans > 255), noise_set<V>(255), ans);
+        for (int k = 0; k < lanes; k++)
+            out[i + k] = ans[k];
+    }
+    for ( ; i < count; i++) {
+        uint16_t px = x + i * scale;
+        out[i] = (D == 3) ? inoise8(px, y, z) : (D == 2) ? inoise8(px, y) : inoise8(px);
+    }
+}
+
+#ifdef NOISE_AVX2
+template<int D> __attribute__((target("avx2")))
+static void noise16_row_avx2(uint16_t *out, unsigned int count, uint32_t x, int32_t scale, uint32_t y, uint32_t z)
+{
+    noise16_row<D, noise_vec8>(out, count, x, scale, y, z);
+}
+
+template<int D> __attribute__((target("avx2")))
+static void noise8_row_avx2(uint8_t *out, unsigned int count, uint16_t x, int scale, uint16_t y, uint16_t z)
+{
+    noise8_row<D, noise_vec8>(out, count, x, scale, y, z);
+}
+
+static bool detectAvx2(void)
+{
+    __builtin_cpu_init();
+    return(__builtin_cpu_supports("avx2") != 0);
+}
+
+static bool haveAvx2(void)
+{
+    static const bool avx2 = detectAvx2();          // once, thread safe
+    return(avx2);
+}
+#endif
+
+template<int D> static void noise16_rows(uint16_t *out, unsigned int count, uint32_t x, int32_t scale, uint32_t y, uint32_t z)
+{
+#ifdef NOISE_AVX2
+    if (haveAvx2()) {
+        noise16_row_avx2<D>(out, count, x, scale, y, z);
+        return;
+    }
+#endif
+    if (D == 1) {
+        // in 4 lanes the 1d noise has too little to share, the scalar code wins
+        for (unsigned int i = 0; i < count; i++)
+            out[i] = inoise16(x + i * scale);
+        return;
+    }
+    noise16_row<D, noise_vec4>(out, count, x, scale, y, z);
+}
+
+template<int D> static void noise8_rows(uint8_t *out, unsigned int count, uint16_t x, int scale, uint16_t y, uint16_t z)
+{
+#ifdef NOISE_AVX2
+    if (haveAvx2()) {
+        noise8_row_avx2<D>(out, count, x, scale, y, z);
+        return;
+    }
+#endif
+    noise8_row<D, noise_vec4>(out, count, x, scale, y, z);
+}
+
+void inoise16_row(uint16_t *out, unsigned int count, uint32_t x, int32_t scale, uint32_t y, uint32_t z)
+{
+    noise16_rows<3>(out, count, x, scale, y, z);
+}
+
+void inoise16_row(uint16_t *out, unsigned int count, uint32_t x, int32_t scale, uint32_t y)
+{
+    noise16_rows<2>(out, count, x, scale, y, 0);
+}
+
+void inoise16_row(uint16_t *out, unsigned int count, uint32_t x, int32_t scale)
+{
+    noise16_rows<1>(out, count, x, scale, 0, 0);
+}
+
+void inoise8_row(uint8_t *out, unsigned int count, uint16_t x, int scale, uint16_t y, uint16_t z)
+{
+    noise8_rows<3>(out, count, x, scale, y, z);
+}
+
+void inoise8_row(uint8_t *out, unsigned int count, uint16_t x, int scale, uint16_t y)
+{
+    noise8_rows<2>(out, count, x, scale, y, 0);
+}
+
+void inoise8_row(uint8_t *out, unsigned int count, uint16_t x, int scale)
+{
+    noise8_rows<1>(out, count, x, scale, 0, 0);
+}
+
+/***************************************************************************
+ *   fills
+ ***************************************************************************/
+
+#define NOISE_CHUNK 64                      // points per row call
+
+void fill_raw_noise8(uint8_t *pData, unsigned int num_points, uint8_t octaves, uint16_t x, int scale, uint16_t time)
+{
+    uint8_t n[NOISE_CHUNK];
+
+    for (int o = 0; o < octaves; o++) {
+        uint16_t xo = x << o;
+        int so = (unsigned int)scale << o;
+        for (unsigned int i = 0; i < num_points; i += NOISE_CHUNK) {
+            unsigned int count = (num_points - i < NOISE_CHUNK) ? num_points - i : NOISE_CHUNK;
+            inoise8_row(n, count, xo + i * so, so, time);
+            for (unsigned int j = 0; j < count; j++)
+                pData[i + j] = qadd8(pData[i + j], n[j] >> o);
+        }
+    }
+}
+
+void fill_raw_noise16into8(uint8_t *pData, unsigned int num_points, uint8_t octaves, uint32_t x, int scale, uint32_t time)
+{
+    uint16_t n[NOISE_CHUNK];
+
+    for (int o = 0; o < octaves; o++) {
+        uint32_t xo = x << o;
+        int32_t so = (uint32_t)scale << o;
+        for (unsigned int i = 0; i < num_points; i += NOISE_CHUNK) {
+            unsigned int count = (num_points - i < NOISE_CHUNK) ? num_points - i : NOISE_CHUNK;
+            inoise16_row(n, count, xo + i * so, so, time);
+            for (unsigned int j = 0; j < count; j++) {
+                uint32_t accum = (n[j] >> o) + (pData[i + j] << 8);
+                pData[i + j] = (accum > 65535) ? 255 : accum >> 8;
+            }
+        }
+    }
+}
+
+void fill_plain_2dnoise8(uint8_t *pData, int width, int height, uint8_t octaves,
+                         uint16_t x, int scalex, uint16_t y, int scaley, uint16_t time)
+{
+    uint8_t n[NOISE_CHUNK];
+
+    for (int o = 0; o < octaves; o++) {
+        uint16_t xo = x << o;
+        int so = (unsigned int)scalex << o;
+        for (int r = 0; r < height; r++) {
+            uint8_t *pRow = pData + r * width;
+            uint16_t yo = (uint16_t)(y + r * scaley) << o;
+            for (int i = 0; i < width; i += NOISE_CHUNK) {
+                int count = (width - i < NOISE_CHUNK) ? width - i : NOISE_CHUNK;
+                inoise8_row(n, count, xo + i * so, so, yo, time);
+                for (int j = 0; j < count; j++)
+                    pRow[i + j] = qadd8(pRow[i + j], n[j] >> o);
+            }
+        }
+    }
+}
+
+void fill_plain_2dnoise16into8(uint8_t *pData, int width, int height, uint8_t octaves,
+                               uint32_t x, int scalex, uint32_t y, int scaley, uint32_t time)
+{
+    uint16_t n[NOISE_CHUNK];
+
+    for (int o = 0; o < octaves; o++) {
+        uint32_t xo = x << o;
+        int32_t so = (uint32_t)scalex << o;
+        for (int r = 0; r < height; r++) {
+            uint8_t *pRow = pData + r * width;
+            uint32_t yo = (y + r * scaley) << o;
+            for (int i = 0; i < width; i += NOISE_CHUNK) {
+                int count = (width - i < NOISE_CHUNK) ? width - i : NOISE_CHUNK;
+                inoise16_row(n, count, xo + i * so, so, yo, time);
+                for (int j = 0; j < count; j++) {
+                    uint32_t accum = (n[j] >> o) + (pRow[i + j] << 8);
+                    pRow[i + j] = (accum > 65535) ? 255 : accum >> 8;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+//
+//  noise.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef noise_h
+#define noise_h
+
+#include <stdint.h>
+
+///@file noise.h
+/// Perlin noise, single values and whole rows
+
+///@defgroup Noise Noise functions
+/// Fixed point Perlin noise, giving the same values as the upstream
+/// FastLED inoise8()/inoise16().
+///
+/// The *_row functions evaluate count points along x, scale apart, with
+/// y and z the same for all of them. That is what every fill function
+/// needs, and it lets the points be done several at a time in vector
+/// lanes. The results are identical to calling the scalar function for
+/// every point.
+///@{
+
+/// 16 bit noise, x, y and z are 16.16 fixed point, the integer part picks
+/// the cell. inoise16() is scaled to 0..65535 (mostly), inoise16_raw()
+/// is signed, roughly -18000..18000.
+uint16_t inoise16(uint32_t x, uint32_t y, uint32_t z);
+uint16_t inoise16(uint32_t x, uint32_t y);
+uint16_t inoise16(uint32_t x);
+int16_t inoise16_raw(uint32_t x, uint32_t y, uint32_t z);
+int16_t inoise16_raw(uint32_t x, uint32_t y);
+int16_t inoise16_raw(uint32_t x);
+
+/// 8 bit noise, x, y and z are 8.8 fixed point. inoise8() is 0..255,
+/// inoise8_raw() roughly -64..64.
+uint8_t inoise8(uint16_t x, uint16_t y, uint16_t z);
+uint8_t inoise8(uint16_t x, uint16_t y);
+uint8_t inoise8(uint16_t x);
+int8_t inoise8_raw(uint16_t x, uint16_t y, uint16_t z);
+int8_t inoise8_raw(uint16_t x, uint16_t y);
+int8_t inoise8_raw(uint16_t x);
+
+/// out[i] = inoise16(x + i * scale, y, z), and the 2d/1d versions
+void inoise16_row(uint16_t *out, unsigned int count, uint32_t x, int32_t scale, uint32_t y, uint32_t z);
+void inoise16_row(uint16_t *out, unsigned int count, uint32_t x, int32_t scale, uint32_t y);
+void inoise16_row(uint16_t *out, unsigned int count, uint32_t x, int32_t scale);
+
+/// out[i] = inoise8(x + i * scale, y, z), and the 2d/1d versions
+void inoise8_row(uint8_t *out, unsigned int count, uint16_t x, int scale, uint16_t y, uint16_t z);
+void inoise8_row(uint8_t *out, unsigned int count, uint16_t x, int scale, uint16_t y);
+void inoise8_row(uint8_t *out, unsigned int count, uint16_t x, int scale);
+
+/// Adds octaves of 2d noise along x at y = time into pData, octave o at
+/// twice the frequency and half the amplitude of octave o - 1, saturating.
+/// pData is not cleared first.
+void fill_raw_noise8(uint8_t *pData, unsigned int num_points, uint8_t octaves, uint16_t x, int scale, uint16_t time);
+
+/// The same with 16 bit noise, the top 8 bits of the sum end up in pData
+void fill_raw_noise16into8(uint8_t *pData, unsigned int num_points, uint8_t octaves, uint32_t x, int scale, uint32_t time);
+
+/// A width x height field of 3d noise at z = time, row major, every row
+/// with its octaves added the way fill_raw_noise8() does. Not upstream's
+/// fill_raw_2dnoise8(), that one folds the noise around the middle and
+/// mixes the octaves with a frequency and amplitude each.
+void fill_plain_2dnoise8(uint8_t *pData, int width, int height, uint8_t octaves,
+                         uint16_t x, int scalex, uint16_t y, int scaley, uint16_t time);
+void fill_plain_2dnoise16into8(uint8_t *pData, int width, int height, uint8_t octaves,
+                               uint32_t x, int scalex, uint32_t y, int scaley, uint32_t time);
+
+///@}
+
+#endif /* noise_h */
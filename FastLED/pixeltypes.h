@@ -13,8 +13,9 @@
 
 struct CRGB;
 struct CHSV;
+struct CRGB16;
 
-///@defgroup Pixeltypes CHSV and CRGB type definitions
+///@defgroup Pixeltypes CHSV, CRGB and CRGB16 type definitions
 ///@{
 
 /// Forward declaration of hsv2rgb_rainbow here,
@@ -820,6 +821,225 @@ inline CRGB operator%( const CRGB& p1, uint8_t d)
 
 
 
+/// RGB pixel with 16 bits per channel, 0xFFFF is full on.
+/// Same operations as CRGB, but long fades and dim colors keep their
+/// precision instead of getting stuck on the lowest 8-bit steps.
+/// transfer() rounds or dithers it down to 8 bits on the way out.
+struct CRGB16 {
+    union {
+        struct {
+            union {
+                uint16_t r;
+                uint16_t red;
+            };
+            union {
+                uint16_t g;
+                uint16_t green;
+            };
+            union {
+                uint16_t b;
+                uint16_t blue;
+            };
+        };
+        uint16_t raw[3];
+    };
+    
+    inline uint16_t& operator[] (uint8_t x) __attribute__((always_inline))
+    {
+        return raw[x];
+    }
+    
+    inline const uint16_t& operator[] (uint8_t x) const __attribute__((always_inline))
+    {
+        return raw[x];
+    }
+    
+    // default values are UNINITIALIZED
+    inline CRGB16() __attribute__((always_inline))
+    {
+    }
+    
+    inline CRGB16( uint16_t ir, uint16_t ig, uint16_t ib)  __attribute__((always_inline))
+    : r(ir), g(ig), b(ib)
+    {
+    }
+    
+    // an 8-bit color, 0xFF becomes 0xFFFF
+    inline CRGB16( const CRGB& rhs) __attribute__((always_inline))
+    : r(rhs.r * 257), g(rhs.g * 257), b(rhs.b * 257)
+    {
+    }
+    
+    inline CRGB16( const CHSV& rhs) __attribute__((always_inline))
+    {
+        *this = CRGB(rhs);
+    }
+    
+    inline CRGB16& operator= (const CRGB& rhs) __attribute__((always_inline))
+    {
+        r = rhs.r * 257;
+        g = rhs.g * 257;
+        b = rhs.b * 257;
+        return *this;
+    }
+    
+    inline CRGB16& setRGB (uint16_t nr, uint16_t ng, uint16_t nb) __attribute__((always_inline))
+    {
+        r = nr;
+        g = ng;
+        b = nb;
+        return *this;
+    }
+    
+    // nearest 8-bit color
+    inline CRGB toCRGB() const
+    {
+        return CRGB( ((uint32_t)r * 255 + 32767) / 65535,
+                    ((uint32_t)g * 255 + 32767) / 65535,
+                    ((uint32_t)b * 255 + 32767) / 65535);
+    }
+    
+    // add one RGB to another, saturating at 0xFFFF for each channel
+    inline CRGB16& operator+= (const CRGB16& rhs )
+    {
+        r = (r > 0xFFFF - rhs.r) ? 0xFFFF : r + rhs.r;
+        g = (g > 0xFFFF - rhs.g) ? 0xFFFF : g + rhs.g;
+        b = (b > 0xFFFF - rhs.b) ? 0xFFFF : b + rhs.b;
+        return *this;
+    }
+    
+    inline CRGB16& addToRGB (uint16_t d )
+    {
+        return *this += CRGB16(d, d, d);
+    }
+    
+    // subtract one RGB from another, saturating at 0x0000 for each channel
+    inline CRGB16& operator-= (const CRGB16& rhs )
+    {
+        r = (r < rhs.r) ? 0 : r - rhs.r;
+        g = (g < rhs.g) ? 0 : g - rhs.g;
+        b = (b < rhs.b) ? 0 : b - rhs.b;
+        return *this;
+    }
+    
+    inline CRGB16& subtractFromRGB(uint16_t d )
+    {
+        return *this -= CRGB16(d, d, d);
+    }
+    
+    // scale down to N 256ths of the current brightness
+    inline CRGB16& nscale8 (uint8_t scaledown )
+    {
+        r = scale16by8(r, scaledown);
+        g = scale16by8(g, scaledown);
+        b = scale16by8(b, scaledown);
+        return *this;
+    }
+    
+    // scale down to N 65536ths of the current brightness
+    inline CRGB16& nscale16 (fract16 scaledown )
+    {
+        r = scale16(r, scaledown);
+        g = scale16(g, scaledown);
+        b = scale16(b, scaledown);
+        return *this;
+    }
+    
+    // fadeToBlackBy is a synonym for nscale8( ..., 255-fadefactor)
+    inline CRGB16& fadeToBlackBy (uint8_t fadefactor )
+    {
+        return nscale8(255 - fadefactor);
+    }
+    
+    // "or" operator brings each channel up to the higher of the two values
+    inline CRGB16& operator|= (const CRGB16& rhs )
+    {
+        if( rhs.r > r) r = rhs.r;
+        if( rhs.g > g) g = rhs.g;
+        if( rhs.b > b) b = rhs.b;
+        return *this;
+    }
+    
+    // "and" operator brings each channel down to the lower of the two values
+    inline CRGB16& operator&= (const CRGB16& rhs )
+    {
+        if( rhs.r < r) r = rhs.r;
+        if( rhs.g < g) g = rhs.g;
+        if( rhs.b < b) b = rhs.b;
+        return *this;
+    }
+    
+    // this allows testing a CRGB16 for zero-ness
+    inline operator bool() const __attribute__((always_inline))
+    {
+        return r || g || b;
+    }
+    
+    // invert each channel
+    inline CRGB16 operator- ()
+    {
+        return CRGB16(0xFFFF - r, 0xFFFF - g, 0xFFFF - b);
+    }
+    
+    inline CRGB16 lerp8( const CRGB16 & other, fract8 frac) const
+    {
+        return CRGB16( lerp16by8(r, other.r, frac),
+                      lerp16by8(g, other.g, frac),
+                      lerp16by8(b, other.b, frac));
+    }
+    
+    inline CRGB16 lerp16( const CRGB16 & other, fract16 frac) const
+    {
+        return CRGB16( lerp16by16(r, other.r, frac),
+                      lerp16by16(g, other.g, frac),
+                      lerp16by16(b, other.b, frac));
+    }
+};
+
+inline __attribute__((always_inline)) bool operator== (const CRGB16& lhs, const CRGB16& rhs)
+{
+    return (lhs.r == rhs.r) && (lhs.g == rhs.g) && (lhs.b == rhs.b);
+}
+
+inline __attribute__((always_inline)) bool operator!= (const CRGB16& lhs, const CRGB16& rhs)
+{
+    return !(lhs == rhs);
+}
+
+__attribute__((always_inline))
+inline CRGB16 operator+( const CRGB16& p1, const CRGB16& p2)
+{
+    CRGB16 retval( p1);
+    retval += p2;
+    return retval;
+}
+
+__attribute__((always_inline))
+inline CRGB16 operator-( const CRGB16& p1, const CRGB16& p2)
+{
+    CRGB16 retval( p1);
+    retval -= p2;
+    return retval;
+}
+
+__attribute__((always_inline))
+inline CRGB16 operator&( const CRGB16& p1, const CRGB16& p2)
+{
+    CRGB16 retval( p1);
+    retval &= p2;
+    return retval;
+}
+
+__attribute__((always_inline))
+inline CRGB16 operator|( const CRGB16& p1, const CRGB16& p2)
+{
+    CRGB16 retval( p1);
+    retval |= p2;
+    return retval;
+}
+
+
+
 /// RGB orderings, used when instantiating controllers to determine what
 /// order the controller should send RGB data out in, RGB being the default
 /// ordering.
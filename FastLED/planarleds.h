@@ -0,0 +1,94 @@
+//
+//  planarleds.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef planarleds_h
+#define planarleds_h
+
+#include <stdint.h>
+#include <stdlib.h>         // posix_memalign
+#include <string.h>
+
+#include "pixeltypes.h"
+
+///@file planarleds.h
+/// led buffer with one array per color instead of an array of CRGB
+
+#define PLANE_ALIGN     64                  // every plane starts on a cache line
+
+/// The leds as three planes, all the reds, then all the greens, then all
+/// the blues. The vector loops can then work on whole registers of one
+/// color instead of picking apart 3 byte triplets. T is the channel type,
+/// PIXEL the matching interleaved pixel, see CPlanarLeds and CPlanarLeds16.
+///
+/// transfer() interleaves the planes into wire order while encoding, so
+/// there is never a CRGB copy of the buffer.
+template<class T, class PIXEL> class CPlanarBuffer {
+public:
+    T *planes[3];                           // red, green and blue
+    uint16_t numLeds;
+
+    CPlanarBuffer(uint16_t num) {
+        size_t stride = ((num * sizeof(T) + PLANE_ALIGN - 1) / PLANE_ALIGN) * PLANE_ALIGN;
+        void *p;
+
+        numLeds = num;
+        if (stride == 0)
+            stride = PLANE_ALIGN;
+        if (posix_memalign(&p, PLANE_ALIGN, 3 * stride) != 0)
+            p = NULL;
+        data = (T *)p;
+        for (int c = 0; c < 3; c++)
+            planes[c] = data ? (T *)((uint8_t *)data + c * stride) : NULL;
+        if (data)
+            memset(data, 0, 3 * stride);
+    }
+
+    ~CPlanarBuffer() {
+        free(data);
+    }
+
+    inline T *r() { return planes[0]; }
+    inline T *g() { return planes[1]; }
+    inline T *b() { return planes[2]; }
+
+    inline PIXEL get(uint16_t i) const __attribute__((always_inline))
+    {
+        return PIXEL(planes[0][i], planes[1][i], planes[2][i]);
+    }
+
+    inline void set(uint16_t i, const PIXEL & c) __attribute__((always_inline))
+    {
+        planes[0][i] = c.r;
+        planes[1][i] = c.g;
+        planes[2][i] = c.b;
+    }
+
+    // copy count interleaved pixels in, starting at led start
+    void load(const PIXEL *src, uint16_t start, uint16_t count) {
+        for (uint16_t i = 0; i < count; i++)
+            set(start + i, src[i]);
+    }
+
+    // and back out
+    void save(PIXEL *dst, uint16_t start, uint16_t count) const {
+        for (uint16_t i = 0; i < count; i++)
+            dst[i] = get(start + i);
+    }
+
+private:
+    T *data;
+
+    CPlanarBuffer(const CPlanarBuffer &);
+    CPlanarBuffer & operator= (const CPlanarBuffer &);
+};
+
+typedef CPlanarBuffer<uint8_t, CRGB> CPlanarLeds;
+typedef CPlanarBuffer<uint16_t, CRGB16> CPlanarLeds16;
+
+
+#endif /* planarleds_h */
@@ -0,0 +1,55 @@
+//
+//  power_mgt.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#include <stdint.h>
+
+#include "FastLED.hpp"
+#include "power_mgt.h"
+#include "bulk8.h"
+
+const CPowerModel defaultPowerModel = { 16 * 5, 11 * 5, 15 * 5, 1 * 5 };
+
+uint32_t calculate_unscaled_power_mW( const uint32_t sum[3], uint32_t numLeds, const CPowerModel & model)
+{
+    uint64_t red = ((uint64_t)sum[0] * model.red_mW) >> 8;
+    uint64_t green = ((uint64_t)sum[1] * model.green_mW) >> 8;
+    uint64_t blue = ((uint64_t)sum[2] * model.blue_mW) >> 8;
+
+    return (uint32_t)(red + green + blue + (uint64_t)model.dark_mW * numLeds);
+}
+
+uint32_t calculate_unscaled_power_mW( const CRGB* ledbuffer, uint16_t numLeds, const CPowerModel & model)
+{
+    uint32_t sum[3] = { 0, 0, 0 };
+
+    bulk_sum8x3((const uint8_t *)ledbuffer, numLeds, sum);
+    return calculate_unscaled_power_mW(sum, numLeds, model);
+}
+
+uint8_t max_brightness_for_power_mW( uint32_t total_mW, uint8_t target_brightness, uint32_t max_power_mW)
+{
+    uint64_t requested_mW = ((uint64_t)total_mW * target_brightness) / 256;
+
+    if (requested_mW <= max_power_mW)
+        return target_brightness;
+    return (uint8_t)(((uint64_t)target_brightness * max_power_mW) / requested_mW);
+}
+
+uint8_t calculate_max_brightness_for_power_mW( const CRGB* ledbuffer, uint16_t numLeds,
+                                              uint8_t target_brightness, uint32_t max_power_mW)
+{
+    return max_brightness_for_power_mW(calculate_unscaled_power_mW(ledbuffer, numLeds),
+                                       target_brightness, max_power_mW);
+}
+
+uint8_t calculate_max_brightness_for_power_vmA( const CRGB* ledbuffer, uint16_t numLeds,
+                                               uint8_t target_brightness, uint32_t max_power_V, uint32_t max_power_mA)
+{
+    return calculate_max_brightness_for_power_mW(ledbuffer, numLeds, target_brightness,
+                                                 max_power_V * max_power_mA);
+}
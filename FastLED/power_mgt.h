@@ -0,0 +1,58 @@
+//
+//  power_mgt.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef power_mgt_h
+#define power_mgt_h
+
+#include <stdint.h>
+
+#include "pixeltypes.h"
+
+///@file power_mgt.h
+/// how much power the leds draw, and the brightness that keeps it in budget
+
+///@defgroup Power Power management functions
+/// The model is the one upstream FastLED uses: every color of every led
+/// draws its full current times value / 256, plus a little for every led
+/// even when it is dark. Gamma is not taken into account, so with gamma
+/// above 1 the real draw is lower than the estimate.
+///@{
+
+/// mW one led draws at full red, full green, full blue, and dark
+struct CPowerModel {
+    uint16_t red_mW;
+    uint16_t green_mW;
+    uint16_t blue_mW;
+    uint16_t dark_mW;
+};
+
+/// a 5V WS2812: 16mA, 11mA and 15mA per color, 1mA idle
+extern const CPowerModel defaultPowerModel;
+
+/// power at brightness 255 of leds whose red, green and blue add up to sum[]
+uint32_t calculate_unscaled_power_mW( const uint32_t sum[3], uint32_t numLeds,
+                                     const CPowerModel & model = defaultPowerModel);
+
+/// the same for a CRGB array
+uint32_t calculate_unscaled_power_mW( const CRGB* ledbuffer, uint16_t numLeds,
+                                     const CPowerModel & model = defaultPowerModel);
+
+/// the highest brightness, up to target_brightness, at which total_mW
+/// (at brightness 255) stays within max_power_mW
+uint8_t max_brightness_for_power_mW( uint32_t total_mW, uint8_t target_brightness, uint32_t max_power_mW);
+
+/// the same for a CRGB array, as upstream has it
+uint8_t calculate_max_brightness_for_power_mW( const CRGB* ledbuffer, uint16_t numLeds,
+                                              uint8_t target_brightness, uint32_t max_power_mW);
+
+uint8_t calculate_max_brightness_for_power_vmA( const CRGB* ledbuffer, uint16_t numLeds,
+                                               uint8_t target_brightness, uint32_t max_power_V, uint32_t max_power_mA);
+
+///@}
+
+#endif /* power_mgt_h */
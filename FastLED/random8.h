@@ -21,8 +21,11 @@
 #define FASTLED_RAND16_2053  ((uint16_t)(2053))
 #define FASTLED_RAND16_13849 ((uint16_t)(13849))
 
-/// random number seed
-extern uint16_t rand16seed;// = RAND16_SEED;
+#define RAND16_SEED  1337
+
+/// random number seed, shared by everything that calls random8() and
+/// random16(). Use a CRandom (fastrandom.h) from more than one thread.
+extern uint16_t rand16seed;
 
 /// Generate an 8-bit random number
 LIB8STATIC uint8_t random8()
@@ -0,0 +1,415 @@
+//
+//  test_bulk.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+// The array versions of the color and math functions against their
+// single value counterparts
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tests.h"
+#include "bulk8.h"
+#include "hsv2rgb.hpp"
+#include "colorpalettes.h"
+#include "noise.h"
+
+// one spare in front, so the arrays start at odd addresses too
+static uint8_t a[MAX_COUNT * 3 + 1], b[MAX_COUNT * 3 + 1];
+static uint8_t out[MAX_COUNT * 3 + 1], ref[MAX_COUNT * 3 + 1];
+
+/***************************************************************************
+ *   scale8
+ ***************************************************************************/
+
+void testScale(void)
+{
+    static CRGB leds[MAX_COUNT], expect[MAX_COUNT];
+    NetworkLed net;
+
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+        uint8_t s = r, s2 = rnd(), s3 = rnd();      // every scale a few times over
+
+        fill(a, sizeof(a));
+
+        memcpy(out, a, sizeof(a));
+        bulk_scale8(out + o, n, s);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = scale8(a[o + i], s);
+        check(!memcmp(out + o, ref + o, n), "bulk_scale8", r);
+
+        memcpy(out, a, sizeof(a));
+        bulk_scale8_video(out + o, n, s);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = scale8_video(a[o + i], s);
+        check(!memcmp(out + o, ref + o, n), "bulk_scale8_video", r);
+
+        memcpy(out, a, sizeof(a));
+        bulk_scale8x3(out + o, n, s, s2, s3);
+        for (unsigned int i = 0; i < n; i++) {
+            ref[o + i * 3] = scale8(a[o + i * 3], s);
+            ref[o + i * 3 + 1] = scale8(a[o + i * 3 + 1], s2);
+            ref[o + i * 3 + 2] = scale8(a[o + i * 3 + 2], s3);
+        }
+        check(!memcmp(out + o, ref + o, n * 3), "bulk_scale8x3", r);
+
+        // the CRGB array functions against the CRGB methods
+        memcpy((void *)leds, a, n * sizeof(CRGB));
+        memcpy((void *)expect, a, n * sizeof(CRGB));
+        net.fadeToBlackBy(leds, n, s);
+        for (unsigned int i = 0; i < n; i++)
+            expect[i].nscale8(255 - s);
+        check(!memcmp(leds, expect, n * sizeof(CRGB)), "fadeToBlackBy", r);
+    }
+}
+
+/***************************************************************************
+ *   blend8
+ ***************************************************************************/
+
+void testBlend(void)
+{
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+        uint8_t s = r;
+
+        fill(a, sizeof(a));
+        fill(b, sizeof(b));
+
+        // as nblend(), which takes a or b as they are at 0 and 255
+        bulk_blend8(a + o, b + o, out + o, n, s);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = (s == 0) ? a[o + i] : (s == 255) ? b[o + i] : scale8(a[o + i], 255 - s) + scale8(b[o + i], s);
+        check(!memcmp(out + o, ref + o, n), "bulk_blend8", r);
+
+        memcpy(out, a, sizeof(a));
+        bulk_nblend8(out + o, b + o, n, s);
+        check(!memcmp(out + o, ref + o, n), "bulk_nblend8", r);
+    }
+}
+
+/***************************************************************************
+ *   hsv2rgb.cpp, every CHSV there is
+ ***************************************************************************/
+
+static CHSV hsv[256 * 256];
+static CRGB rgb[256 * 256];
+
+// every sat and val with this hue
+static void allHsv(int h)
+{
+    for (int i = 0; i < 256 * 256; i++)
+        hsv[i] = CHSV(h, i >> 8, i & 0xff);
+}
+
+void testHsv2rgb(void)
+{
+    CRGB one;
+
+    for (int h = 0; h < 256; h++) {
+        allHsv(h);
+        hsv2rgb_rainbow(hsv, rgb, 256 * 256);
+        for (int i = 0; i < 256 * 256; i++) {
+            hsv2rgb_rainbow(hsv[i], one);
+            check(rgb[i] == one, "hsv2rgb_rainbow", h);
+        }
+        hsv2rgb_spectrum(hsv, rgb, 256 * 256);
+        for (int i = 0; i < 256 * 256; i++) {
+            hsv2rgb_spectrum(hsv[i], one);
+            check(rgb[i] == one, "hsv2rgb_spectrum", h);
+        }
+        for (int i = 0; i < 256 * 256; i++)
+            hsv[i].hue = scale8(h, 192);        // 0..191 only
+        hsv2rgb_raw(hsv, rgb, 256 * 256);
+        for (int i = 0; i < 256 * 256; i++) {
+            hsv2rgb_raw(hsv[i], one);
+            check(rgb[i] == one, "hsv2rgb_raw", h);
+        }
+    }
+
+    // the tail that goes through the scalar code
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % 20;
+        for (unsigned int i = 0; i < n; i++)
+            hsv[i] = CHSV(rnd(), rnd(), rnd());
+        hsv2rgb_rainbow(hsv, rgb, n);
+        for (unsigned int i = 0; i < n; i++) {
+            hsv2rgb_rainbow(hsv[i], one);
+            check(rgb[i] == one, "hsv2rgb_rainbow tail", r);
+        }
+    }
+}
+
+void testHsvTable(void)
+{
+    CRGB one;
+
+    for (int h = 0; h < 256; h++) {
+        allHsv(h);
+        hsv2rgb_rainbow_lut(hsv, rgb, 256 * 256);
+        for (int i = 0; i < 256 * 256; i++) {
+            hsv2rgb_rainbow(hsv[i], one);
+            check(rgb[i] == one, "hsv2rgb_rainbow_lut", h);
+        }
+    }
+}
+
+void testRgb2hsv(void)
+{
+    static CHSV back[256 * 256];
+
+    for (int h = 0; h < 256; h++) {
+        // every CRGB with this red
+        for (int i = 0; i < 256 * 256; i++)
+            rgb[i] = CRGB(h, i >> 8, i & 0xff);
+        rgb2hsv_approximate(rgb, back, 256 * 256);
+        for (int i = 0; i < 256 * 256; i++) {
+            CHSV one = rgb2hsv_approximate(rgb[i]);
+            check(back[i].h == one.h && back[i].s == one.s && back[i].v == one.v, "rgb2hsv_approximate", h);
+        }
+    }
+}
+
+/***************************************************************************
+ *   palettes
+ ***************************************************************************/
+
+void testPalettes(void)
+{
+    uint32_t table[256];
+
+    for (int i = 0; i < 256; i++)
+        table[i] = rnd();
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+
+        fill(a, sizeof(a));
+        bulk_lookup8x3(a + o, out, n, table);
+        for (unsigned int i = 0; i < n; i++)
+            memcpy(&ref[i * 3], &table[a[o + i]], 3);
+        check(!memcmp(out, ref, n * 3), "bulk_lookup8x3", r);
+    }
+
+    // against a ColorFromPalette() per led
+    static CRGB leds[MAX_COUNT], expect[MAX_COUNT];
+    static const TProgmemRGBPalette16 *predefined[] = { &CloudColors_p, &LavaColors_p, &OceanColors_p,
+        &ForestColors_p, &RainbowColors_p, &RainbowStripeColors_p, &PartyColors_p, &HeatColors_p };
+    CRGBPalette16 pal16;
+    CRGBPalette256 pal256;
+    NetworkLed net;
+
+    for (unsigned int r = 0; r < ROUNDS / 10; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        uint8_t start = rnd(), inc = rnd(), brightness = (r & 2) ? 255 : rnd(), opacity = (r & 4) ? 255 : rnd();
+        TBlendType blend = (r & 8) ? NOBLEND : LINEARBLEND;
+
+        if (r % 3 == 0)
+            pal16 = CRGBPalette16(*predefined[r / 3 % 8]);
+        else
+            for (int i = 0; i < 16; i++)
+                pal16[i] = CRGB(rnd(), rnd(), rnd());
+        for (int i = 0; i < 256; i++)
+            pal256[i] = CRGB(rnd(), rnd(), rnd());
+
+        net.fill_palette(leds, n, start, inc, pal16, brightness, blend);
+        for (unsigned int i = 0; i < n; i++)
+            expect[i] = ColorFromPalette(pal16, (uint8_t)(start + i * inc), brightness, blend);
+        check(!memcmp(leds, expect, n * sizeof(CRGB)), "fill_palette 16", r);
+
+        net.fill_palette(leds, n, start, inc, pal256, brightness);
+        for (unsigned int i = 0; i < n; i++)
+            expect[i] = ColorFromPalette(pal256, (uint8_t)(start + i * inc), brightness);
+        check(!memcmp(leds, expect, n * sizeof(CRGB)), "fill_palette 256", r);
+
+        // as upstream mixes the colors in
+        fill(a, n);
+        fill((uint8_t *)leds, n * 3);
+        memcpy((void *)expect, leds, n * sizeof(CRGB));
+        net.map_data_into_colors_through_palette(a, n, leds, pal16, brightness, opacity, blend);
+        for (unsigned int i = 0; i < n; i++) {
+            CRGB rgb = ColorFromPalette(pal16, a[i], brightness, blend);
+            if (opacity == 255) {
+                expect[i] = rgb;
+            } else {
+                expect[i].nscale8(256 - opacity);
+                rgb.nscale8_video(opacity);
+                expect[i] += rgb;
+            }
+        }
+        check(!memcmp(leds, expect, n * sizeof(CRGB)), "map_data_into_colors_through_palette", r);
+    }
+}
+
+/***************************************************************************
+ *   noise.cpp
+ ***************************************************************************/
+
+void testNoise(void)
+{
+    uint16_t out16[MAX_COUNT];
+
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        uint32_t x = rnd(), y = rnd(), z = rnd();
+        int32_t scale = (int32_t)rnd() >> (rnd() % 24);     // tiny to huge steps, both ways
+        uint16_t x8 = x, y8 = y, z8 = z;
+        int step8 = scale >> 8;
+
+        inoise16_row(out16, n, x, scale, y, z);
+        for (unsigned int i = 0; i < n; i++)
+            check(out16[i] == inoise16(x + i * scale, y, z), "inoise16_row 3d", r);
+        inoise16_row(out16, n, x, scale, y);
+        for (unsigned int i = 0; i < n; i++)
+            check(out16[i] == inoise16(x + i * scale, y), "inoise16_row 2d", r);
+        inoise16_row(out16, n, x, scale);
+        for (unsigned int i = 0; i < n; i++)
+            check(out16[i] == inoise16(x + i * scale), "inoise16_row 1d", r);
+
+        inoise8_row(out, n, x8, step8, y8, z8);
+        for (unsigned int i = 0; i < n; i++)
+            check(out[i] == inoise8((uint16_t)(x8 + i * step8), y8, z8), "inoise8_row 3d", r);
+        inoise8_row(out, n, x8, step8, y8);
+        for (unsigned int i = 0; i < n; i++)
+            check(out[i] == inoise8((uint16_t)(x8 + i * step8), y8), "inoise8_row 2d", r);
+        inoise8_row(out, n, x8, step8);
+        for (unsigned int i = 0; i < n; i++)
+            check(out[i] == inoise8((uint16_t)(x8 + i * step8)), "inoise8_row 1d", r);
+
+        // the fills against upstream's loops
+        uint8_t octaves = rnd() % 4 + 1;
+        int fillScale = (int)(rnd() % 2000) - 1000;
+        fill(a, n);
+        memcpy(b, a, n);
+        fill_raw_noise8(a, n, octaves, x8, fillScale, z8);
+        for (int o = 0; o < octaves; o++)
+            for (unsigned int i = 0; i < n; i++)
+                b[i] = qadd8(b[i], inoise8((uint16_t)(((uint32_t)x8 << o) + i * ((uint32_t)fillScale << o)), z8) >> o);
+        check(!memcmp(a, b, n), "fill_raw_noise8", r);
+
+        fill(a, n);
+        memcpy(b, a, n);
+        fill_raw_noise16into8(a, n, octaves, x, fillScale, z);
+        for (int o = 0; o < octaves; o++) {
+            for (unsigned int i = 0; i < n; i++) {
+                uint32_t accum = (inoise16((x << o) + i * ((uint32_t)fillScale << o), z) >> o) + (b[i] << 8);
+                b[i] = (accum > 65535) ? 255 : accum >> 8;
+            }
+        }
+        check(!memcmp(a, b, n), "fill_raw_noise16into8", r);
+    }
+}
+
+/***************************************************************************
+ *   random
+ ***************************************************************************/
+
+void testRandom(void)
+{
+    // xorshift128 in every lane, one lane at a time
+    uint32_t state[4 * RANDOM_LANES], lane[4 * RANDOM_LANES];
+    for (int i = 0; i < 4 * RANDOM_LANES; i++)
+        state[i] = lane[i] = rnd() | 1;
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        bulk_random8(state, out, n);
+        for (unsigned int i = 0; i < n; i += 4 * RANDOM_LANES) {
+            uint8_t step[4 * RANDOM_LANES];
+            for (int l = 0; l < RANDOM_LANES; l++) {
+                uint32_t *x = &lane[l], *y = x + RANDOM_LANES, *z = y + RANDOM_LANES, *v = z + RANDOM_LANES;
+                uint32_t t = *x ^ (*x << 11);
+                *x = *y;
+                *y = *z;
+                *z = *v;
+                *v = *v ^ (*v >> 19) ^ t ^ (t >> 8);
+                memcpy(&step[l * 4], v, 4);
+            }
+            unsigned int k = (n - i < sizeof(step)) ? n - i : sizeof(step);
+            check(!memcmp(out + i, step, k), "bulk_random8", r);
+        }
+    }
+
+    // the same leds with any number of threads
+    static CRGB serial[20000], pooled[20000];
+    NetworkLed n;
+    n.rng.setSeed(42);
+    n.random_pixels(serial, 20000, 100);
+    for (int threads = 1; threads < 8; threads += 2) {
+        n.setParallel(threads, 1000);
+        memset((void *)pooled, 0, sizeof(pooled));
+        n.rng.setSeed(42);
+        n.random_pixels(pooled, 20000, 100);
+        check(!memcmp(serial, pooled, sizeof(serial)), "random_pixels threads", threads);
+    }
+}
+
+/***************************************************************************
+ *   waves
+ ***************************************************************************/
+
+void testWaves(void)
+{
+    static uint16_t a16[MAX_COUNT];
+    static int16_t s16[MAX_COUNT + 1];
+
+    // every input
+    for (int i = 0; i < 256; i++)
+        a[i] = i;
+    bulk_sin8(a, out, 256);
+    for (int i = 0; i < 256; i++)
+        check(out[i] == sin8(i), "bulk_sin8", i);
+    bulk_cos8(a, out, 256);
+    for (int i = 0; i < 256; i++)
+        check(out[i] == cos8(i), "bulk_cos8", i);
+    bulk_triwave8(a, out, 256);
+    for (int i = 0; i < 256; i++)
+        check(out[i] == triwave8(i), "bulk_triwave8", i);
+    bulk_quadwave8(a, out, 256);
+    for (int i = 0; i < 256; i++)
+        check(out[i] == quadwave8(i), "bulk_quadwave8", i);
+    bulk_cubicwave8(a, out, 256);
+    for (int i = 0; i < 256; i++)
+        check(out[i] == cubicwave8(i), "bulk_cubicwave8", i);
+    for (unsigned int x = 0; x < 65536; x += MAX_COUNT) {
+        unsigned int n = (65536 - x < MAX_COUNT) ? 65536 - x : MAX_COUNT;
+        bulk_ramp16(a16, n, x, 1);
+        bulk_sin16(a16, s16, n);
+        for (unsigned int i = 0; i < n; i++)
+            check(s16[i] == sin16(x + i), "bulk_sin16", x + i);
+        bulk_cos16(a16, s16, n);
+        for (unsigned int i = 0; i < n; i++)
+            check(s16[i] == cos16(x + i), "bulk_cos16", x + i);
+    }
+
+    // random lengths and odd addresses
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+        uint16_t w = rnd(), w2 = rnd();
+
+        fill(a, sizeof(a));
+        bulk_sin8(a + o, out + o, n);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = sin8(a[o + i]);
+        check(!memcmp(out + o, ref + o, n), "bulk_sin8 lengths", r);
+
+        bulk_ramp8(out + o, n, w, w2);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = (uint16_t)(w + i * w2) >> 8;
+        check(!memcmp(out + o, ref + o, n), "bulk_ramp8", r);
+
+        bulk_ramp16(a16, n, w, w2);
+        for (unsigned int i = 0; i < n; i++)
+            check(a16[i] == (uint16_t)(w + i * w2), "bulk_ramp16", r);
+        bulk_sin16(a16, s16 + o, n);
+        for (unsigned int i = 0; i < n; i++)
+            check(s16[o + i] == sin16(a16[i]), "bulk_sin16 lengths", r);
+    }
+}
@@ -0,0 +1,164 @@
+//
+//  test_clock.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+// The frame clock and the timers that run on it
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tests.h"
+#include "timerwheel.h"
+
+/***************************************************************************
+ *   frame clock
+ ***************************************************************************/
+
+void testFrameClock(void)
+{
+    CTestServer server;
+    NetworkLed n;
+    static CRGB leds[10];
+
+    server.attach(n, 2, HOST_CODECS);
+    n.setStore(leds);
+    n.SetNumLeds(10);
+
+    // moves outside a frame
+    uint32_t t = get_millisecond_timer();
+    usleep(3000);
+    check(get_millisecond_timer() != t, "clock outside a frame", 0);
+
+    // held from frame_clock_begin() through show(strip) to show()
+    frame_clock_begin();
+    t = get_millisecond_timer();
+    usleep(3000);
+    check(get_millisecond_timer() == t, "frame clock", 0);
+    n.transfer();
+    n.show(0);
+    usleep(3000);
+    check(get_millisecond_timer() == t, "frame clock after show(strip)", 0);
+    n.show();
+    check(get_millisecond_timer() != t, "frame clock after show()", 0);
+    server.receive();
+}
+
+/***************************************************************************
+ *   timer wheel
+ ***************************************************************************/
+
+#define WHEEL_TIMERS    300
+#define WHEEL_RUNS      20
+#define WHEEL_SERVICES  40
+
+struct CModelTimer {
+    CWheelTimer *timer;
+    uint32_t period;
+    uint32_t due;                           // when the model says it goes off
+    unsigned int fired;                     // by the current service()
+};
+
+static CModelTimer model[WHEEL_TIMERS];
+static uint32_t serviceTime;                // what service() got
+static uint32_t lastDue;                    // of the timer that went off before
+static bool wheelOk;
+
+static void fired(void *arg)
+{
+    CModelTimer *m = (CModelTimer *)arg;
+
+    // due, and in the order they are due
+    wheelOk = wheelOk && (int32_t)(m->due - serviceTime) <= 0 && (int32_t)(m->due - lastDue) >= 0;
+    lastDue = m->due;
+    m->fired++;
+}
+
+// periods from 0 to hours, most of them short
+static uint32_t randomPeriod(void)
+{
+    switch (rnd() % 4) {
+        case 0: return rnd() % 4;
+        case 1: return rnd() % 300;
+        case 2: return rnd() % 70000;
+        default: return rnd() % (5 * 3600000);
+    }
+}
+
+// where add() puts a timer due at due, the wheel is at now
+static uint32_t overdue(uint32_t due, uint32_t now)
+{
+    return ((int32_t)(due - now) <= 0) ? now + 1 : due;
+}
+
+void testTimerWheel(void)
+{
+    // a frame that lasts the whole check, timers start from its clock
+    frame_clock_begin();
+    uint32_t base = get_millisecond_timer();
+
+    for (unsigned int run = 0; run < WHEEL_RUNS; run++) {
+        CTimerWheel wheel;
+        uint32_t now = base;
+
+        for (int i = 0; i < WHEEL_TIMERS; i++) {
+            model[i].period = randomPeriod();
+            model[i].due = overdue(base + model[i].period, now);
+            model[i].timer = new CWheelTimer(model[i].period, fired, &model[i], wheel);
+        }
+        wheelOk = true;
+        for (int s = 0; s < WHEEL_SERVICES; s++) {
+            // gaps up to about 83 minutes, mostly much less
+            uint32_t gap = (rnd() % 3) ? rnd() % 500 : rnd() % 5000000;
+            serviceTime = now + gap;
+            lastDue = now;
+            for (int i = 0; i < WHEEL_TIMERS; i++)
+                model[i].fired = 0;
+            wheel.service(serviceTime);
+            now = serviceTime;
+
+            // every one that was due went off once and waits a period again
+            for (int i = 0; i < WHEEL_TIMERS; i++) {
+                CModelTimer *m = &model[i];
+                bool due = (int32_t)(m->due - serviceTime) <= 0;
+                wheelOk = wheelOk && m->fired == (due ? 1u : 0u);
+                if (due)
+                    m->due = serviceTime + (m->period ? m->period : 1);
+            }
+
+            // and some get changed in between
+            for (int k = 0; k < 5; k++) {
+                CModelTimer *m = &model[rnd() % WHEEL_TIMERS];
+                switch (rnd() % 4) {
+                    case 0:
+                        m->timer->trigger();
+                        m->due = overdue(base, now);
+                        break;
+                    case 1:
+                        m->period = randomPeriod();
+                        m->timer->setPeriod(m->period);
+                        m->due = overdue(base + m->period, now);
+                        break;
+                    case 2:
+                        m->timer->ready();      // services the wheel up to the frame clock, which is behind
+                        break;
+                    default:
+                        delete m->timer;
+                        m->period = randomPeriod();
+                        m->due = overdue(base + m->period, now);
+                        m->timer = new CWheelTimer(m->period, fired, m, wheel);
+                        break;
+                }
+            }
+        }
+        check(wheelOk && wheel.pending() == WHEEL_TIMERS, "CTimerWheel", run);
+        for (int i = 0; i < WHEEL_TIMERS; i++)
+            delete model[i].timer;
+        check(wheel.pending() == 0, "CTimerWheel remove", run);
+    }
+    frame_clock_end();
+}
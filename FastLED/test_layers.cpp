@@ -0,0 +1,151 @@
+//
+//  test_layers.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+// The compositor against compositing one led at a time with the CRGB
+// operators
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tests.h"
+#include "bulk8.h"
+#include "layers.h"
+
+#define LAYER_LEDS      1000
+#define LAYER_COUNT     4
+#define LAYER_CHUNKS    ((LAYER_LEDS + (1 << TRACK_CHUNK_SHIFT) - 1) >> TRACK_CHUNK_SHIFT)
+
+// nblend() of one channel
+static uint8_t blend(uint8_t a, uint8_t b, uint8_t amount)
+{
+    return (amount == 0) ? a : (amount == 255) ? b : scale8(a, 255 - amount) + scale8(b, amount);
+}
+
+static CRGB composite(CLayer **layers, int count, const CRGB & background, uint16_t i)
+{
+    CRGB c = background;
+
+    for (int n = 0; n < count; n++) {
+        const CLayer *l = layers[n];
+        CRGB mixed = c;
+        if (!l->visible || !l->opacity)
+            continue;
+        switch (l->mode) {
+            case LAYER_NORMAL: mixed = l->leds[i]; break;
+            case LAYER_ADD: mixed += l->leds[i]; break;
+            case LAYER_MULTIPLY: mixed.nscale8(l->leds[i]); break;
+            case LAYER_MAX: mixed |= l->leds[i]; break;
+            default: mixed &= l->leds[i]; break;
+        }
+        for (int k = 0; k < 3; k++)
+            c.raw[k] = blend(c.raw[k], mixed.raw[k], l->opacity);
+    }
+    return(c);
+}
+
+void testLayers(void)
+{
+    static uint8_t a[MAX_COUNT + 1], b[MAX_COUNT + 1], out[MAX_COUNT + 1], ref[MAX_COUNT + 1];
+
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+
+        fill(a, sizeof(a));
+        fill(b, sizeof(b));
+        bulk_qadd8(a + o, b + o, out + o, n);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = qadd8(a[o + i], b[o + i]);
+        check(!memcmp(out + o, ref + o, n), "bulk_qadd8", r);
+
+        bulk_mul8(a + o, b + o, out + o, n);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = scale8(a[o + i], b[o + i]);
+        check(!memcmp(out + o, ref + o, n), "bulk_mul8", r);
+
+        bulk_max8(a + o, b + o, out + o, n);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = (a[o + i] > b[o + i]) ? a[o + i] : b[o + i];
+        check(!memcmp(out + o, ref + o, n), "bulk_max8", r);
+
+        bulk_min8(a + o, b + o, out + o, n);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = (a[o + i] < b[o + i]) ? a[o + i] : b[o + i];
+        check(!memcmp(out + o, ref + o, n), "bulk_min8", r);
+    }
+
+    static CRGB leds[LAYER_LEDS];
+    CTrackedLeds output(leds, LAYER_LEDS);
+    CCompositor compositor(output);
+    CLayer l0(LAYER_LEDS), l1(LAYER_LEDS, LAYER_ADD), l2(LAYER_LEDS, LAYER_MULTIPLY, 128), l3(LAYER_LEDS, LAYER_MAX);
+    CLayer *layers[LAYER_COUNT] = { &l0, &l1, &l2, &l3 };
+    CTestServer server;
+    NetworkLed net;
+
+    for (int n = 0; n < LAYER_COUNT; n++)
+        compositor.addLayer(*layers[n]);
+    server.attach(net, 2, HOST_CODECS);
+    net.setStore(output);
+    net.SetNumLeds(LAYER_LEDS);
+    net.setCompositor(&compositor);
+
+    for (unsigned int r = 0; r < 200; r++) {
+        bool written[LAYER_CHUNKS];
+        bool settings = r % 10 == 0;
+
+        memset(written, 0, sizeof(written));
+        output.clear();
+        if (settings) {
+            // the whole thing again
+            CLayer *l = layers[rnd() % LAYER_COUNT];
+            l->mode = (TLayerMode)(rnd() % 5);
+            l->opacity = (rnd() & 1) ? 255 : rnd();
+            l->visible = rnd() % 4;
+            compositor.background = CRGB(rnd(), rnd(), rnd());
+        }
+        for (int k = 0; k < 3; k++) {
+            CLayer *l = layers[rnd() % LAYER_COUNT];
+            uint16_t start = rnd() % LAYER_LEDS, count = rnd() % 100 + 1;
+            if (count > LAYER_LEDS - start)
+                count = LAYER_LEDS - start;
+            switch (rnd() % 3) {
+                case 0:
+                    for (uint16_t i = start; i < start + count; i++)
+                        (*l)[i] = CRGB(rnd(), rnd(), rnd());
+                    break;
+                case 1:
+                    net.fill_solid(l->leds + start, count, CRGB(rnd(), rnd(), rnd()));
+                    break;
+                default:
+                    net.fadeToBlackBy(l->leds + start, count, rnd());
+                    break;
+            }
+            if (l->shows())
+                for (uint16_t c = start >> TRACK_CHUNK_SHIFT; c <= (start + count - 1) >> TRACK_CHUNK_SHIFT; c++)
+                    written[c] = true;
+        }
+
+        compositor.compose();
+        bool ok = true, marked = true;
+        for (uint16_t i = 0; i < LAYER_LEDS; i++)
+            ok = ok && leds[i] == composite(layers, LAYER_COUNT, compositor.background, i);
+        for (uint16_t c = 0; c < LAYER_CHUNKS; c++)
+            marked = marked && (settings || output.isDirty(c) == written[c]);
+        check(ok, "compose", r);
+        check(marked, "compose dirty chunks", r);
+    }
+
+    // transfer() composites first
+    l0[5] = CRGB(1, 2, 3);
+    net.transfer();
+    server.receive();
+    bool ok = true;
+    for (uint16_t i = 0; i < LAYER_LEDS; i++)
+        ok = ok && server.strip(0)[i] == composite(layers, LAYER_COUNT, compositor.background, i);
+    check(ok && !server.bad, "compose transfer()", 0);
+}
@@ -0,0 +1,308 @@
+//
+//  test_matrix.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+// The 2d functions against upstream's loops over XY()
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tests.h"
+#include "bulk8.h"
+#include "blur2d.h"
+#include "threadpool.h"
+
+static uint16_t blurWidth;
+static bool serpentine;
+
+static uint16_t xy(uint16_t x, uint16_t y)
+{
+    return (serpentine && (y & 1)) ? y * blurWidth + blurWidth - 1 - x : y * blurWidth + x;
+}
+
+// the one the app provides
+uint16_t NetworkLed::XY(uint8_t x, uint8_t y)
+{
+    return xy(x, y);
+}
+
+// upstream's blur1d over a row or column, through xy()
+static void blurLine(CRGB *leds, uint16_t count, bool column, uint16_t at, fract8 amount)
+{
+    uint8_t keep = 255 - amount;
+    uint8_t seep = amount >> 1;
+    CRGB carryover = CRGB::Black;
+
+    for (uint16_t i = 0; i < count; i++) {
+        CRGB &led = column ? leds[xy(at, i)] : leds[xy(i, at)];
+        CRGB cur = led;
+        CRGB part = cur;
+        part.nscale8(seep);
+        cur.nscale8(keep);
+        cur += carryover;
+        if (i)
+            (column ? leds[xy(at, i - 1)] : leds[xy(i - 1, at)]) += part;
+        led = cur;
+        carryover = part;
+    }
+}
+
+static void blurReference(CRGB *leds, uint16_t w, uint16_t h, fract8 amount, bool rows, bool columns)
+{
+    if (rows)
+        for (uint16_t y = 0; y < h; y++)
+            blurLine(leds, w, false, y, amount);
+    if (columns)
+        for (uint16_t x = 0; x < w; x++)
+            blurLine(leds, h, true, x, amount);
+}
+
+static void randomLeds(CRGB *leds, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++)
+        leds[i] = CRGB(rnd(), rnd(), rnd());
+}
+
+/***************************************************************************
+ *   blur
+ ***************************************************************************/
+
+void testBlur2d(void)
+{
+    static uint8_t in[MAX_COUNT + 1], before[MAX_COUNT + 1], after[MAX_COUNT + 1];
+    static uint8_t out[MAX_COUNT + 1], ref[MAX_COUNT + 1];
+
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+        uint8_t keep = r, seep = rnd();
+
+        fill(in, sizeof(in));
+        fill(before, sizeof(before));
+        fill(after, sizeof(after));
+        bulk_blur8(out + o, in + o, before + o, after + o, n, keep, seep);
+        for (unsigned int i = 0; i < n; i++)
+            ref[o + i] = qadd8(qadd8(scale8(in[o + i], keep), scale8(before[o + i], seep)), scale8(after[o + i], seep));
+        check(!memcmp(out + o, ref + o, n), "bulk_blur8", r);
+    }
+
+    static CRGB a[300 * 200], b[300 * 200];
+    static const uint16_t sizes[][2] = { { 1, 1 }, { 1, 7 }, { 7, 1 }, { 16, 16 }, { 17, 5 },
+                                         { 130, 3 }, { 129, 129 }, { 300, 200 } };
+    CBlur2d matrix;
+    CThreadPool pool;
+
+    pool.start(3);
+    // every size row-major and serpentine, rows, columns or both
+    for (unsigned int r = 0; r < 8 * sizeof(sizes) / sizeof(sizes[0]); r++) {
+        uint16_t w = sizes[r / 8][0], h = sizes[r / 8][1];
+        fract8 amount = rnd();
+        bool rows = r & 1, columns = !(r & 1) || (r & 2);
+
+        blurWidth = w;
+        serpentine = r & 2;
+        matrix.resize(w, h);
+        for (uint16_t y = 0; y < h; y++)
+            for (uint16_t x = 0; x < w; x++)
+                matrix.xy[y * w + x] = xy(x, y);
+        matrix.mapped();
+        randomLeds(a, w * h);
+        memcpy((void *)b, a, w * h * sizeof(CRGB));
+
+        matrix.blur(a, amount, rows, columns, (r & 4) ? &pool : NULL);      // and with the pool
+        blurReference(b, w, h, amount, rows, columns);
+        check(!memcmp(a, b, w * h * sizeof(CRGB)), "CBlur2d::blur", r);
+    }
+
+    // through XY(), which is only asked again for a new size
+    NetworkLed n;
+    for (unsigned int r = 0; r < 6; r++) {
+        uint8_t w = (r < 3) ? 200 : 37, h = (r < 3) ? 150 : 255;
+        fract8 amount = rnd();
+
+        blurWidth = w;
+        serpentine = true;
+        randomLeds(a, w * h);
+        memcpy((void *)b, a, w * h * sizeof(CRGB));
+        switch (r % 3) {
+            case 0:
+                n.blur2d(a, w, h, amount);
+                blurReference(b, w, h, amount, true, true);
+                break;
+            case 1:
+                n.blurRows(a, w, h, amount);
+                blurReference(b, w, h, amount, true, false);
+                break;
+            default:
+                n.blurColumns(a, w, h, amount);
+                blurReference(b, w, h, amount, false, true);
+                break;
+        }
+        check(!memcmp(a, b, w * h * sizeof(CRGB)), "blur2d", r);
+    }
+}
+
+/***************************************************************************
+ *   layouts
+ ***************************************************************************/
+
+// index() of every (x, y) against the formula, and every led exactly once
+template<class LAYOUT> static void checkLayout(const LAYOUT & layout, uint16_t (*expect)(uint16_t, uint16_t),
+                                               const char *what)
+{
+    static uint8_t seen[LAYOUT_MAX_LEDS];
+    static uint16_t table[LAYOUT_MAX_LEDS];
+    uint32_t num = (uint32_t)layout.width * layout.height;
+    bool ok = true;
+
+    memset(seen, 0, num);
+    layoutTable(layout, table);
+    for (uint16_t y = 0; y < layout.height; y++) {
+        for (uint16_t x = 0; x < layout.width; x++) {
+            uint16_t i = layout.index(x, y);
+            ok = ok && i < num && !seen[i] && i == expect(x, y) && table[y * layout.width + x] == i;
+            if (i < num)
+                seen[i] = 1;
+        }
+    }
+    check(ok, what, 0);
+}
+
+static uint16_t rowMajor(uint16_t x, uint16_t y)            { return y * 12 + x; }
+static uint16_t serpentine12(uint16_t x, uint16_t y)        { return y * 12 + ((y & 1) ? 11 - x : x); }
+static uint16_t columnMajor(uint16_t x, uint16_t y)         { return x * 5 + y; }
+static uint16_t columnSerpentine(uint16_t x, uint16_t y)    { return x * 5 + ((x & 1) ? 4 - y : y); }
+
+// 3 x 2 panels of 12 x 5 serpentine, the panels themselves serpentine
+static uint16_t tiled(uint16_t x, uint16_t y)
+{
+    uint16_t col = x / 12, row = y / 5;
+
+    if (row & 1)
+        col = 2 - col;
+    return (row * 3 + col) * 60 + serpentine12(x % 12, y % 5);
+}
+
+// the 12 x 5 row-major matrix turned a quarter clockwise, 5 x 12
+static uint16_t turned(uint16_t x, uint16_t y)              { return rowMajor(y, 4 - x); }
+// and mirrored as well
+static uint16_t turnedMirrored(uint16_t x, uint16_t y)      { return rowMajor(y, x); }
+static uint16_t halfTurn(uint16_t x, uint16_t y)            { return rowMajor(11 - x, 4 - y); }
+
+static uint16_t wiring[7 * 3];
+static uint16_t tableLayout(uint16_t x, uint16_t y)         { return wiring[y * 7 + x]; }
+
+void testLayouts(void)
+{
+    typedef CRowMajorLayout<12, 5> RowMajor;
+
+    checkLayout(RowMajor(), rowMajor, "CRowMajorLayout");
+    checkLayout(CSerpentineLayout<12, 5>(), serpentine12, "CSerpentineLayout");
+    checkLayout(CColumnMajorLayout<12, 5>(), columnMajor, "CColumnMajorLayout");
+    checkLayout(CColumnSerpentineLayout<12, 5>(), columnSerpentine, "CColumnSerpentineLayout");
+    checkLayout(CTiledLayout<CSerpentineLayout<12, 5>, 3, 2, true>(), tiled, "CTiledLayout");
+    checkLayout(CTransformedLayout<RowMajor, 1>(), turned, "CTransformedLayout 1");
+    checkLayout(CTransformedLayout<RowMajor, 1, true>(), turnedMirrored, "CTransformedLayout 1 mirrored");
+    checkLayout(CTransformedLayout<RowMajor, 2>(), halfTurn, "CTransformedLayout 2");
+
+    // a shuffled table
+    for (int i = 0; i < 7 * 3; i++)
+        wiring[i] = i;
+    for (int i = 7 * 3 - 1; i > 0; i--) {
+        int j = rnd() % (i + 1);
+        uint16_t t = wiring[i];
+        wiring[i] = wiring[j];
+        wiring[j] = t;
+    }
+    CTableLayout table(7, 3, wiring);
+    checkLayout(table, tableLayout, "CTableLayout");
+
+    static CRGB leds[12 * 5];
+    CMatrix<CSerpentineLayout<12, 5> > m(leds);
+    m(3, 1) = CRGB(1, 2, 3);
+    check(leds[serpentine12(3, 1)] == CRGB(1, 2, 3) && m.width() == 12 && m.height() == 5, "CMatrix", 0);
+
+    // blur2d through a layout instead of XY()
+    static CRGB a[60 * 40], b[60 * 40];
+    NetworkLed n;
+    blurWidth = 60;
+    serpentine = true;
+    randomLeds(a, 60 * 40);
+    memcpy((void *)b, a, sizeof(a));
+    n.blur2d(a, CSerpentineLayout<60, 40>(), 100);
+    blurReference(b, 60, 40, 100, true, true);
+    check(!memcmp(a, b, sizeof(a)), "blur2d layout", 0);
+
+    // a table with more leds than a layout can have is refused
+    static uint16_t big[300 * 300];
+    check(!n.setLayout(CTableLayout(300, 300, big)), "setLayout() limit", 0);
+    check(n.setLayout(table), "setLayout() table", 0);
+}
+
+/***************************************************************************
+ *   the thread pool
+ ***************************************************************************/
+
+void testParallel(void)
+{
+    static CRGB a[250 * 250], b[250 * 250], overlay[250 * 250];
+    static CHSV hsv[250 * 250];
+    const unsigned int num = 250 * 250;
+    NetworkLed serial, pooled;
+
+    pooled.setParallel(3, 1);
+    blurWidth = 250;
+    serpentine = true;
+    for (unsigned int r = 0; r < 10; r++) {
+        uint8_t s = rnd();
+
+        randomLeds(a, num);
+        randomLeds(overlay, num);
+        memcpy((void *)b, a, sizeof(a));
+        switch (r) {
+            case 0:
+                serial.fill_solid(a, num, CRGB(s, 2, 3));
+                pooled.fill_solid(b, num, CRGB(s, 2, 3));
+                break;
+            case 1:
+                serial.fill_rainbow(a, num, s, 3);
+                pooled.fill_rainbow(b, num, s, 3);
+                break;
+            case 2:
+                serial.nscale8(a, num, s);
+                pooled.nscale8(b, num, s);
+                break;
+            case 3:
+                serial.nscale8_video(a, num, s);
+                pooled.nscale8_video(b, num, s);
+                break;
+            case 4:
+                serial.fadeUsingColor(a, num, CRGB(s, 100, 200));
+                pooled.fadeUsingColor(b, num, CRGB(s, 100, 200));
+                break;
+            case 5:
+                serial.nblend(a, overlay, num, s);
+                pooled.nblend(b, overlay, num, s);
+                break;
+            case 6:
+                serial.blend(overlay, a, a, num, s);
+                pooled.blend(overlay, b, b, num, s);
+                break;
+            case 7:
+                for (unsigned int i = 0; i < num; i++)
+                    hsv[i] = CHSV(rnd(), rnd(), rnd());
+                serial.hsv2rgb(hsv, a, num);
+                pooled.hsv2rgb(hsv, b, num);
+                break;
+            default:
+                serial.blur2d(a, 250, 250, s);
+                pooled.blur2d(b, 250, 250, s);
+                break;
+        }
+        check(!memcmp(a, b, sizeof(a)), "parallel", r);
+    }
+}
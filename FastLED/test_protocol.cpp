@@ -0,0 +1,314 @@
+//
+//  test_protocol.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/14/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+// What a NetworkLed sends, as a CTestServer decodes it
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tests.h"
+
+static void randomLeds(CRGB *leds, unsigned int count)
+{
+    fill((uint8_t *)leds, count * 3);
+}
+
+static bool same(const CRGB *a, const CRGB *b, unsigned int count)
+{
+    return !memcmp(a, b, count * sizeof(CRGB));
+}
+
+/***************************************************************************
+ *   HELLO/CAPS
+ ***************************************************************************/
+
+void testHandshake(void)
+{
+    static CRGB leds[200];
+
+    {
+        // a version 1 server that knows a codec the host doesn't
+        CTestServer server;
+        NetworkLed n;
+        server.attach(n, 1, CODEC_UNCOMPRESSED | CODEC_PHASE2 | 0x8000, 100, 500);
+        check(n.peerVersion == 1 && n.peerMaxFrame == 100 && n.peerNumLeds == 500, "HELLO CAPS", 0);
+        check(n.codecs == (CODEC_UNCOMPRESSED | CODEC_PHASE2), "HELLO codecs", 0);
+        n.setStore(leds);
+        n.SetNumLeds(200);
+
+        // one color is a few bytes of RLE
+        for (int i = 0; i < 200; i++)
+            leds[i] = CRGB(10, 20, 30);
+        n.transfer();
+        server.receive();
+        check(server.encoding == PHASE2 && same(server.strip(0), leds, 200), "HELLO PHASE2", 0);
+
+        // runs of three are shorter as RLE, but not short enough for the server
+        for (int i = 0; i < 200; i++)
+            leds[i] = CRGB(i / 3, 1, 2);
+        n.transfer();
+        server.receive();
+        check(server.encoding == UNCOMPRESSED && same(server.strip(0), leds, 200), "HELLO max frame", 0);
+
+        randomLeds(leds, 200);
+        n.transfer();
+        server.receive();
+        check(server.encoding == UNCOMPRESSED && same(server.strip(0), leds, 200), "HELLO random", 0);
+        check(!server.bad, "HELLO frames", 0);
+    }
+    {
+        // a legacy server never answers
+        CTestServer server;
+        NetworkLed n;
+        server.attach(n, 0, 0);
+        check(n.peerVersion == 0 && n.codecs == (CODEC_UNCOMPRESSED | CODEC_PHASE2), "HELLO legacy", 0);
+        n.setStore(leds);
+        n.SetNumLeds(200);
+        randomLeds(leds, 200);
+        n.transfer();
+        server.receive();
+        check(same(server.strip(0), leds, 200) && !server.bad, "HELLO legacy frames", 0);
+    }
+}
+
+/***************************************************************************
+ *   strips
+ ***************************************************************************/
+
+void testStrips(void)
+{
+    static CRGB a[3000], b[50], c[70], d[10];
+
+    {
+        CTestServer server;
+        NetworkLed n;
+        server.attach(n, 2, HOST_CODECS, FASTLED_MAX_FRAME, FASTLED_MAX_LEDS, 3);
+        check(n.peerStrips == 3, "strips CAPS", 0);
+        n.setStore(a);
+        n.SetNumLeds(100);
+        check(n.addStore(b, 50) == 1 && n.addStore(c, 70) == 2, "addStore", 0);
+        check(n.addStore(d, 10) == -1, "addStore beyond the server's strips", 0);
+
+        randomLeds(a, 100);
+        randomLeds(b, 50);
+        randomLeds(c, 70);
+        n.transfer();
+        server.receive();
+        check(server.stripLength[0] == 100 && server.stripLength[1] == 50 && server.stripLength[2] == 70,
+              "strips announced", 0);
+        check(same(server.strip(0), a, 100) && same(server.strip(1), b, 50) && same(server.strip(2), c, 70),
+              "strips sent", 0);
+
+        n.show(1);
+        server.receive();
+        check(server.stripShows == 1 && server.shows == 0, "show(strip)", 0);
+        n.show();
+        server.receive();
+        check(server.shows == 1, "show()", 0);
+
+        // strips that don't exist
+        n.show(7);
+        n.transferRange(0, 10, 5);
+        check(server.receive() == 0, "unknown strip", 0);
+        check(!server.bad, "strips frames", 0);
+
+        // a server that restarted with fewer outputs, as Connect() finds it
+        CTestServer again;
+        again.attach(n, 2, HOST_CODECS, FASTLED_MAX_FRAME, FASTLED_MAX_LEDS, 2);
+        n.Announce();
+        randomLeds(a, 100);
+        randomLeds(b, 50);
+        n.transfer();
+        again.receive();
+        check(n.numStrips == 2 && again.stripLength[0] == 100 && again.stripLength[1] == 50, "reconnect sizes", 0);
+        check(same(again.strip(0), a, 100) && same(again.strip(1), b, 50) && !again.bad, "reconnect frames", 0);
+    }
+    {
+        // no more leds than both ends can take, and RLE at its worst
+        CTestServer server;
+        NetworkLed n;
+        server.attach(n, 2, HOST_CODECS, 60000, 2000);
+        n.setStore(a);
+        n.SetNumLeds(2500);
+        check(n.NumLeds == 2000, "SetNumLeds() limit", 0);
+        n.SetNumLeds(3000);
+        for (int i = 0; i < 2000; i++)
+            a[i] = (i & 2) ? CRGB(1, 2, 3) : CRGB(4, 5, 6);
+        n.transfer();
+        server.receive();
+        check(same(server.strip(0), a, 2000) && !server.bad, "RLE of pairs", 0);
+    }
+}
+
+/***************************************************************************
+ *   ranges
+ ***************************************************************************/
+
+// the PHASE2 decoder of the server, for a whole buffer
+static unsigned int rleDecode(const unsigned char *in, unsigned int length, unsigned char *out)
+{
+    unsigned int i = 0, n = 0;
+
+    while (i + 3 <= length) {
+        memcpy(&out[n], &in[i], 3);
+        i += 3;
+        n += 3;
+        if (n > 3 && !memcmp(&out[n - 3], &out[n - 6], 3) && i < length) {
+            for (int r = in[i++]; r > 0; r--, n += 3)
+                memcpy(&out[n], &out[n - 3], 3);
+        }
+    }
+    return(n);
+}
+
+void testRanges(void)
+{
+    static CRGB a[100], b[50];
+
+    {
+        CTestServer server;
+        NetworkLed n;
+        server.attach(n, 2, HOST_CODECS);
+        n.setStore(a);
+        n.SetNumLeds(100);
+        n.addStore(b, 50);
+        randomLeds(a, 100);
+        randomLeds(b, 50);
+        n.transfer();
+        server.receive();
+
+        // only what changed
+        randomLeds(&a[10], 10);
+        b[5] = CRGB(1, 2, 3);
+        n.transfer();
+        unsigned int bytes = server.receive();
+        check(server.ranges == 2 && bytes < 3 * 20 + 40, "changed spans", bytes);
+        check(same(server.strip(0), a, 100) && same(server.strip(1), b, 50), "changed spans leds", 0);
+
+        // explicit spans go out whether they changed or not, cut to the strip
+        n.transferRange(40, 5);
+        n.transferRange(90, 50);
+        n.transferRange(100, 5);
+        bytes = server.receive();
+        check(server.ranges == 4 && bytes < 3 * 15 + 40, "transferRange()", bytes);
+        check(same(server.strip(0), a, 100) && !server.bad, "transferRange() leds", 0);
+    }
+    {
+        // a server without ranges gets whole strips
+        CTestServer server;
+        NetworkLed n;
+        server.attach(n, 2, CODEC_UNCOMPRESSED | CODEC_PHASE2 | CODEC_STRIPS);
+        n.setStore(a);
+        n.SetNumLeds(100);
+        n.transfer();
+        server.receive();
+        a[50] = CRGB(9, 9, 9);
+        n.transfer();
+        unsigned int bytes = server.receive();
+        check(server.ranges == 0 && bytes >= 300 && same(server.strip(0), a, 100), "no FastledRange", bytes);
+    }
+
+    // RLE of runs of every length, around the 255 a count byte holds
+    static unsigned char in[3 * 2000], rle[3 * 2000 + 1], out[3 * 2000 * 2];
+    for (unsigned int r = 0; r < ROUNDS / 10; r++) {
+        unsigned int n = 0;
+        while (n < 2000) {
+            unsigned int run = (r & 1) ? rnd() % 600 + 1 : rnd() % 4 + 1;
+            unsigned char c[3] = { (unsigned char)(rnd() & 3), 0, 0 };     // neighbouring runs the same color too
+            for (; run && n < 2000; run--, n++)
+                memcpy(&in[n * 3], c, 3);
+        }
+        unsigned int length = 0;
+        check(RleEncodePass2(in, n * 3, rle, &length, sizeof(rle)) == 0, "RleEncodePass2", r);
+        check(rleDecode(rle, length, out) == n * 3 && !memcmp(in, out, n * 3), "RleEncodePass2 decoded", r);
+        unsigned int shorter;
+        check(length < 2 || RleEncodePass2(in, n * 3, rle, &shorter, length - 1) < 0, "RleEncodePass2 limit", r);
+    }
+}
+
+/***************************************************************************
+ *   unchanged frames
+ ***************************************************************************/
+
+void testUnchanged(void)
+{
+    static CRGB a[100];
+    CTestServer server;
+    NetworkLed n;
+
+    // the XXH64 reference values
+    check(hash64("", 0, 0) == 0xEF46DB3751D8E999ULL, "hash64 empty", 0);
+    check(hash64("abc", 3, 0) == 0x44BC2CF5AD770999ULL, "hash64 abc", 0);
+
+    server.attach(n, 2, HOST_CODECS);
+    n.setStore(a);
+    n.SetNumLeds(100);
+    randomLeds(a, 100);
+    n.transfer();
+    n.show();
+    server.receive();
+    check(server.shows == 1, "show() after a change", 0);
+
+    n.transfer();
+    n.show();
+    check(server.receive() == 0, "unchanged frame", 0);
+
+    n.setKeepAlive(0);
+    n.transfer();
+    server.receive();
+    check(server.frames == 2 && same(server.strip(0), a, 100), "keepAlive 0", 0);
+}
+
+/***************************************************************************
+ *   tracked leds
+ ***************************************************************************/
+
+void testTracked(void)
+{
+    static CRGB a[1000];
+    CTrackedLeds t(a, 1000);
+    CTestServer server;
+    NetworkLed n;
+
+    server.attach(n, 2, HOST_CODECS);
+    n.setStore(t);
+    n.SetNumLeds(1000);
+    randomLeds(a, 1000);
+    n.transfer();
+    server.receive();
+    check(same(server.strip(0), a, 1000), "tracked first frame", 0);
+
+    t[500] = CRGB(1, 2, 3);
+    n.fill_solid(&a[900], 10, CRGB(4, 5, 6));
+    n.transfer();
+    unsigned int bytes = server.receive();
+    check(server.ranges == 2 && bytes < 3 * 11 + 40 && same(server.strip(0), a, 1000), "tracked writes", bytes);
+
+    // raw writes need a mark()
+    a[700] = CRGB(7, 8, 9);
+    n.transfer();
+    check(server.receive() == 0, "untracked write", 0);
+    t.mark(700, 1);
+    n.transfer();
+    server.receive();
+    check(same(server.strip(0), a, 1000) && !server.bad, "mark()", 0);
+
+    // a server that takes fewer leds than the buffer has only gets those
+    CTestServer small;
+    NetworkLed n2;
+    small.attach(n2, 2, HOST_CODECS, FASTLED_MAX_FRAME, 600);
+    n2.setStore(t);
+    n2.SetNumLeds(1000);
+    n2.transfer();
+    small.receive();
+    for (int i = 0; i < 1000; i += 2 << TRACK_CHUNK_SHIFT)
+        t[i] = CRGB(i >> 2, 1, 2);
+    n2.transfer();
+    small.receive();
+    check(small.ranges == 5 && same(small.strip(0), a, 600) && !small.bad, "tracked past the server's leds", 0);
+}
@@ -0,0 +1,430 @@
+//
+//  test_render.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+// What encode() puts on the wire for the render settings, as a
+// CTestServer receives it
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "tests.h"
+#include "bulk8.h"
+#include "power_mgt.h"
+
+#define RENDER_LEDS     300
+
+static CRGB leds[RENDER_LEDS];
+
+// random leds, in runs for odd rounds so RLE gets them too
+static void randomLeds(CRGB *l, unsigned int count, unsigned int round)
+{
+    CRGB c(0, 0, 0);
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (!(round & 1) || i % 10 == 0)
+            c = CRGB(rnd(), rnd(), rnd());
+        l[i] = c;
+    }
+}
+
+// what the server has after a transfer()
+static CRGB *sent(NetworkLed & n, CTestServer & server)
+{
+    n.transfer();
+    server.receive();
+    return server.strip(0);
+}
+
+static const EOrder orders[] = { RGB, RBG, GRB, GBR, BRG, BGR };
+
+// the byte that goes out k-th for a led
+static uint8_t ordered(const CRGB & led, EOrder order, int k)
+{
+    return led.raw[(order >> (6 - 3 * k)) & 3];
+}
+
+/***************************************************************************
+ *   brightness, correction and color order
+ ***************************************************************************/
+
+void testRender(void)
+{
+    CTestServer server;
+    NetworkLed n;
+
+    server.attach(n, 2, HOST_CODECS);
+    n.setStore(leds);
+    n.SetNumLeds(RENDER_LEDS);
+
+    for (unsigned int r = 0; r < 12; r++) {
+        EOrder order = orders[r % 6];
+        randomLeds(leds, RENDER_LEDS, r);
+        n.setColorOrder(order);
+        CRGB *wire = sent(n, server);
+        bool ok = true;
+        for (int i = 0; i < RENDER_LEDS; i++)
+            for (int k = 0; k < 3; k++)
+                ok = ok && wire[i].raw[k] == ordered(leds[i], order, k);
+        check(ok, "color order", r);
+    }
+    n.setColorOrder(RGB);
+
+    static const uint8_t levels[] = { 0, 1, 100, 200, 255 };
+    for (unsigned int r = 0; r < sizeof(levels); r++) {
+        n.setBrightness(levels[r]);
+        CRGB *wire = sent(n, server);
+        bool ok = true;
+        for (int i = 0; i < RENDER_LEDS; i++)
+            for (int k = 0; k < 3; k++)
+                ok = ok && fabsf(wire[i].raw[k] - leds[i].raw[k] * levels[r] / 255.0f) <= 1.0f;
+        check(ok, "brightness", levels[r]);
+    }
+
+    // nothing of green, half of blue
+    n.setCorrection(CRGB(255, 0, 127));
+    CRGB *wire = sent(n, server);
+    bool ok = true;
+    for (int i = 0; i < RENDER_LEDS; i++)
+        ok = ok && wire[i].r == leds[i].r && wire[i].g == 0 && fabsf(wire[i].b - leds[i].b / 2.0f) <= 1.0f;
+    check(ok && !server.bad, "correction", 0);
+}
+
+/***************************************************************************
+ *   8.8 tables and dithering
+ ***************************************************************************/
+
+// rounded, as without dithering
+static bool rounded(NetworkLed & n, const CRGB *wire)
+{
+    bool ok = true;
+
+    for (int i = 0; i < RENDER_LEDS; i++)
+        for (int k = 0; k < 3; k++)
+            ok = ok && wire[i].raw[k] == (n.wireTable[k][leds[i].raw[k]] + 128) >> 8;
+    return(ok);
+}
+
+void testDither(void)
+{
+    static uint8_t out[MAX_COUNT + 1], ref[MAX_COUNT + 1];
+    static uint16_t in[MAX_COUNT + 1];
+
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+        uint8_t s = rnd(), s2 = rnd();
+
+        fill16(in, MAX_COUNT + 1);
+        bulk_dither16(in + o, out + o, n, s, s2);
+        for (unsigned int i = 0; i < n; i++) {
+            unsigned int v = (in[o + i] + (uint8_t)(s + i * s2)) >> 8;
+            ref[o + i] = (v > 255) ? 255 : v;
+        }
+        check(!memcmp(out + o, ref + o, n), "bulk_dither16", r);
+    }
+
+    CTestServer server;
+    NetworkLed n;
+    server.attach(n, 2, HOST_CODECS);
+    n.setStore(leds);
+    n.SetNumLeds(RENDER_LEDS);
+    randomLeds(leds, RENDER_LEDS, 0);
+    n.setBrightness(100);
+    n.setGamma(2.2f);
+
+    bool ok = true;
+    for (int v = 0; v < 256; v++)
+        ok = ok && fabsf(n.wireTable[0][v] / 256.0f - powf(v / 255.0f, 2.2f) * 100) <= 1.0f;
+    check(ok, "gamma", 0);
+
+    // not dithered by default
+    check(rounded(n, sent(n, server)), "rounding", 0);
+    randomLeds(&leds[40], 50, 0);
+    n.transferRange(40, 50);
+    server.receive();
+    check(rounded(n, server.strip(0)), "rounding transferRange()", 0);
+
+    // 256 frames add up to the exact values
+    static uint32_t sum[RENDER_LEDS][3];
+    memset(sum, 0, sizeof(sum));
+    n.setDither();
+    ok = true;
+    for (int f = 0; f < 256; f++) {
+        n.transfer();
+        ok = ok && server.receive() > RENDER_LEDS * 3;
+        CRGB *wire = server.strip(0);
+        for (int i = 0; i < RENDER_LEDS; i++)
+            for (int k = 0; k < 3; k++)
+                sum[i][k] += wire[i].raw[k];
+    }
+    check(ok, "dithered frames", 0);
+    ok = true;
+    for (int i = 0; i < RENDER_LEDS; i++)
+        for (int k = 0; k < 3; k++)
+            ok = ok && sum[i][k] == n.wireTable[k][leds[i].raw[k]];
+    check(ok && !server.bad, "dither sums", 0);
+}
+
+/***************************************************************************
+ *   16 bit leds
+ ***************************************************************************/
+
+void testCRGB16(void)
+{
+    static uint16_t a16[MAX_COUNT + 1], b16[MAX_COUNT + 1], out16[MAX_COUNT + 1], ref16[MAX_COUNT + 1];
+
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+        uint16_t w = rnd();
+
+        fill16(a16, MAX_COUNT + 1);
+        fill16(b16, MAX_COUNT + 1);
+        memcpy(out16, a16, sizeof(a16));
+        bulk_scale16(out16 + o, n, w);
+        for (unsigned int i = 0; i < n; i++)
+            ref16[o + i] = scale16(a16[o + i], w);
+        check(!memcmp(out16 + o, ref16 + o, n * 2), "bulk_scale16", r);
+
+        bulk_blend16(a16 + o, b16 + o, out16 + o, n, w);
+        for (unsigned int i = 0; i < n; i++)
+            ref16[o + i] = scale16(a16[o + i], 65535 - w) + scale16(b16[o + i], w);
+        check(!memcmp(out16 + o, ref16 + o, n * 2), "bulk_blend16", r);
+    }
+
+    // a CRGB16 made from a CRGB goes out as that CRGB
+    static CRGB16 leds16[RENDER_LEDS];
+    CTestServer server, server16;
+    NetworkLed n, n16;
+    server.attach(n, 2, HOST_CODECS);
+    server16.attach(n16, 2, HOST_CODECS);
+    n.setStore(leds);
+    n.SetNumLeds(RENDER_LEDS);
+    n16.setStore(leds16, RENDER_LEDS);
+    n16.SetNumLeds(RENDER_LEDS);
+    for (unsigned int r = 0; r < 4; r++) {
+        randomLeds(leds, RENDER_LEDS, r);
+        for (int i = 0; i < RENDER_LEDS; i++)
+            leds16[i] = CRGB16(leds[i]);
+        if (r == 2) {
+            n.setGamma(2.2f);
+            n16.setGamma(2.2f);
+        }
+        CRGB *wire = sent(n, server);
+        CRGB *wire16 = sent(n16, server16);
+        check(!memcmp(wire, wire16, sizeof(leds)), "CRGB16 from CRGB", r);
+    }
+
+    // sent when it changes
+    n16.transfer();
+    check(server16.receive() == 0, "CRGB16 unchanged", 0);
+    leds16[7].r ^= 1;
+    n16.transfer();
+    check(server16.receive() > 0, "CRGB16 changed", 0);
+
+    // a range leaves nothing to hash, the next transfer() sends all of it
+    leds16[8].g ^= 1;
+    n16.transferRange(5, 10);
+    check(server16.receive() > 0 && server16.ranges == 1, "CRGB16 range", 0);
+    n16.transfer();
+    check(server16.receive() > 0, "CRGB16 after a range", 0);
+    n16.transfer();
+    check(server16.receive() == 0, "CRGB16 unchanged after a range", 0);
+
+    // the dithered 256 frames add up to the 8.8 values in between
+    static uint32_t sum[RENDER_LEDS][3];
+    memset(sum, 0, sizeof(sum));
+    for (int i = 0; i < RENDER_LEDS; i++)
+        leds16[i] = CRGB16(rnd(), rnd(), rnd());
+    n16.setDither();
+    for (int f = 0; f < 256; f++) {
+        CRGB *wire = sent(n16, server16);
+        for (int i = 0; i < RENDER_LEDS; i++)
+            for (int k = 0; k < 3; k++)
+                sum[i][k] += wire[i].raw[k];
+    }
+    bool ok = true;
+    for (int i = 0; i < RENDER_LEDS; i++)
+        for (int k = 0; k < 3; k++)
+            ok = ok && sum[i][k] == n16.wire16Lookup(k, leds16[i].raw[k]);
+    check(ok && !server16.bad, "CRGB16 dither sums", 0);
+}
+
+/***************************************************************************
+ *   planar leds
+ ***************************************************************************/
+
+static bool samePlanar(const CPlanarLeds & p, const CRGB *l)
+{
+    for (uint16_t i = 0; i < p.numLeds; i++)
+        if (p.get(i) != l[i])
+            return(false);
+    return(true);
+}
+
+void testPlanar(void)
+{
+    static CRGB a[RENDER_LEDS], b[RENDER_LEDS];
+    static CHSV hsv[RENDER_LEDS];
+    CPlanarLeds p(RENDER_LEDS), q(RENDER_LEDS);
+    NetworkLed n;
+
+    // the ops against their CRGB versions
+    for (unsigned int r = 0; r < 20; r++) {
+        uint8_t s = rnd();
+        randomLeds(a, RENDER_LEDS, r);
+        randomLeds(b, RENDER_LEDS, r + 1);
+        p.load(a, 0, RENDER_LEDS);
+        q.load(b, 0, RENDER_LEDS);
+        switch (r % 10) {
+            case 0:
+                n.fill_solid(a, RENDER_LEDS, CRGB(s, 2, 3));
+                n.fill_solid(p, CRGB(s, 2, 3));
+                break;
+            case 1:
+                n.fill_rainbow(a, RENDER_LEDS, s, 3);
+                n.fill_rainbow(p, s, 3);
+                break;
+            case 2:
+                for (int i = 0; i < RENDER_LEDS; i++)
+                    hsv[i] = CHSV(rnd(), rnd(), rnd());
+                n.hsv2rgb(hsv, a, RENDER_LEDS);
+                n.hsv2rgb(hsv, p);
+                break;
+            case 3:
+                n.nscale8(a, RENDER_LEDS, s);
+                n.nscale8(p, s);
+                break;
+            case 4:
+                n.nscale8_video(a, RENDER_LEDS, s);
+                n.nscale8_video(p, s);
+                break;
+            case 5:
+                n.fadeToBlackBy(a, RENDER_LEDS, s);
+                n.fadeToBlackBy(p, s);
+                break;
+            case 6:
+                n.fadeUsingColor(a, RENDER_LEDS, CRGB(s, 100, 200));
+                n.fadeUsingColor(p, CRGB(s, 100, 200));
+                break;
+            case 7:
+                n.nblend(a, b, RENDER_LEDS, s);
+                n.nblend(p, q, s);
+                break;
+            default:
+                n.blend(a, b, a, RENDER_LEDS, s);
+                n.blend(p, q, p, s);
+                break;
+        }
+        check(samePlanar(p, a), "planar ops", r);
+    }
+
+    // the same frames as the same leds interleaved, 8 and 16 bits
+    static CRGB16 leds16[RENDER_LEDS];
+    CPlanarLeds16 p16(RENDER_LEDS);
+    CTestServer server, serverPlanar, server16, serverPlanar16;
+    NetworkLed n16, planar, planar16;
+    server.attach(n, 2, HOST_CODECS);
+    serverPlanar.attach(planar, 2, HOST_CODECS);
+    server16.attach(n16, 2, HOST_CODECS);
+    serverPlanar16.attach(planar16, 2, HOST_CODECS);
+    n.setStore(leds);
+    n.SetNumLeds(RENDER_LEDS);
+    planar.setStore(p);
+    planar.SetNumLeds(RENDER_LEDS);
+    n16.setStore(leds16, RENDER_LEDS);
+    n16.SetNumLeds(RENDER_LEDS);
+    planar16.setStore(p16);
+    planar16.SetNumLeds(RENDER_LEDS);
+    for (unsigned int r = 0; r < 12; r++) {
+        NetworkLed *all[4] = { &n, &planar, &n16, &planar16 };
+        for (int j = 0; j < 4; j++) {
+            all[j]->setColorOrder(orders[r % 6]);
+            all[j]->setBrightness((r & 1) ? 100 : 255);
+            all[j]->setGamma((r & 2) ? 2.2f : 1.0f);
+        }
+        randomLeds(leds, RENDER_LEDS, r);
+        p.load(leds, 0, RENDER_LEDS);
+        for (int i = 0; i < RENDER_LEDS; i++) {
+            leds16[i] = CRGB16(rnd(), rnd(), rnd());
+            p16.set(i, leds16[i]);
+        }
+        bool same = !memcmp(sent(n, server), sent(planar, serverPlanar), sizeof(leds));
+        bool same16 = !memcmp(sent(n16, server16), sent(planar16, serverPlanar16), sizeof(leds));
+        check(same, "planar frames", r);
+        check(same16, "planar16 frames", r);
+
+        // and a part of it
+        uint16_t start = rnd() % RENDER_LEDS, count = rnd() % (RENDER_LEDS - start) + 1;
+        randomLeds(&leds[start], count, r);
+        p.load(&leds[start], start, count);
+        n.transferRange(start, count);
+        planar.transferRange(start, count);
+        server.receive();
+        serverPlanar.receive();
+        check(!memcmp(server.strip(0), serverPlanar.strip(0), sizeof(leds)), "planar transferRange()", r);
+    }
+    check(!server.bad && !serverPlanar.bad && !server16.bad && !serverPlanar16.bad, "planar frames", 0);
+}
+
+/***************************************************************************
+ *   power limit
+ ***************************************************************************/
+
+void testPower(void)
+{
+    static uint8_t a[MAX_COUNT * 3 + 1];
+
+    for (unsigned int r = 0; r < ROUNDS; r++) {
+        unsigned int n = rnd() % MAX_COUNT;
+        unsigned int o = r & 1;
+
+        fill(a, sizeof(a));
+        uint32_t sum[3] = { 1, 2, 3 }, sumRef[3] = { 1, 2, 3 }, total = 0;
+        bulk_sum8x3(a + o, n, sum);
+        for (unsigned int i = 0; i < n * 3; i++)
+            sumRef[i % 3] += a[o + i];
+        check(!memcmp(sum, sumRef, sizeof(sum)), "bulk_sum8x3", r);
+        for (unsigned int i = 0; i < n; i++)
+            total += a[o + i];
+        check(bulk_sum8(a + o, n) == total, "bulk_sum8", r);
+    }
+
+    // white draws about 210 mW a led
+    CTestServer server;
+    NetworkLed n;
+    server.attach(n, 2, HOST_CODECS);
+    n.setStore(leds);
+    n.SetNumLeds(RENDER_LEDS);
+    for (int i = 0; i < RENDER_LEDS; i++)
+        leds[i] = CRGB(255, 255, 255);
+    uint32_t white = calculate_unscaled_power_mW(leds, RENDER_LEDS);
+    check(white == (RENDER_LEDS * 255 * 80 >> 8) + (RENDER_LEDS * 255 * 55 >> 8) + (RENDER_LEDS * 255 * 75 >> 8)
+          + RENDER_LEDS * 5, "calculate_unscaled_power_mW", white);
+    uint8_t limit = calculate_max_brightness_for_power_mW(leds, RENDER_LEDS, 255, 20000);
+    check(white * limit / 256 <= 20000 && white * (limit + 1) / 256 > 20000, "calculate_max_brightness_for_power_mW", limit);
+
+    // over budget, the frame goes out darker
+    n.setMaxPowerInMilliWatts(20000);
+    CRGB *wire = sent(n, server);
+    uint8_t b = n.getPowerBrightness();
+    check(b < 255 && n.getBrightness() == 255 && n.getPower_mW() <= 20000, "power limit", b);
+    bool ok = true;
+    for (int i = 0; i < RENDER_LEDS; i++)
+        ok = ok && wire[i] == CRGB(b, b, b);
+    check(ok, "power limited frame", b);
+
+    // and back up once the leds are darker
+    for (int i = 0; i < RENDER_LEDS; i++)
+        leds[i] = (i % 10) ? CRGB(0, 0, 0) : CRGB(255, 255, 255);
+    for (int f = 0; f < 3; f++)
+        wire = sent(n, server);
+    check(n.getPowerBrightness() == 255 && wire[0] == CRGB(255, 255, 255) && !server.bad, "power limit lifted", 0);
+}
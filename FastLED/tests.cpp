@@ -0,0 +1,289 @@
+//
+//  tests.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/14/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+// Host side checks of the library, built by the tests target with the
+// library sources except main.cpp. The protocol checks talk to a
+// CTestServer over a socketpair instead of a real server, everything
+// else compares the library against the plain code it stands in for.
+// Building the target runs it, and it fails the build if anything didn't
+// match. Building it once more with FASTLED_NO_SIMD checks the plain C
+// loops the same way.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "tests.h"
+
+static unsigned long failed;
+
+void check(bool ok, const char *what, unsigned int round)
+{
+    if (ok)
+        return;
+    if (failed < 20)
+        printf("%s differs, round %u\n", what, round);
+    failed++;
+}
+
+static uint32_t seed = 1;
+
+uint32_t rnd(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return(seed);
+}
+
+void fill(uint8_t *p, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++)
+        p[i] = (i % 7 == 0) ? 0 : (i % 11 == 0) ? 255 : rnd();     // the edges often
+}
+
+void fill16(uint16_t *p, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++)
+        p[i] = (i % 7 == 0) ? 0 : (i % 11 == 0) ? 65535 : rnd();
+}
+
+/***************************************************************************
+ *   CTestServer
+ ***************************************************************************/
+
+#define SERVER_BUFFER   (1 << 20)
+
+CTestServer::CTestServer(void)
+{
+    int size = SERVER_BUFFER;
+
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(sv[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    in = (unsigned char *)malloc(SERVER_BUFFER);
+    memset((void *)leds, 0, sizeof(leds));
+    memset(stripOffset, 0, sizeof(stripOffset));
+    memset(stripLength, 0, sizeof(stripLength));
+    nextOffset = 0;
+    frames = 0;
+    shows = 0;
+    stripShows = 0;
+    ranges = 0;
+    encoding = 0;
+    bad = false;
+}
+
+CTestServer::~CTestServer(void)
+{
+    close(sv[0]);
+    close(sv[1]);
+    free(in);
+}
+
+void CTestServer::attach(NetworkLed & n, uint8_t version, uint16_t codecs, uint16_t maxFrame,
+                         uint16_t numLeds, uint8_t strips)
+{
+    unsigned char caps[12] = { SYN, SOH, STX, FastledCaps, version,
+        (unsigned char)(codecs >> 8), (unsigned char)codecs,
+        (unsigned char)(maxFrame >> 8), (unsigned char)maxFrame,
+        (unsigned char)(numLeds >> 8), (unsigned char)numLeds, strips };
+
+    n.sock = sv[0];
+    if (version)
+        send(sv[1], caps, (version >= 2) ? 12 : 11, 0);
+    n.Hello();
+    n.setKeepAlive(60000);              // no refreshes in the middle of a check
+    receive();
+}
+
+uint8_t CTestServer::get(void)
+{
+    if (pos < length)
+        return(in[pos++]);
+    bad = true;
+    return(0);
+}
+
+uint16_t CTestServer::get16(void)
+{
+    uint16_t v = get() << 8;
+    return(v | get());
+}
+
+// decode0() and decode2() of the server
+void CTestServer::decode(CRGB *target, uint16_t limit, uint8_t how)
+{
+    uint16_t size = get16();
+    unsigned int end = pos + size;
+    int index = 0;
+
+    frames++;
+    encoding = how;
+    if (end > length) {
+        bad = true;
+        return;
+    }
+    if (how == UNCOMPRESSED) {
+        if (size % 3)
+            bad = true;
+        for (unsigned int i = 0; i < size; i++)
+            if (i < limit * 3u)
+                ((uint8_t *)target)[i] = in[pos + i];
+        pos = end;
+        return;
+    }
+    if (how != PHASE2) {
+        bad = true;
+        return;
+    }
+    CRGB prev(0, 0, 0);
+    while (pos < end) {
+        CRGB pixel;
+        pixel.r = get();
+        pixel.g = get();
+        pixel.b = get();
+        if (index < limit)
+            target[index] = pixel;
+        index++;
+        if (index > 1 && pixel == prev) {
+            uint8_t run = get();
+            for (int i = 0; i < run; i++, index++)
+                if (index < limit)
+                    target[index] = pixel;
+        }
+        prev = pixel;
+    }
+    if (pos != end)
+        bad = true;
+}
+
+void CTestServer::addStrip(uint8_t strip, uint16_t num)
+{
+    if (strip >= FASTLED_MAX_STRIPS || stripLength[strip])
+        return;
+    if (nextOffset + num > FASTLED_MAX_LEDS)
+        num = FASTLED_MAX_LEDS - nextOffset;
+    stripOffset[strip] = nextOffset;
+    stripLength[strip] = num;
+    nextOffset += num;
+}
+
+unsigned int CTestServer::receive(void)
+{
+    int n;
+
+    length = 0;
+    while ((n = recv(sv[1], in + length, SERVER_BUFFER - length, MSG_DONTWAIT)) > 0)
+        length += n;
+    for (pos = 0; pos < length && !bad; ) {
+        if (get() != SYN || get() != SOH || get() != STX) {
+            bad = true;
+            break;
+        }
+        uint8_t command = get();
+        switch (command) {
+            case UNCOMPRESSED:
+            case PHASE2:
+                decode(strip(0), FASTLED_MAX_LEDS - stripOffset[0], command);
+                break;
+            case FastledShow:
+                shows++;
+                break;
+            case FastledSetBrightness:
+                get();
+                break;
+            case FastledSetNumLeds:
+                addStrip(0, get16());
+                break;
+            case FastledHello: {
+                uint8_t version = get();
+                pos += (version >= 2) ? 7 : 6;
+                break;
+            }
+            case FastledStripPixels: {
+                uint8_t s = get();
+                uint8_t how = get();
+                if (s < FASTLED_MAX_STRIPS)
+                    decode(strip(s), FASTLED_MAX_LEDS - stripOffset[s], how);
+                else
+                    decode(leds, 0, how);
+                break;
+            }
+            case FastledStripSetNumLeds: {
+                uint8_t s = get();
+                addStrip(s, get16());
+                break;
+            }
+            case FastledStripShow:
+                if (get() == STRIP_ALL)
+                    shows++;
+                else
+                    stripShows++;
+                break;
+            case FastledRange: {
+                uint8_t s = get();
+                uint16_t start = get16();
+                uint16_t count = get16();
+                uint8_t how = get();
+                uint16_t limit = 0;
+                ranges++;
+                if (s < FASTLED_MAX_STRIPS && start < stripLength[s]) {
+                    limit = stripLength[s] - start;
+                    if (count < limit)
+                        limit = count;
+                }
+                decode(limit ? strip(s) + start : leds, limit, how);
+                break;
+            }
+            default:
+                bad = true;
+                break;
+        }
+    }
+    return(length);
+}
+
+int main(int, char **)
+{
+#ifdef FASTLED_NO_SIMD
+    puts("without SIMD");
+#endif
+    testHandshake();
+    testStrips();
+    testRanges();
+    testUnchanged();
+    testTracked();
+    testScale();
+    testBlend();
+    testHsv2rgb();
+    testHsvTable();
+    testRgb2hsv();
+    testBlur2d();
+    testLayouts();
+    testParallel();
+    testRender();
+    testDither();
+    testCRGB16();
+    testPlanar();
+    testPalettes();
+    testNoise();
+    testPower();
+    testRandom();
+    testFrameClock();
+    testTimerWheel();
+    testWaves();
+    testLayers();
+    if (failed) {
+        printf("%lu checks failed\n", failed);
+        return(1);
+    }
+    puts("all checks passed");
+    return(0);
+}
@@ -0,0 +1,99 @@
+//
+//  tests.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/14/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef tests_h
+#define tests_h
+
+#include <stdint.h>
+
+#include "FastLED.hpp"
+
+///@file tests.h
+/// the host side checks run by the tests target, see tests.cpp
+
+#define ROUNDS      2000            // random cases per check
+#define MAX_COUNT   300             // longest random array, enough for every vector width and its tail
+
+// counts a mismatch and prints the first few
+void check(bool ok, const char *what, unsigned int round);
+
+// the same random numbers every run, rand() differs between hosts
+uint32_t rnd(void);
+void fill(uint8_t *p, unsigned int count);
+void fill16(uint16_t *p, unsigned int count);
+
+/// The server end of a socketpair. receive() decodes what a NetworkLed
+/// sent the way FastLED-Server.ino does, into leds[].
+class CTestServer {
+public:
+    CRGB leds[FASTLED_MAX_LEDS];
+    uint16_t stripOffset[FASTLED_MAX_STRIPS];   // where each strip is in leds[]
+    uint16_t stripLength[FASTLED_MAX_STRIPS];
+    unsigned int frames;                        // pixel frames decoded
+    unsigned int shows;                         // FastledShow
+    unsigned int stripShows;                    // FastledStripShow of a single strip
+    unsigned int ranges;                        // FastledRange
+    uint8_t encoding;                           // of the last pixel frame
+    bool bad;                                   // got something it doesn't understand
+
+    CTestServer(void);
+    ~CTestServer(void);
+
+    // Hand n the host end of the socket and answer its HELLO the way a
+    // server of that version would, version 0 doesn't answer at all
+    void attach(NetworkLed & n, uint8_t version, uint16_t codecs, uint16_t maxFrame = FASTLED_MAX_FRAME,
+                uint16_t numLeds = FASTLED_MAX_LEDS, uint8_t strips = FASTLED_MAX_STRIPS);
+
+    // decode everything that came in, returns the number of bytes
+    unsigned int receive(void);
+
+    CRGB *strip(uint8_t s) { return &leds[stripOffset[s]]; }
+
+private:
+    int sv[2];
+    unsigned char *in;
+    unsigned int pos;
+    unsigned int length;
+    uint16_t nextOffset;
+
+    uint8_t get(void);
+    uint16_t get16(void);
+    void decode(CRGB *target, uint16_t limit, uint8_t how);
+    void addStrip(uint8_t strip, uint16_t num);
+
+    CTestServer(const CTestServer &);
+    CTestServer & operator= (const CTestServer &);
+};
+
+void testHandshake(void);
+void testStrips(void);
+void testRanges(void);
+void testUnchanged(void);
+void testTracked(void);
+void testScale(void);
+void testBlend(void);
+void testHsv2rgb(void);
+void testHsvTable(void);
+void testRgb2hsv(void);
+void testBlur2d(void);
+void testLayouts(void);
+void testParallel(void);
+void testRender(void);
+void testDither(void);
+void testCRGB16(void);
+void testPlanar(void);
+void testPalettes(void);
+void testNoise(void);
+void testPower(void);
+void testRandom(void);
+void testFrameClock(void);
+void testTimerWheel(void);
+void testWaves(void);
+void testLayers(void);
+
+#endif /* tests_h */
@@ -0,0 +1,141 @@
+//
+//  threadpool.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdlib.h>         // malloc
+
+#include "threadpool.h"
+
+CThreadPool::CThreadPool(void)
+{
+    threads = NULL;
+    numThreads = 0;
+    generation = 0;
+    startGeneration = 0;
+    busy = 0;
+    quit = false;
+    pthread_mutex_init(&runLock, NULL);
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&wake, NULL);
+    pthread_cond_init(&done, NULL);
+}
+
+CThreadPool::~CThreadPool(void)
+{
+    start(0);
+    pthread_cond_destroy(&done);
+    pthread_cond_destroy(&wake);
+    pthread_mutex_destroy(&lock);
+    pthread_mutex_destroy(&runLock);
+}
+
+void CThreadPool::start(int count)
+{
+    pthread_mutex_lock(&runLock);
+
+    // stop whatever is running now
+    pthread_mutex_lock(&lock);
+    quit = true;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+    for (int i = 0; i < numThreads; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    threads = NULL;
+    numThreads = 0;
+    quit = false;
+    startGeneration = generation;   // new workers wait for the next run()
+
+    if (count > 0) {
+        threads = (pthread_t *)malloc(count * sizeof(pthread_t));
+        if (threads == NULL) {
+            puts("CThreadPool::start() out of memory, staying serial");
+            count = 0;
+        }
+        for (int i = 0; i < count; i++) {
+            if (pthread_create(&threads[numThreads], NULL, worker, this) != 0) {
+                puts("CThreadPool::start() could not create thread");
+                break;
+            }
+            numThreads++;
+        }
+    }
+    pthread_mutex_unlock(&runLock);
+}
+
+// take chunks until there are none left
+void CThreadPool::work(void)
+{
+    for (;;) {
+        uint32_t begin = __sync_fetch_and_add(&jobNext, jobChunk);
+        if (begin >= jobCount)
+            return;
+        uint32_t end = (jobCount - begin < jobChunk) ? jobCount : begin + jobChunk;
+        jobFn(jobCtx, begin, end);
+    }
+}
+
+void *CThreadPool::worker(void *arg)
+{
+    CThreadPool *pool = (CThreadPool *)arg;
+    uint32_t seen;
+
+    pthread_mutex_lock(&pool->lock);
+    seen = pool->startGeneration;
+    for (;;) {
+        while (pool->generation == seen && !pool->quit)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->work();
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return(NULL);
+}
+
+void CThreadPool::run(void (*fn)(void *, uint32_t, uint32_t), void *ctx, uint32_t count, uint32_t grain)
+{
+    pthread_mutex_lock(&runLock);
+    if (numThreads == 0) {
+        pthread_mutex_unlock(&runLock);
+        fn(ctx, 0, count);
+        return;
+    }
+
+    // about four chunks per thread, so a slow one doesn't hold up the rest
+    uint32_t chunk = count / (size() * 4);
+    chunk = (chunk + grain - 1) / grain * grain;
+    if (chunk == 0)
+        chunk = grain;
+
+    pthread_mutex_lock(&lock);
+    jobFn = fn;
+    jobCtx = ctx;
+    jobCount = count;
+    jobChunk = chunk;
+    jobNext = 0;
+    busy = numThreads;
+    generation++;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&lock);
+
+    work();                         // the caller helps out
+
+    pthread_mutex_lock(&lock);
+    while (busy > 0)
+        pthread_cond_wait(&done, &lock);
+    pthread_mutex_unlock(&lock);
+    pthread_mutex_unlock(&runLock);
+}
@@ -0,0 +1,71 @@
+//
+//  threadpool.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef threadpool_h
+#define threadpool_h
+
+#include <stdint.h>
+#include <pthread.h>
+
+///@file threadpool.h
+/// persistent worker threads for the bulk led functions
+
+#define PARALLEL_GRAIN      64          // leds per chunk at least, 3 whole cache lines of CRGB
+#define PARALLEL_MIN        16384       // below this many leds everything runs serially
+
+/// A fixed set of worker threads that sleep until run() hands them work.
+/// run() splits [0, count) into chunks of a multiple of grain,
+/// the workers and the calling thread take chunks until none are left,
+/// and run() returns when all of them are done.
+class CThreadPool {
+public:
+    CThreadPool(void);
+    ~CThreadPool(void);
+
+    // start threads workers, 0 stops them all again
+    void start(int threads);
+
+    // number of threads working on a run(), including the caller
+    int size(void) { return numThreads + 1; }
+
+    void run(void (*fn)(void *, uint32_t, uint32_t), void *ctx, uint32_t count,
+             uint32_t grain = PARALLEL_GRAIN);
+
+    // run f(begin, end) on chunks of [0, count)
+    template<class F> void run(uint32_t count, F & f, uint32_t grain = PARALLEL_GRAIN) {
+        run(&call<F>, &f, count, grain);
+    }
+
+private:
+    pthread_t *threads;
+    int numThreads;
+    pthread_mutex_t runLock;            // one run() at a time
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    uint32_t generation;                // bumped for every run()
+    uint32_t startGeneration;           // generation when the workers were started
+    int busy;                           // workers still on the current run()
+    bool quit;
+
+    // the current run()
+    void (*jobFn)(void *, uint32_t, uint32_t);
+    void *jobCtx;
+    uint32_t jobCount;
+    uint32_t jobChunk;
+    uint32_t jobNext;                   // first index nobody has taken yet
+
+    template<class F> static void call(void *f, uint32_t begin, uint32_t end) {
+        (*(F *)f)(begin, end);
+    }
+
+    static void *worker(void *pool);
+    void work(void);
+};
+
+#endif /* threadpool_h */
@@ -0,0 +1,207 @@
+//
+//  timerwheel.cpp
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#include <stdint.h>
+
+#include "lib8tion.h"
+#include "timerwheel.h"
+
+CTimerWheel timerWheel;
+
+CTimerWheel::CTimerWheel(void)
+{
+    for (int l = 0; l < WHEEL_LEVELS; l++)
+        for (int s = 0; s < WHEEL_SLOTS; s++)
+            slots[l][s].next = slots[l][s].prev = &slots[l][s];
+    now = 0;
+    started = false;
+    servicing = false;
+    count = 0;
+    level0 = 0;
+}
+
+// Put t in the slot for how far away it is, at the end of the list. A
+// cascade can bring a timer down that is due right now, it goes into the
+// level 0 slot that is about to go off.
+void CTimerWheel::insert(CWheelTimer *t)
+{
+    uint32_t delta = t->when - now;
+    int level = 0;
+
+    while (level < WHEEL_LEVELS - 1 && delta >> (WHEEL_BITS * (level + 1)))
+        level++;
+    t->level = level;
+    if (level == 0)
+        level0++;
+
+    CTimerLink *slot = &slots[level][(t->when >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+    t->prev = slot->prev;
+    t->next = slot;
+    slot->prev->next = t;
+    slot->prev = t;
+}
+
+void CTimerWheel::add(CWheelTimer *t)
+{
+    if (!started) {
+        now = get_millisecond_timer();
+        started = true;
+    }
+    if ((int32_t)(t->when - now) <= 0)
+        t->when = now + 1;              // overdue
+    insert(t);
+    count++;
+}
+
+void CTimerWheel::remove(CWheelTimer *t)
+{
+    if (!t->next)
+        return;                         // not on the wheel
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+    count--;
+    if (t->level == 0)
+        level0--;
+}
+
+// Move the whole list of a slot to list, so what gets added to the slot
+// while going through it waits for the next round
+void CTimerWheel::take(CTimerLink *slot, CTimerLink *list)
+{
+    if (slot->next == slot) {
+        list->next = list->prev = list;
+        return;
+    }
+    list->next = slot->next;
+    list->prev = slot->prev;
+    list->next->prev = list;
+    list->prev->next = list;
+    slot->next = slot->prev = slot;
+}
+
+/***************************************************************************
+ *   Function   : CTimerWheel::service
+ *   Description: step the wheel a ms at a time up to time. At every step
+ *                the levels whose slot just came round are cascaded, the
+ *                lowest first, then the timers of the level 0 slot go off
+ *                and are put back a period after time.
+ *   Parameters : time - the current time in ms
+ *   Returned   : none
+ ***************************************************************************/
+
+void CTimerWheel::service(uint32_t time)
+{
+    CTimerLink list;
+
+    if (!started) {
+        now = time;
+        started = true;
+        return;
+    }
+    if (servicing)
+        return;
+    servicing = true;
+    while ((int32_t)(time - now) > 0) {
+        if (!count) {
+            now = time;                 // nothing to step through
+            break;
+        }
+        if (!level0) {
+            // no slot goes off before the next cascade, skip to it
+            uint32_t last = now | (WHEEL_SLOTS - 1);
+            if ((int32_t)(time - last) <= 0) {
+                now = time;
+                break;
+            }
+            now = last;
+        }
+        now++;
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if (now & ((1u << (WHEEL_BITS * level)) - 1))
+                break;
+            take(&slots[level][(now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)], &list);
+            while (list.next != &list) {
+                CWheelTimer *t = (CWheelTimer *)list.next;
+                list.next = t->next;
+                t->next->prev = &list;
+                insert(t);
+            }
+        }
+        take(&slots[0][now & (WHEEL_SLOTS - 1)], &list);
+        while (list.next != &list) {
+            CWheelTimer *t = (CWheelTimer *)list.next;
+            list.next = t->next;
+            t->next->prev = &list;
+            t->next = t->prev = NULL;
+            count--;
+            level0--;
+            t->fired = true;
+            t->schedule(time + (t->mPeriod ? t->mPeriod : 1));
+            if (t->callback)
+                t->callback(t->arg);
+        }
+    }
+    servicing = false;
+}
+
+/***************************************************************************
+ *   CWheelTimer
+ ***************************************************************************/
+
+CWheelTimer::CWheelTimer(uint32_t period, void (*cb)(void *), void *a, CTimerWheel & w)
+{
+    next = prev = NULL;
+    wheel = &w;
+    mPeriod = period;
+    callback = cb;
+    arg = a;
+    fired = false;
+    schedule(get_millisecond_timer() + period);
+}
+
+CWheelTimer::~CWheelTimer(void)
+{
+    wheel->remove(this);
+}
+
+void CWheelTimer::schedule(uint32_t at)
+{
+    wheel->remove(this);
+    when = at;
+    wheel->add(this);
+}
+
+void CWheelTimer::setPeriod(uint32_t period)
+{
+    mPeriod = period;
+    reset();
+}
+
+void CWheelTimer::reset(void)
+{
+    fired = false;
+    schedule(get_millisecond_timer() + mPeriod);
+}
+
+void CWheelTimer::trigger(void)
+{
+    schedule(get_millisecond_timer());
+}
+
+// Without a frame_clock_begin() in the loop nothing else services the
+// wheel. Once it has caught up this is just a compare.
+bool CWheelTimer::ready(void)
+{
+    bool isReady;
+
+    wheel->service(get_millisecond_timer());
+    isReady = fired;
+    fired = false;
+    return(isReady);
+}
@@ -0,0 +1,107 @@
+//
+//  timerwheel.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef timerwheel_h
+#define timerwheel_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+///@file timerwheel.h
+/// periodic timers kept in a hierarchical timer wheel
+
+#define WHEEL_BITS      8
+#define WHEEL_SLOTS     (1 << WHEEL_BITS)
+#define WHEEL_LEVELS    4                   // 4 * 8 bits, any uint32_t ms delay
+
+/// list links, a slot of the wheel is the head of a circular list
+struct CTimerLink {
+    CTimerLink *next;
+    CTimerLink *prev;
+};
+
+class CWheelTimer;
+
+/// Timers sorted by when they are due into 4 levels of 256 slots. Level 0
+/// has a slot per ms for the next 256 ms, level 1 a slot per 256 ms for
+/// the next 65536 ms, and so on. Adding and removing a timer is O(1).
+/// service() steps the wheel up to the current time, a ms at a time,
+/// firing the timers of every level 0 slot it passes. Every 256 ms the
+/// next level 1 slot is spread out over level 0, and so on up, so the
+/// work per ms doesn't depend on how many timers are waiting. While
+/// level 0 is empty it goes 256 ms at a time.
+/// Timers fire in the order they are due, timers due in the same ms in
+/// the order they got to their slot.
+class CTimerWheel {
+public:
+    CTimerWheel(void);
+    
+    // fire what is due up to now, the rest is not looked at
+    void service(uint32_t now);
+    
+    // schedule t at t->when, overdue timers go off at the next service()
+    void add(CWheelTimer *t);
+    void remove(CWheelTimer *t);
+    
+    unsigned int pending(void) { return count; }
+    
+private:
+    CTimerLink slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    uint32_t now;                           // the wheel has been serviced up to here
+    bool started;
+    bool servicing;                         // in service(), a callback can't step it again
+    unsigned int count;                     // timers on the wheel
+    unsigned int level0;                    // of them in level 0
+    
+    void insert(CWheelTimer *t);
+    void take(CTimerLink *slot, CTimerLink *list);
+};
+
+/// the wheel the EVERY_N macros use, frame_clock_begin() services it
+/// and so does CWheelTimer::ready() when the wheel is behind
+extern CTimerWheel timerWheel;
+
+/// A timer that goes off every period ms, from when it is created. When
+/// it does the callback is called from service(), and ready() returns
+/// true once. Either way it waits a whole period from then again, like
+/// the CEveryN timers do.
+class CWheelTimer : public CTimerLink {
+public:
+    CWheelTimer(uint32_t period, void (*callback)(void *) = NULL, void *arg = NULL,
+                CTimerWheel & wheel = timerWheel);
+    ~CWheelTimer(void);
+    
+    // starts the period over
+    void setPeriod(uint32_t period);
+    uint32_t getPeriod(void) { return mPeriod; }
+    
+    // wait a whole period from now
+    void reset(void);
+    // go off at the next service()
+    void trigger(void);
+    
+    // steps the wheel up to now first, if nothing else has
+    bool ready(void);
+    
+    operator bool() { return ready(); }
+    
+private:
+    friend class CTimerWheel;
+    
+    CTimerWheel *wheel;
+    uint32_t when;                          // ms it is due at
+    uint8_t level;                          // of the wheel it is on
+    uint32_t mPeriod;
+    void (*callback)(void *);
+    void *arg;
+    bool fired;                             // went off since ready() last looked
+    
+    void schedule(uint32_t at);
+};
+
+#endif /* timerwheel_h */
@@ -0,0 +1,144 @@
+//
+//  trackedleds.h
+//  FastLED
+//
+//  Created by Andreas Pleschutznig on 4/17/16.
+//  Copyright © 2016 Andreas Pleschutznig. All rights reserved.
+//
+
+#ifndef trackedleds_h
+#define trackedleds_h
+
+#include <stdint.h>
+#include <stdio.h>          // puts
+#include <stdlib.h>         // calloc, abort
+#include <string.h>
+
+#include "pixeltypes.h"
+
+///@file trackedleds.h
+/// led buffer that remembers which parts of it were written to
+
+#define TRACK_CHUNK_SHIFT   6                       // 64 leds per chunk
+#define TRACK_CHUNK_SIZE    (1 << TRACK_CHUNK_SHIFT)
+
+/// A CRGB buffer with a dirty bitmap, one bit per 64 leds.
+/// Writes through operator[] and through the NetworkLed bulk functions
+/// mark the chunks they touch, so transfer() only has to look at those.
+/// Writes through the raw pointer are not seen, call mark() for them.
+class CTrackedLeds {
+public:
+    CRGB *leds;
+    uint16_t numLeds;
+    uint16_t numChunks;
+    uint64_t *dirty;                        // bit n set: chunk n was written to
+    
+    CTrackedLeds(CRGB *l, uint16_t num) {
+        leds = l;
+        numLeds = num;
+        numChunks = (num + TRACK_CHUNK_SIZE - 1) >> TRACK_CHUNK_SHIFT;
+        dirty = (uint64_t *)calloc((numChunks + 63) / 64 + 1, sizeof(uint64_t));
+        if (dirty == NULL) {
+            puts("CTrackedLeds out of memory");    // can't go on without knowing what changed
+            abort();
+        }
+        markAll();                          // the server hasn't seen any of it yet
+    }
+    
+    ~CTrackedLeds() {
+        free(dirty);
+    }
+    
+    // tracked access
+    inline CRGB& operator[] (uint16_t i) __attribute__((always_inline))
+    {
+        uint16_t chunk = i >> TRACK_CHUNK_SHIFT;
+        dirty[chunk >> 6] |= 1ULL << (chunk & 63);
+        return leds[i];
+    }
+    
+    // untracked access, for reading or for passing to the bulk functions
+    inline operator CRGB* () __attribute__((always_inline))
+    {
+        return leds;
+    }
+    
+    inline bool contains(const CRGB *p, uint16_t count) const
+    {
+        return p >= leds && p + count <= leds + numLeds;
+    }
+    
+    // mark count leds starting at start as written to
+    void mark(uint16_t start, uint16_t count) {
+        if (count == 0 || start >= numLeds)
+            return;
+        if (count > numLeds - start)
+            count = numLeds - start;
+        
+        uint16_t first = start >> TRACK_CHUNK_SHIFT;
+        uint16_t last = (start + count - 1) >> TRACK_CHUNK_SHIFT;
+        for (uint16_t chunk = first; chunk <= last; ) {
+            if ((chunk & 63) == 0 && chunk + 63 <= last) {
+                dirty[chunk >> 6] = ~0ULL;  // whole word at once
+                chunk += 64;
+            } else {
+                dirty[chunk >> 6] |= 1ULL << (chunk & 63);
+                chunk++;
+            }
+        }
+    }
+    
+    void markAll() {
+        mark(0, numLeds);
+    }
+    
+    void clear() {
+        memset(dirty, 0, ((numChunks + 63) / 64) * sizeof(uint64_t));
+    }
+    
+    bool isDirty(uint16_t chunk) const {
+        return (dirty[chunk >> 6] >> (chunk & 63)) & 1;
+    }
+    
+    // Find the next run of dirty chunks at or after *chunk.
+    // Returns false if there is none, otherwise *chunk is the first
+    // chunk of the run and *run its length in chunks.
+    bool nextDirty(uint16_t *chunk, uint16_t *run) const {
+        uint16_t c = *chunk;
+        
+        while (c < numChunks) {
+            uint64_t word = dirty[c >> 6] >> (c & 63);
+            if (word) {
+                c += __builtin_ctzll(word);
+                break;
+            }
+            c = (c | 63) + 1;               // nothing left in this word
+        }
+        if (c >= numChunks)
+            return(false);
+        
+        uint16_t end = c;
+        while (end < numChunks) {
+            uint64_t word = ~dirty[end >> 6] >> (end & 63);
+            if (word) {
+                end += __builtin_ctzll(word);
+                break;
+            }
+            end = (end | 63) + 1;           // the whole rest of the word is dirty
+        }
+        if (end > numChunks)
+            end = numChunks;
+        
+        *chunk = c;
+        *run = end - c;
+        return(true);
+    }
+    
+private:
+    // owns the dirty bitmap
+    CTrackedLeds(const CTrackedLeds &);
+    CTrackedLeds & operator= (const CTrackedLeds &);
+};
+
+
+#endif /* trackedleds_h */